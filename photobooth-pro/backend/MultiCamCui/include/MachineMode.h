@@ -0,0 +1,10 @@
+﻿#pragma once
+
+// Non-interactive mode used when MultiCamCui runs as a helper process.
+// Requests and responses are binary frames (ipc/FrameProtocol.h) on
+// stdin/stdout, live view frames go to a shared memory ring.
+//
+//   MultiCamCui --machine [--ring <name>]
+
+bool IsMachineMode(int argc, char *argv[]);
+int RunMachineMode(int argc, char *argv[]);
@@ -0,0 +1,676 @@
+﻿#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EDSDK.h"
+#include "EDSDKTypes.h"
+#include "CameraModel.h"
+#include "FileControl.h"
+#include "MachineMode.h"
+#include "ipc/FrameProtocol.h"
+#include "ipc/SharedFrameRing.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace photobooth::ipc;
+
+namespace
+{
+	// EDSDK events are delivered from EdsGetEvent, so the main loop wakes at
+	// least this often even when no request is pending.
+	constexpr auto EVENT_PUMP_INTERVAL = std::chrono::milliseconds(10);
+
+	struct MachineCamera
+	{
+		CameraModel *model;
+		bool opened;
+		bool liveView;
+		std::string port; // EdsDeviceInfo::szPortName, stable across processes
+	};
+
+	std::vector<MachineCamera> _cameras;
+	SharedFrameRing _ring;
+
+	std::mutex _outputMutex;
+	std::mutex _queueMutex;
+	std::condition_variable _queueCond;
+	std::deque<Frame> _requests;
+	std::atomic<bool> _inputClosed(false);
+
+	void WriteFrame(MessageType type, Opcode opcode, uint32_t correlationId, uint32_t status, const std::vector<uint8_t> &payload)
+	{
+		std::vector<uint8_t> buffer = encodeFrame(type, opcode, correlationId, status, payload);
+
+		std::lock_guard<std::mutex> lock(_outputMutex);
+		fwrite(buffer.data(), 1, buffer.size(), stdout);
+		fflush(stdout);
+	}
+
+	bool ReadExact(void *dst, size_t size)
+	{
+		uint8_t *p = static_cast<uint8_t *>(dst);
+		while (size > 0)
+		{
+			size_t n = fread(p, 1, size, stdin);
+			if (n == 0)
+			{
+				return false;
+			}
+			p += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	// Blocks on stdin so the main thread is free to pump EdsGetEvent.
+	// All SDK calls stay on the main thread.
+	void InputThread()
+	{
+		while (true)
+		{
+			Frame frame;
+			if (!ReadExact(&frame.header, sizeof(frame.header)))
+			{
+				break;
+			}
+			if (!isValidHeader(frame.header))
+			{
+				std::cerr << "machine: invalid frame header" << std::endl;
+				break;
+			}
+			frame.payload.resize(frame.header.payloadLength);
+			if (!frame.payload.empty() && !ReadExact(frame.payload.data(), frame.payload.size()))
+			{
+				break;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(_queueMutex);
+				_requests.push_back(std::move(frame));
+			}
+			_queueCond.notify_one();
+		}
+
+		// Parent went away
+		_inputClosed = true;
+		_queueCond.notify_one();
+	}
+
+	EdsUInt32 BodyIDFromContext(EdsVoid *context)
+	{
+		return (EdsUInt32)(uintptr_t)context;
+	}
+
+	MachineCamera *FindCamera(EdsUInt32 bodyID)
+	{
+		for (auto &camera : _cameras)
+		{
+			if (camera.model->getbodyID() == bodyID)
+			{
+				return &camera;
+			}
+		}
+		return nullptr;
+	}
+
+	MachineCamera *FindCameraByPort(const std::string &port)
+	{
+		for (auto &camera : _cameras)
+		{
+			if (camera.port == port)
+			{
+				return &camera;
+			}
+		}
+		return nullptr;
+	}
+
+	bool AnyCameraOpened()
+	{
+		for (auto &camera : _cameras)
+		{
+			if (camera.opened)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	EdsError EDSCALLBACK MachineObjectEvent(EdsObjectEvent event, EdsBaseRef object, EdsVoid *context)
+	{
+		if (event == kEdsObjectEvent_DirItemRequestTransfer)
+		{
+			EdsUInt32 bodyID = BodyIDFromContext(context);
+			EdsDirectoryItemInfo dirItemInfo;
+			std::string path;
+
+			EdsError err = EdsGetDirectoryItemInfo(object, &dirItemInfo);
+			if (err == EDS_ERR_OK)
+			{
+				err = downloadImage(object, context);
+			}
+			if (err == EDS_ERR_OK)
+			{
+				path = (fs::absolute("cam" + std::to_string(bodyID)) / dirItemInfo.szFileName).string();
+			}
+
+			PayloadWriter payload;
+			payload.u32(bodyID).str(path);
+			WriteFrame(MessageType::Event, Opcode::CaptureComplete, 0, err, payload.data());
+		}
+
+		if (object)
+		{
+			EdsRelease(object);
+		}
+		return EDS_ERR_OK;
+	}
+
+	EdsError EDSCALLBACK MachinePropertyEvent(EdsUInt32 inEvent, EdsUInt32 inPropertyID, EdsUInt32 inParam, EdsVoid *inContext)
+	{
+		if (inEvent == kEdsPropertyEvent_PropertyChanged || inEvent == kEdsPropertyEvent_PropertyDescChanged)
+		{
+			PayloadWriter payload;
+			payload.u32(BodyIDFromContext(inContext)).u32(inPropertyID).u32(inEvent);
+			WriteFrame(MessageType::Event, Opcode::PropertyChanged, 0, STATUS_OK, payload.data());
+		}
+		return EDS_ERR_OK;
+	}
+
+	EdsError EDSCALLBACK MachineStateEvent(EdsStateEvent event, EdsUInt32 parameter, EdsVoid *context)
+	{
+		if (event == kEdsStateEvent_Shutdown)
+		{
+			EdsUInt32 bodyID = BodyIDFromContext(context);
+			MachineCamera *camera = FindCamera(bodyID);
+			if (camera)
+			{
+				camera->opened = false;
+				camera->liveView = false;
+			}
+
+			PayloadWriter payload;
+			payload.u32(bodyID);
+			WriteFrame(MessageType::Event, Opcode::CameraRemoved, 0, STATUS_OK, payload.data());
+		}
+		return EDS_ERR_OK;
+	}
+
+	// Re-enumerate. Only done while no session is open, so bodyIDs stay
+	// stable for the lifetime of a session.
+	EdsError RefreshCameras()
+	{
+		for (auto &camera : _cameras)
+		{
+			EdsRelease(camera.model->getCameraObject());
+			delete camera.model;
+		}
+		_cameras.clear();
+
+		EdsCameraListRef cameraList = NULL;
+		EdsUInt32 count = 0;
+
+		EdsError err = EdsGetCameraList(&cameraList);
+		if (err == EDS_ERR_OK)
+		{
+			err = EdsGetChildCount(cameraList, &count);
+		}
+
+		for (EdsUInt32 i = 0; err == EDS_ERR_OK && i < count; i++)
+		{
+			EdsCameraRef camera = NULL;
+			EdsDeviceInfo deviceInfo;
+
+			err = EdsGetChildAtIndex(cameraList, i, &camera);
+			if (err == EDS_ERR_OK)
+			{
+				err = EdsGetDeviceInfo(camera, &deviceInfo);
+			}
+			if (err == EDS_ERR_OK)
+			{
+				CameraModel *model = new CameraModel(camera, i + 1, kEdsSaveTo_Host);
+				model->setModelName(deviceInfo.szDeviceDescription);
+				_cameras.push_back({model, false, false, deviceInfo.szPortName});
+			}
+		}
+
+		if (cameraList != NULL)
+		{
+			EdsRelease(cameraList);
+		}
+		return err;
+	}
+
+	EdsError OpenCamera(MachineCamera &camera)
+	{
+		if (camera.opened)
+		{
+			return EDS_ERR_OK;
+		}
+
+		EdsCameraRef cameraref = camera.model->getCameraObject();
+		EdsVoid *context = (EdsVoid *)(uintptr_t)camera.model->getbodyID();
+
+		EdsError err = EdsSetPropertyEventHandler(cameraref, kEdsPropertyEvent_All, MachinePropertyEvent, context);
+		if (err == EDS_ERR_OK)
+		{
+			err = EdsSetObjectEventHandler(cameraref, kEdsObjectEvent_All, MachineObjectEvent, context);
+		}
+		if (err == EDS_ERR_OK)
+		{
+			err = EdsSetCameraStateEventHandler(cameraref, kEdsStateEvent_All, MachineStateEvent, context);
+		}
+		if (err == EDS_ERR_OK)
+		{
+			// Report the failure instead of marking an unusable body as open
+			if (camera.model->OpenSessionCommand())
+			{
+				camera.opened = true;
+			}
+			else
+			{
+				// The session may have opened before a later step failed
+				camera.model->CloseSessionCommand();
+				err = EDS_ERR_SESSION_NOT_OPEN;
+			}
+		}
+		return err;
+	}
+
+	EdsError CloseCamera(MachineCamera &camera)
+	{
+		if (camera.liveView)
+		{
+			camera.model->EndEvfCommand();
+			camera.liveView = false;
+		}
+		if (camera.opened)
+		{
+			camera.model->CloseSessionCommand();
+			camera.opened = false;
+		}
+		return EDS_ERR_OK;
+	}
+
+	EdsError StartLiveView(MachineCamera &camera)
+	{
+		EdsCameraRef cameraref = camera.model->getCameraObject();
+		EdsUInt32 device = 0;
+
+		camera.model->StartEvfCommand();
+
+		EdsError err = EdsGetPropertyData(cameraref, kEdsPropID_Evf_OutputDevice, 0, sizeof(device), &device);
+		if (err == EDS_ERR_OK)
+		{
+			device |= kEdsEvfOutputDevice_PC;
+			err = EdsSetPropertyData(cameraref, kEdsPropID_Evf_OutputDevice, 0, sizeof(device), &device);
+		}
+		camera.liveView = (err == EDS_ERR_OK);
+		return err;
+	}
+
+	// Download one EVF JPEG into memory and publish it in the ring
+	EdsError GrabLiveViewFrame(MachineCamera &camera, uint64_t &sequence)
+	{
+		EdsStreamRef stream = NULL;
+		EdsEvfImageRef evfImage = NULL;
+		sequence = 0;
+
+		EdsError err = EdsCreateMemoryStream(0, &stream);
+		if (err == EDS_ERR_OK)
+		{
+			err = EdsCreateEvfImageRef(stream, &evfImage);
+		}
+		if (err == EDS_ERR_OK)
+		{
+			err = EdsDownloadEvfImage(camera.model->getCameraObject(), evfImage);
+		}
+		if (err == EDS_ERR_OK)
+		{
+			EdsVoid *data = NULL;
+			EdsUInt64 length = 0;
+			EdsGetPointer(stream, &data);
+			EdsGetLength(stream, &length);
+			sequence = _ring.write(static_cast<const uint8_t *>(data), (uint32_t)length, camera.model->getbodyID());
+			if (sequence == 0)
+			{
+				err = EDS_ERR_MEM_ALLOC_FAILED;
+			}
+		}
+
+		if (evfImage != NULL)
+		{
+			EdsRelease(evfImage);
+		}
+		if (stream != NULL)
+		{
+			EdsRelease(stream);
+		}
+		return err;
+	}
+
+	// Run fn on the addressed camera, or every opened camera for bodyID 0
+	template <typename Fn>
+	uint32_t ForEachCamera(EdsUInt32 bodyID, bool requireOpened, Fn fn)
+	{
+		uint32_t status = STATUS_NO_CAMERA;
+		for (auto &camera : _cameras)
+		{
+			if (bodyID != 0 && camera.model->getbodyID() != bodyID)
+			{
+				continue;
+			}
+			if (requireOpened && !camera.opened)
+			{
+				continue;
+			}
+			EdsError err = fn(camera);
+			if (status == STATUS_NO_CAMERA || status == STATUS_OK)
+			{
+				status = err;
+			}
+		}
+		return status;
+	}
+
+	// Requests that read back a value address exactly one opened camera
+	MachineCamera *SingleCamera(EdsUInt32 bodyID)
+	{
+		MachineCamera *camera = FindCamera(bodyID);
+		return (camera && camera->opened) ? camera : nullptr;
+	}
+
+	void HandleRequest(const Frame &request, bool &running)
+	{
+		PayloadReader reader(request.payload);
+		PayloadWriter response;
+		uint32_t status = STATUS_OK;
+		EdsUInt32 bodyID = 0;
+		EdsUInt32 propertyID = 0;
+		EdsUInt32 value = 0;
+
+		switch (request.opcode())
+		{
+		case Opcode::Ping:
+			break;
+
+		case Opcode::ListCameras:
+		{
+			if (!AnyCameraOpened())
+			{
+				status = RefreshCameras();
+			}
+			response.u32((uint32_t)_cameras.size());
+			for (auto &camera : _cameras)
+			{
+				response.str(camera.model->getModelName()).str(camera.port);
+			}
+			break;
+		}
+
+		case Opcode::OpenSessionByPort:
+		{
+			// Body IDs follow enumeration order, which differs between
+			// processes and after a replug; the port name does not
+			std::string port;
+			if (!reader.str(port))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			MachineCamera *camera = FindCameraByPort(port);
+			if (!camera && !AnyCameraOpened())
+			{
+				RefreshCameras();
+				camera = FindCameraByPort(port);
+			}
+			if (!camera)
+			{
+				status = STATUS_NO_CAMERA;
+				break;
+			}
+			status = OpenCamera(*camera);
+			response.u32(camera->model->getbodyID());
+			break;
+		}
+
+		case Opcode::OpenSession:
+			if (!reader.u32(bodyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, false, OpenCamera);
+			break;
+
+		case Opcode::CloseSession:
+			if (!reader.u32(bodyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, true, CloseCamera);
+			break;
+
+		case Opcode::TakePicture:
+			if (!reader.u32(bodyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			// The file arrives later as a CaptureComplete event
+			status = ForEachCamera(bodyID, true, [](MachineCamera &camera) {
+				return camera.model->TakePicture(kEdsCameraCommand_ShutterButton_Completely_NonAF);
+			});
+			break;
+
+		case Opcode::PressShutter:
+			if (!reader.u32(bodyID) || !reader.u32(value))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, true, [value](MachineCamera &camera) {
+				return camera.model->PressShutter(value);
+			});
+			break;
+
+		case Opcode::SetProperty:
+			if (!reader.u32(bodyID) || !reader.u32(propertyID) || !reader.u32(value))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, true, [propertyID, value](MachineCamera &camera) {
+				return camera.model->SetPropertyValue(propertyID, &value);
+			});
+			break;
+
+		case Opcode::GetProperty:
+		{
+			if (!reader.u32(bodyID) || !reader.u32(propertyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			MachineCamera *camera = SingleCamera(bodyID);
+			if (!camera)
+			{
+				status = STATUS_NO_CAMERA;
+				break;
+			}
+			status = EdsGetPropertyData(camera->model->getCameraObject(), propertyID, 0, sizeof(value), &value);
+			response.u32(value);
+			break;
+		}
+
+		case Opcode::GetPropertyDesc:
+		{
+			if (!reader.u32(bodyID) || !reader.u32(propertyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			MachineCamera *camera = SingleCamera(bodyID);
+			if (!camera)
+			{
+				status = STATUS_NO_CAMERA;
+				break;
+			}
+			EdsPropertyDesc desc = {0};
+			status = EdsGetPropertyDesc(camera->model->getCameraObject(), propertyID, &desc);
+			response.u32(status == EDS_ERR_OK ? (uint32_t)desc.numElements : 0);
+			for (EdsInt32 i = 0; status == EDS_ERR_OK && i < desc.numElements; i++)
+			{
+				response.i32(desc.propDesc[i]);
+			}
+			break;
+		}
+
+		case Opcode::StartLiveView:
+			if (!reader.u32(bodyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, true, StartLiveView);
+			break;
+
+		case Opcode::StopLiveView:
+			if (!reader.u32(bodyID))
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			status = ForEachCamera(bodyID, true, [](MachineCamera &camera) {
+				camera.model->EndEvfCommand();
+				camera.liveView = false;
+				return (EdsError)EDS_ERR_OK;
+			});
+			break;
+
+		case Opcode::GrabLiveViewFrame:
+		{
+			if (!reader.u32(bodyID) || !_ring.isOpen())
+			{
+				status = STATUS_BAD_REQUEST;
+				break;
+			}
+			MachineCamera *camera = SingleCamera(bodyID);
+			if (!camera || !camera->liveView)
+			{
+				status = STATUS_NO_CAMERA;
+				break;
+			}
+			uint64_t sequence = 0;
+			status = GrabLiveViewFrame(*camera, sequence);
+			response.u64(sequence);
+			break;
+		}
+
+		case Opcode::Shutdown:
+			running = false;
+			break;
+
+		default:
+			status = STATUS_BAD_REQUEST;
+			break;
+		}
+
+		WriteFrame(MessageType::Response, request.opcode(), request.header.correlationId, status, response.data());
+	}
+}
+
+bool IsMachineMode(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--machine")
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int RunMachineMode(int argc, char *argv[])
+{
+	std::string ringName;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--ring")
+		{
+			ringName = argv[i + 1];
+		}
+	}
+
+	// stdout carries frames only; the sample's console logging goes to stderr
+	std::cout.rdbuf(std::cerr.rdbuf());
+#ifdef _WIN32
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	if (!ringName.empty() && !_ring.open(ringName))
+	{
+		std::cerr << "machine: live view ring unavailable, frames disabled" << std::endl;
+	}
+
+	EdsError err = EdsInitializeSDK();
+	if (err != EDS_ERR_OK)
+	{
+		std::cerr << "machine: EdsInitializeSDK failed " << std::hex << err << std::endl;
+		return EXIT_FAILURE;
+	}
+	RefreshCameras();
+
+	std::thread input(InputThread);
+	input.detach();
+
+	bool running = true;
+	while (running)
+	{
+		std::deque<Frame> batch;
+		{
+			std::unique_lock<std::mutex> lock(_queueMutex);
+			_queueCond.wait_for(lock, EVENT_PUMP_INTERVAL, [] { return !_requests.empty() || _inputClosed; });
+			batch.swap(_requests);
+			if (batch.empty() && _inputClosed)
+			{
+				running = false;
+			}
+		}
+
+		for (const Frame &request : batch)
+		{
+			if (running)
+			{
+				HandleRequest(request, running);
+			}
+		}
+
+		EdsGetEvent();
+	}
+
+	for (auto &camera : _cameras)
+	{
+		CloseCamera(camera);
+		EdsRelease(camera.model->getCameraObject());
+		delete camera.model;
+	}
+	_cameras.clear();
+	_ring.close();
+
+	EdsTerminateSDK();
+	return EXIT_SUCCESS;
+}
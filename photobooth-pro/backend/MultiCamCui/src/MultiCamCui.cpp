@@ -13,6 +13,7 @@
 #include "Property.h"
 #include "CameraModel.h"
 #include "utility.h"
+#include "MachineMode.h"
 
 static std::string control_number = "";
 static bool keyflag;
@@ -26,8 +27,14 @@ void CheckKey() // After key is entered, _ endthread is automatically called.
 	keyflag = true;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	// Driven by ProcessManager over stdin/stdout instead of the menu
+	if (IsMachineMode(argc, argv))
+	{
+		return RunMachineMode(argc, argv);
+	}
+
 	EdsError err = EDS_ERR_OK;
 	EdsCameraListRef cameraList = NULL;
 	EdsCameraRef camera;
@@ -2,7 +2,10 @@
 
 #include <string>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
 
@@ -15,6 +18,8 @@ namespace httplib {
 namespace photobooth {
 
 class Application;
+class ComposeSession;
+class VideoRecorder;
 
 class HTTPServer {
 public:
@@ -34,6 +39,29 @@ private:
     std::unique_ptr<std::thread> serverThread_;
     std::unique_ptr<httplib::Server> server_;
 
+    // Strips being composed while the guest shoots, by session id
+    std::map<std::string, std::shared_ptr<ComposeSession>> composeSessions_;
+    std::mutex composeSessionsMutex_;
+
+    std::shared_ptr<ComposeSession> findComposeSession(const std::string& id);
+
+    // Forget submitted sessions, cancel idle ones and evict the least recently
+    // used when full, so a new one fits; caller holds composeSessionsMutex_
+    void pruneComposeSessionsLocked();
+
+    // Video being recorded from the live view stream, if any
+    std::unique_ptr<VideoRecorder> videoRecorder_;
+    std::mutex videoRecorderMutex_;
+
+    // Detach the recorder from the camera and finish its last segment
+    std::unique_ptr<VideoRecorder> releaseVideoRecorder();
+
+    // GIF encodes running on their own threads; stop() waits for them so
+    // no file is left truncated
+    int gifJobs_ = 0;
+    std::mutex gifJobsMutex_;
+    std::condition_variable gifJobsDone_;
+
     void setupRoutes();
     void run();
 
@@ -65,8 +93,10 @@ private:
     void handleCapture(const httplib::Request& req, httplib::Response& res);
     void handleCaptureGif(const httplib::Request& req, httplib::Response& res);
     void handleCaptureBoomerang(const httplib::Request& req, httplib::Response& res);
+    void handleStreamGif(const httplib::Request& req, httplib::Response& res, bool boomerang);
     void handleStartVideo(const httplib::Request& req, httplib::Response& res);
     void handleStopVideo(const httplib::Request& req, httplib::Response& res);
+    void handleGetVideoStatus(const httplib::Request& req, httplib::Response& res);
 
     // ==================== Gallery API ====================
     void handleGetGallery(const httplib::Request& req, httplib::Response& res);
@@ -95,6 +125,11 @@ private:
     // ==================== Layout API ====================
     void handleAnalyzeLayout(const httplib::Request& req, httplib::Response& res);
     void handleComposePhotos(const httplib::Request& req, httplib::Response& res);
+    void handleComposePreview(const httplib::Request& req, httplib::Response& res);
+    void handleCreateComposeSession(const httplib::Request& req, httplib::Response& res);
+    void handleAddComposeSessionPhoto(const httplib::Request& req, httplib::Response& res);
+    void handleGetComposeSession(const httplib::Request& req, httplib::Response& res);
+    void handleDeleteComposeSession(const httplib::Request& req, httplib::Response& res);
     void handleGetLayoutSlots(const httplib::Request& req, httplib::Response& res);
     void handleSaveLayoutConfig(const httplib::Request& req, httplib::Response& res);
 
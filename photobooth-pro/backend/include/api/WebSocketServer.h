@@ -41,6 +41,8 @@
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
 
+#include "camera/CameraManager.h"
+
 namespace photobooth {
 
 class Application;
@@ -61,6 +63,8 @@ public:
   void broadcastEvent(const std::string &eventType, const std::string &data);
   void broadcastCountdown(int seconds);
   void broadcastCaptureComplete(const std::string &imagePath);
+  void broadcastPropertyChange(const PropertyChange &change);
+  void broadcastCameraList(const std::vector<CameraInfo> &cameras);
 
   // Live view streaming
   void startLiveViewBroadcast();
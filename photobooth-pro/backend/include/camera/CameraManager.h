@@ -3,8 +3,11 @@
 #include "ICamera.h"
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace photobooth {
@@ -17,21 +20,31 @@ struct CameraInfo {
   int webcamIndex; // Only for webcams
 };
 
+using CameraListCallback =
+    std::function<void(const std::vector<CameraInfo> &)>;
+
 class CameraManager {
 public:
   CameraManager();
   ~CameraManager();
 
-  // Camera discovery
+  // Camera discovery. initialize() returns immediately; a background thread
+  // keeps the device registry current (EDSDK camera-added events, Shutdown
+  // state events, /dev hot-plug on Linux) and re-selects the active camera
+  // when it is plugged back in.
   bool initialize();
   void shutdown();
   std::vector<std::string> detectCameras();
   std::vector<CameraInfo> getAvailableCameras() const;
+  void requestRescan();
+  void setCameraListCallback(CameraListCallback callback);
 
   // Camera selection
   bool selectCamera(const std::string &cameraName);
   bool selectWebcam(int deviceIndex);
-  ICamera *getActiveCamera();
+  // Shared so a request thread can keep using the camera while the discovery
+  // thread releases it after an unplug
+  std::shared_ptr<ICamera> getActiveCamera() const;
   std::string getActiveCameraName() const;
 
   // MJPEG streaming (production live view)
@@ -40,6 +53,11 @@ public:
   bool isMjpegStreaming() const;
   bool waitForFrame(std::vector<uint8_t> &frame, int timeoutMs);
 
+  // Extra consumer of every streamed frame (video recording). Called on the
+  // camera thread, so it must only queue the frame; nullptr removes it and
+  // no call is in flight once this returns.
+  void setFrameSink(LiveViewCallback sink);
+
   // Quick access methods (delegates to active camera)
   bool startLiveView(LiveViewCallback callback);
   void stopLiveView();
@@ -53,11 +71,15 @@ public:
   std::vector<std::string> getSupportedShutterSpeeds() const;
   std::vector<std::string> getSupportedWhiteBalances() const;
 
+  // Property change feed; survives camera re-selection
+  void setPropertyChangeCallback(PropertyChangeCallback callback);
+
 private:
   std::vector<std::unique_ptr<ICamera>> cameras_;
-  ICamera *activeCamera_;
-  std::mutex mutex_;
+  std::shared_ptr<ICamera> activeCamera_;
+  mutable std::mutex mutex_;
   bool initialized_;
+  PropertyChangeCallback propertyChangeCallback_;
 
   // Frame buffer for streaming
   std::vector<uint8_t> latestFrame_;
@@ -66,10 +88,39 @@ private:
   uint64_t frameSeq_{0};
   std::atomic<bool> mjpegStreaming_{false};
   std::atomic<int> streamClients_{0};
+  LiveViewCallback frameSink_;
+  std::mutex frameSinkMutex_;
 
   // Shared Memory for IPC (Electron)
   std::unique_ptr<SharedMemoryManager> sharedMemory_;
 
+  // Device registry, owned by the discovery thread
+  std::vector<CameraInfo> registry_;
+  mutable std::mutex registryMutex_;
+  std::string activeCameraName_;  // Device description of activeCamera_
+  std::string preferredCamera_;   // Re-selected when it reappears
+  CameraListCallback cameraListCallback_;
+
+  std::thread discoveryThread_;
+  std::mutex discoveryMutex_;
+  std::condition_variable discoveryCV_;
+  std::atomic<bool> discoveryRunning_{false};
+  bool rescanRequested_ = false;
+  bool activeCameraLost_ = false;
+
+#ifdef __linux__
+  std::thread hotplugThread_;
+  void hotplugWatchLoop();
+#endif
+
+  void discoveryLoop();
+  bool refreshRegistry();
+  void releaseLostCamera();
+  void onActiveCameraLost();
+  void notifyCameraList();
+  bool openCamera(const std::string &cameraName);
+  void pushStreamFrame(const std::vector<uint8_t> &data, int w, int h);
+
   void detectCanonCameras();
   void detectWebcams();
 };
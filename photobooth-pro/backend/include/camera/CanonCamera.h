@@ -2,7 +2,9 @@
 
 #include "EDSDK.h"
 #include "ICamera.h"
+#include "PropertyCache.h"
 #include <atomic>
+#include <mutex>
 #include <thread>
 
 namespace photobooth {
@@ -35,10 +37,16 @@ public:
   std::vector<std::string> getSupportedShutterSpeeds() const override;
   std::vector<std::string> getSupportedWhiteBalances() const override;
 
+  void setPropertyChangeCallback(PropertyChangeCallback callback) override;
+
+  // Invoked (on the EDSDK event thread) when the body is unplugged or
+  // switched off. The session is already gone at that point.
+  void setDisconnectCallback(std::function<void()> callback);
+
 private:
   EdsCameraRef camera_;
   std::string name_;
-  bool connected_;
+  std::atomic<bool> connected_;
   int lockCount_ = 0; // Track UI lock state
 
   // Live view
@@ -50,6 +58,14 @@ private:
   CaptureCallback captureCallback_;
   CameraSettings settings_;
 
+  // Property values/descriptors, kept current by handlePropertyEvent
+  PropertyCache propertyCache_;
+  PropertyChangeCallback propertyChangeCallback_;
+  std::mutex propertyCallbackMutex_;
+  void notifyPropertyChange(EdsPropertyID propertyID, bool optionsChanged);
+
+  std::function<void()> disconnectCallback_;
+
   // Production-grade Helper methods (derived from CameraModel.cpp)
   void liveViewLoop();
   bool downloadImage(EdsDirectoryItemRef dirItem, CaptureResult &result);
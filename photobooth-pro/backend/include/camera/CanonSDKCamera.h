@@ -3,6 +3,7 @@
 #include "ICamera.h"
 #include "CameraModel.h"
 #include "Property.h"
+#include "PropertyCache.h"
 #include <memory>
 #include <atomic>
 #include <thread>
@@ -121,6 +122,7 @@ private:
     std::mutex mutex_;
 
     CanonCameraSettings extendedSettings_;
+    PropertyCache propertyCache_;
     std::string saveDirectory_ = "data/captures";
     std::string lastCapturedPath_;
 
@@ -30,9 +30,19 @@ struct CaptureResult {
   std::string errorMessage;
 };
 
+// Pushed when the camera reports a new value or a new set of allowed values
+// for one of the CameraSettings properties (e.g. dial turned on the body)
+struct PropertyChange {
+  std::string property; // "iso", "aperture", "shutterSpeed", "whiteBalance"
+  std::string value;
+  std::vector<std::string> options; // Only filled when optionsChanged
+  bool optionsChanged = false;
+};
+
 using LiveViewCallback =
     std::function<void(const std::vector<uint8_t> &, int width, int height)>;
 using CaptureCallback = std::function<void(const CaptureResult &)>;
+using PropertyChangeCallback = std::function<void(const PropertyChange &)>;
 
 class ICamera {
 public:
@@ -64,6 +74,9 @@ public:
   virtual std::vector<std::string> getSupportedApertures() const = 0;
   virtual std::vector<std::string> getSupportedShutterSpeeds() const = 0;
   virtual std::vector<std::string> getSupportedWhiteBalances() const = 0;
+
+  // Property change feed (cameras without property events ignore it)
+  virtual void setPropertyChangeCallback(PropertyChangeCallback callback) {}
 };
 
 } // namespace photobooth
@@ -1,26 +1,41 @@
 #pragma once
 
+#include "ipc/FrameProtocol.h"
+#include "ipc/SharedFrameRing.h"
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/types.h>
 #endif
 
 namespace photobooth {
 
 /**
  * ProcessManager - Manages MultiCamCui.exe process communication
- * Uses Canon SDK official sample (MultiCamCui) as external process
- * Communicates via stdin/stdout using command protocol
+ * Uses Canon SDK official sample (MultiCamCui) as external process, started
+ * with --machine. Requests and responses are binary frames
+ * (ipc/FrameProtocol.h) over stdin/stdout; live view JPEGs come back through
+ * a shared memory ring instead of temp files. A reader thread parses the
+ * child's stdout and hands responses to the waiting caller by correlation id.
+ * Uses CreateProcess on Windows and fork/exec elsewhere.
  */
 class ProcessManager {
 public:
+  static constexpr int DEFAULT_TIMEOUT_MS = 5000;
+  static constexpr int STARTUP_TIMEOUT_MS = 10000;
+
   ProcessManager(const std::string &executablePath);
   ~ProcessManager();
 
@@ -28,38 +43,55 @@ public:
   bool initialize();
   void shutdown();
   bool isRunning() const { return processRunning_; }
+  bool ping(int timeoutMs = DEFAULT_TIMEOUT_MS);
 
   // Camera detection & selection
+  struct CameraEntry {
+    std::string name;
+    std::string port; // Stable identity; body IDs are enumeration order
+  };
+  std::vector<CameraEntry> listCameras();
   std::vector<std::string> detectCameras();
-  bool selectCamera(int cameraIndex); // 1-based index
+  bool selectCamera(int cameraIndex); // 1-based body ID
+  bool selectCameraByPort(const std::string &port);
   bool selectCameraRange(int startIndex, int endIndex);
   bool selectAllCameras();
 
   // Live View commands
-  bool startLiveView();                    // Command 21
-  bool stopLiveView();                     // Command 22
-  std::vector<uint8_t> getLiveViewFrame(); // Command 20 - Get one frame
-
-  // Capture commands
-  bool takePicture();     // Command 3 - Take picture and download
-  bool pressHalfway();    // Command 4
-  bool pressCompletely(); // Command 5
-  bool pressOff();        // Command 6
-
-  // Settings commands
-  bool setSaveTo(int option);        // Command 1
-  bool setImageQuality(int quality); // Command 2
-  bool setTV(int value);             // Command 7
-  bool setAV(int value);             // Command 8
-  bool setISO(int value);            // Command 9
-
-  // Raw command execution
-  std::string executeCommand(const std::string &command);
+  bool startLiveView();
+  bool stopLiveView();
+  std::vector<uint8_t> getLiveViewFrame(); // Latest JPEG, empty if none
+
+  // Capture commands. The saved file is reported by a CaptureComplete event.
+  bool takePicture();
+  bool pressHalfway();
+  bool pressCompletely();
+  bool pressOff();
+
+  // Settings commands (EDSDK property values)
+  bool setSaveTo(int option);
+  bool setImageQuality(int quality);
+  bool setTV(int value);
+  bool setAV(int value);
+  bool setISO(int value);
+  bool setProperty(uint32_t propertyID, uint32_t value);
+  bool getProperty(uint32_t propertyID, uint32_t &value);
+
+  // Raw request. Returns false if the child did not answer in time; the
+  // camera result is in response.header.status. Safe to call from several
+  // threads, the child serves requests in order.
+  bool sendRequest(ipc::Opcode opcode, const std::vector<uint8_t> &payload,
+                   ipc::Frame &response, int timeoutMs = DEFAULT_TIMEOUT_MS);
 
   // Frame callback for live view streaming
   using FrameCallback = std::function<void(const std::vector<uint8_t> &)>;
   void setFrameCallback(FrameCallback callback) { frameCallback_ = callback; }
 
+  // Unsolicited child events (capture complete, camera removed, ...).
+  // Called on the reader thread.
+  using EventCallback = std::function<void(const ipc::Frame &)>;
+  void setEventCallback(EventCallback callback) { eventCallback_ = callback; }
+
 private:
   std::string executablePath_;
 
@@ -69,24 +101,48 @@ private:
   HANDLE hChildStdOutWr_ = NULL;
   HANDLE hChildStdOutRd_ = NULL;
   PROCESS_INFORMATION processInfo_;
+#else
+  pid_t childPid_ = -1;
+  int childStdIn_ = -1;
+  int childStdOut_ = -1;
 #endif
 
   std::atomic<bool> processRunning_{false};
   std::mutex processMutex_;
+  std::mutex writeMutex_; // Keeps request frames whole on the pipe
+
+  // Reader thread -> callers
+  std::thread readerThread_;
+  std::mutex responseMutex_;
+  std::condition_variable responseCond_;
+  std::set<uint32_t> waiting_;
+  std::map<uint32_t, ipc::Frame> responses_;
 
   FrameCallback frameCallback_;
+  EventCallback eventCallback_;
+
+  std::atomic<uint32_t> nextCorrelationId_{1};
+  uint32_t activeBodyID_ = 0;   // 0 = every opened camera
+  uint32_t primaryBodyID_ = 1;  // Live view and reads address one body
+
+  ipc::SharedFrameRing frameRing_;
+  uint64_t lastFrameSequence_ = 0;
 
   // Process management
   bool createProcess();
   void cleanupProcess();
+  void stopReader();
 
   // I/O operations
-  bool writeToStdin(const std::string &data);
-  std::string readFromStdout(size_t maxBytes = 4096, int timeoutMs = 1000);
+  bool writeToStdin(const std::vector<uint8_t> &data);
+  bool readExact(void *dst, size_t size); // Blocking, reader thread only
+  bool readFrame(ipc::Frame &frame);
+  void readerLoop();
 
   // Command helpers
-  std::string sendCommand(const std::string &command);
-  bool waitForPrompt(const std::string &prompt, int timeoutMs = 5000);
+  bool sendBodyCommand(ipc::Opcode opcode, uint32_t argument = 0,
+                       bool hasArgument = false);
+  bool openSessions(uint32_t firstBodyID, uint32_t lastBodyID);
 };
 
 } // namespace photobooth
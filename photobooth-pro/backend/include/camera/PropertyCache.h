@@ -0,0 +1,50 @@
+#pragma once
+
+#include "EDSDK.h"
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace photobooth {
+
+// Host-side copy of camera property values and their allowed values
+// (EdsPropertyDesc). Primed once after the session opens and refreshed from
+// the EDSDK property event handler, so settings reads never go to the camera.
+class PropertyCache {
+public:
+  PropertyCache() = default;
+
+  void setCamera(EdsCameraRef camera);
+  void clear();
+
+  // Read value and descriptor for each property from the camera
+  void prime(const std::vector<EdsPropertyID> &propertyIDs);
+
+  // Re-read from the camera. Returns true if the cached entry changed.
+  bool refreshValue(EdsPropertyID propertyID);
+  bool refreshDesc(EdsPropertyID propertyID);
+
+  // Record a value that was just written successfully. Returns true if it
+  // differs from the cached one.
+  bool storeValue(EdsPropertyID propertyID, EdsUInt32 value);
+
+  // Cached reads. A cold miss falls through to the camera once.
+  bool getValue(EdsPropertyID propertyID, EdsUInt32 &value) const;
+  std::vector<EdsInt32> getDesc(EdsPropertyID propertyID) const;
+
+private:
+  EdsCameraRef camera_ = nullptr;
+  mutable std::mutex mutex_;
+  mutable std::map<EdsPropertyID, EdsUInt32> values_;
+  mutable std::map<EdsPropertyID, std::vector<EdsInt32>> descs_;
+
+  EdsCameraRef camera() const;
+
+  // Camera round-trips; called without mutex_ held
+  static bool fetchValue(EdsCameraRef camera, EdsPropertyID propertyID,
+                         EdsUInt32 &value);
+  static bool fetchDesc(EdsCameraRef camera, EdsPropertyID propertyID,
+                        std::vector<EdsInt32> &desc);
+};
+
+} // namespace photobooth
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "camera/ProcessManager.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * WorkerSupervisor - One MultiCamCui worker process per camera body
+ * Each body gets its own ProcessManager, so bodies capture in parallel and a
+ * hung EDSDK call only stalls its own worker. A monitor thread pings every
+ * worker and restarts dead or unresponsive ones with exponential backoff.
+ * Workers are bound to a body by its port name, not by enumeration order, so
+ * a restarted worker reopens the same camera. Body IDs here are assigned once
+ * in start() and stay fixed; events are rewritten to carry them.
+ */
+class WorkerSupervisor {
+public:
+  static constexpr int HEALTH_CHECK_INTERVAL_MS = 2000;
+  static constexpr int HEALTH_CHECK_TIMEOUT_MS = 1500;
+  static constexpr int INITIAL_BACKOFF_MS = 500;
+  static constexpr int MAX_BACKOFF_MS = 30000;
+
+  WorkerSupervisor(const std::string &executablePath);
+  ~WorkerSupervisor();
+
+  // Enumerate bodies and start a worker for each
+  bool start();
+  void stop();
+
+  std::vector<uint32_t> getBodies() const;
+  bool isHealthy(uint32_t bodyID) const;
+
+  // Routed by body ID; bodyID 0 fans out to every body in parallel
+  bool takePicture(uint32_t bodyID = 0);
+  bool startLiveView(uint32_t bodyID = 0);
+  bool stopLiveView(uint32_t bodyID = 0);
+  bool setProperty(uint32_t bodyID, uint32_t propertyID, uint32_t value);
+  std::vector<uint8_t> getLiveViewFrame(uint32_t bodyID);
+
+  // Events from all workers (payload starts with the body ID)
+  using EventCallback = std::function<void(const ipc::Frame &)>;
+  void setEventCallback(EventCallback callback);
+
+private:
+  struct Worker {
+    uint32_t bodyID = 0;
+    std::string port; // Identity the child resolves on every launch
+    std::shared_ptr<ProcessManager> process; // Swapped on restart
+    bool healthy = false;
+    bool cameraLost = false; // Child alive but the body was unplugged
+    bool liveView = false;   // Restored after a restart
+    int failures = 0;
+    std::chrono::steady_clock::time_point nextRestart;
+  };
+
+  std::string executablePath_;
+
+  mutable std::mutex mutex_;
+  std::map<uint32_t, Worker> workers_;
+
+  std::mutex callbackMutex_;
+  EventCallback eventCallback_;
+
+  std::thread monitorThread_;
+  std::mutex monitorMutex_;
+  std::condition_variable monitorCond_;
+  std::atomic<bool> running_{false};
+
+  std::shared_ptr<ProcessManager> launch(uint32_t bodyID,
+                                         const std::string &port);
+  std::shared_ptr<ProcessManager> getProcess(uint32_t bodyID) const;
+  void dispatchEvent(uint32_t bodyID, const ipc::Frame &event);
+  void markFailed(Worker &worker);
+  void monitorLoop();
+
+  template <typename Fn> bool forEachBody(uint32_t bodyID, Fn fn);
+};
+
+} // namespace photobooth
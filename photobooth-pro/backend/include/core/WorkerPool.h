@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * WorkerPool - Shared pool for CPU-heavy background work (compositing)
+ * Sized below the core count and run at below-normal priority by default, so
+ * a compose burst can't starve the live view and EDSDK threads. Tasks must
+ * not wait on other pool tasks.
+ */
+class WorkerPool {
+public:
+    static WorkerPool& getInstance();
+
+    // Restart with a new thread count (0 = run tasks on the caller) and
+    // priority. Queued tasks finish on the old threads first.
+    void configure(size_t threads, bool lowPriority);
+
+    size_t threadCount() const;
+    bool lowPriority() const;
+
+    template <typename Fn>
+    auto submit(Fn fn) -> std::future<decltype(fn())> {
+        using Result = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        std::future<Result> result = task->get_future();
+        if (!enqueue([task]() { (*task)(); })) {
+            (*task)();
+        }
+        return result;
+    }
+
+    // Run fn(0) .. fn(count - 1) on the pool and wait for all of them
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    // Default size: all cores but two, left for live view and the servers
+    static size_t defaultThreadCount();
+
+private:
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // false if there are no workers and the caller should run the task
+    bool enqueue(std::function<void()> task);
+    void start(size_t threads);
+    void stop();
+    void workerLoop();
+
+    std::mutex configMutex_;    // Serializes configure()
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_;
+    bool lowPriority_;
+};
+
+} // namespace photobooth
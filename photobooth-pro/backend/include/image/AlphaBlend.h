@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+
+namespace photobooth {
+
+struct SpanIndex;
+
+namespace blend {
+
+// Layout pixels at or below this alpha are treated as slot holes
+constexpr uint8_t LAYOUT_ALPHA_CUTOFF = 10;
+
+// Row kernels on 8-bit BGRA.
+// premultiplyRow: c = c * a / 255, pixels with a <= cutoff become 0.
+// blendRow: dst = overlay + dst * (255 - a) / 255 with a premultiplied
+// overlay. Fully opaque and fully transparent pixels skip the math.
+void premultiplyRow(uint8_t* bgra, int width, uint8_t cutoff);
+void blendRow(const uint8_t* overlay, uint8_t* dst, int width);
+
+// Premultiplied copy of a BGRA layout, ready for blendOver
+cv::Mat premultiply(const cv::Mat& bgra, uint8_t cutoff = LAYOUT_ALPHA_CUTOFF);
+
+// Composite a premultiplied BGRA overlay onto a BGRA canvas in place,
+// rows split across OpenCV's thread pool
+bool blendOver(const cv::Mat& overlay, cv::Mat& canvas);
+
+// Same result as blendOver, driven by the layout's span index: opaque spans
+// are copied, transparent spans skipped, only partial spans are blended
+bool blendSpans(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& canvas);
+
+// blendSpans restricted to rows [rowBegin, rowEnd), for callers that band
+// the work themselves
+bool blendSpanRows(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& canvas,
+                   int rowBegin, int rowEnd);
+
+// blendSpans onto a horizontal band of the output: band row i is overlay
+// row rowOffset + i
+bool blendSpanBand(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& band,
+                   int rowOffset);
+
+} // namespace blend
+} // namespace photobooth
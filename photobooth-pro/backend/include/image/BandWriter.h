@@ -0,0 +1,37 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+
+namespace photobooth {
+
+/**
+ * BandWriter - Row-incremental image encoder
+ * The compositor hands over the output top to bottom in BGR bands, so only
+ * one band needs to be in memory at a time. JPEG streams through libjpeg when
+ * it is available, TIFF is written as uncompressed RGB strips. Any other
+ * format (or JPEG without libjpeg) buffers the bands and saves with OpenCV.
+ */
+class BandWriter {
+public:
+    virtual ~BandWriter() = default;
+
+    // Writer for outputPath, chosen by extension. JPEG uses the print profile
+    // (JpegUse::Print); jpegQuality > 0 overrides its quality.
+    static std::unique_ptr<BandWriter> create(const std::string& outputPath, int jpegQuality = 0);
+
+    // dpi is stored in the file header (JFIF density / TIFF resolution)
+    virtual bool begin(int width, int height, int dpi) = 0;
+
+    // Next rows of the image, 8-bit BGR
+    virtual bool writeRows(const cv::Mat& band) = 0;
+
+    // Flush and close; the file is incomplete if this is not reached
+    virtual bool finish() = 0;
+
+    // Whether peak memory stays at one band (false for the buffered fallback)
+    virtual bool streaming() const = 0;
+};
+
+} // namespace photobooth
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "image/LayoutAnalyzer.h"
+#include <opencv2/core.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace photobooth {
+
+// Full-resolution compose to run in the background
+struct ComposeJob {
+    std::string id;                 // Assigned by ComposeQueue::enqueue
+    std::string sessionId;          // Set when queued by a ComposeSession
+    std::string layoutPath;
+    std::vector<std::string> photos;
+    LayoutConfig config;
+    std::string outputPath;
+    PrintOptions options;
+    std::vector<cv::Mat> fitted;    // Photos already fitted to the print-size slots
+                                    // (ComposeSession); decoded from photos when empty
+    std::vector<int> failedSlots;   // Session slots whose photo could not be loaded;
+                                    // reported instead of rendering the strip
+};
+
+/**
+ * ComposeQueue - Print-resolution composes taken off the request path
+ * The review screen gets a preview straight away and the print file is
+ * rendered here afterwards. Jobs run one at a time, in submission order, on
+ * a dedicated thread; each job already spreads its bands over the WorkerPool.
+ */
+class ComposeQueue {
+public:
+    // Called on the queue thread once the output file is complete (or failed)
+    using Callback = std::function<void(const ComposeJob& job, bool success, int64_t elapsedMs)>;
+
+    static ComposeQueue& getInstance();
+
+    // Queue a job and return its id
+    std::string enqueue(ComposeJob job, Callback onDone);
+
+    // Jobs waiting or running
+    size_t pendingCount() const;
+
+private:
+    ComposeQueue();
+    ~ComposeQueue();
+
+    ComposeQueue(const ComposeQueue&) = delete;
+    ComposeQueue& operator=(const ComposeQueue&) = delete;
+
+    struct Pending {
+        ComposeJob job;
+        Callback onDone;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Pending> jobs_;
+    bool running_;                  // A job is being rendered
+    bool stopping_;
+    uint64_t nextId_;
+    std::thread thread_;
+
+    void workerLoop();
+};
+
+} // namespace photobooth
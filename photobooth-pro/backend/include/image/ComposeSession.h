@@ -0,0 +1,83 @@
+#pragma once
+
+#include "image/ComposeQueue.h"
+#include "image/LayoutAnalyzer.h"
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+struct LayoutAsset;
+
+/**
+ * ComposeSession - A strip composed while the guest is still shooting
+ * Each photo is decoded and fitted to its print-size slot on the WorkerPool
+ * as soon as it is added, so by the last shutter every other slot is ready.
+ * When the final slot lands, the overlay and encode are queued on
+ * ComposeQueue and the callback reports the finished file.
+ * A photo added again for the same slot (a retake) replaces the earlier one.
+ * A photo that cannot be loaded leaves its slot failed rather than blank; once
+ * every slot has settled the callback reports the failed slots, and a retake
+ * into them lets the strip complete.
+ */
+class ComposeSession : public std::enable_shared_from_this<ComposeSession> {
+public:
+    static std::shared_ptr<ComposeSession> create(const std::string& layoutPath,
+                                                  const LayoutConfig& config,
+                                                  const std::string& outputPath,
+                                                  const PrintOptions& options,
+                                                  ComposeQueue::Callback onDone);
+
+    const std::string& id() const { return id_; }
+
+    // Start fitting a photo into a slot (the next empty one if slotIndex < 0).
+    // Returns the slot used, or -1 if there is none or the strip was submitted.
+    int addPhoto(const std::string& photoPath, int slotIndex = -1);
+
+    size_t slotCount() const { return slots_.size(); }
+    size_t photoCount() const;      // Slots that have a photo, fitted or not
+    bool submitted() const;         // Final render queued
+    std::string jobId() const;      // ComposeQueue job id once submitted
+    std::vector<int> failedSlots() const; // Slots whose photo could not be loaded
+
+    // Drop the fitted photos and refuse further ones; the strip is never
+    // printed. Used when the guest walks away or the session is deleted.
+    void cancel();
+    std::chrono::steady_clock::time_point lastActivity() const;
+
+private:
+    ComposeSession(const std::string& layoutPath, const LayoutConfig& config,
+                   const std::string& outputPath, const PrintOptions& options,
+                   ComposeQueue::Callback onDone);
+
+    std::string id_;
+    std::string layoutPath_;
+    LayoutConfig config_;
+    std::string outputPath_;
+    PrintOptions options_;
+    ComposeQueue::Callback onDone_;
+
+    std::shared_ptr<const LayoutAsset> layout_;     // Keeps the layout decoded meanwhile
+    std::vector<SlotInfo> slots_;                   // At print resolution
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> photos_;
+    std::vector<cv::Mat> fitted_;
+    std::vector<bool> ready_;
+    std::vector<bool> failed_;                      // Photo missing or undecodable
+    std::vector<uint64_t> generations_;             // Bumped per photo, so retakes win
+    bool submitted_;
+    bool cancelled_;
+    std::string jobId_;
+    std::chrono::steady_clock::time_point lastActivity_; // Created or photo added
+
+    void fitSlot(size_t index, const std::string& photoPath, uint64_t generation);
+    void submitLocked();
+};
+
+} // namespace photobooth
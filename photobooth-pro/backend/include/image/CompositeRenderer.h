@@ -0,0 +1,37 @@
+#pragma once
+
+#include "image/LayoutAnalyzer.h"
+#include <opencv2/core.hpp>
+#include <functional>
+#include <string>
+
+namespace photobooth {
+
+struct LayoutAsset;
+class BandWriter;
+
+// Photo for slot index, fitted to exactly slot.width x slot.height (BGR).
+// An empty Mat leaves the slot blank.
+using FitPhoto = std::function<cv::Mat(size_t index, const SlotInfo& slot)>;
+
+// Fit one photo per slot on the worker pool, place them, then blend the
+// layout and drop alpha band by band. Returns the BGR result.
+cv::Mat renderComposite(const LayoutAsset& layout, const LayoutConfig& config,
+                        size_t photoCount, const FitPhoto& fitPhoto);
+
+// Same composite at dpi / layoutDpi scale, produced one band of rows at a
+// time and handed to the writer. fitPhoto receives slots at that scale.
+// Besides the fitted photos only the band being rendered and the band being
+// encoded are in memory, plus a downscaled base when options.renditions
+// asks for smaller copies.
+bool renderBands(const LayoutAsset& layout, const LayoutConfig& config,
+                 size_t photoCount, const FitPhoto& fitPhoto,
+                 const PrintOptions& options, BandWriter& writer);
+
+// renderBands with the cached layout, into a file whose encoder is picked by
+// extension
+bool renderToFile(const std::string& layoutPath, const LayoutConfig& config,
+                  size_t photoCount, const FitPhoto& fitPhoto,
+                  const std::string& outputPath, const PrintOptions& options);
+
+} // namespace photobooth
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+// What an encoded JPEG is for; each use has its own tunable profile
+enum class JpegUse {
+    LiveView,   // Camera frames streamed to the UI
+    Preview,    // Review screen composites
+    Print,      // Captures and print composites
+    Share       // Files sent to guests (email, QR download)
+};
+
+enum class ChromaSubsampling {
+    S444,
+    S422,
+    S420
+};
+
+struct JpegProfile {
+    int quality = 90;
+    ChromaSubsampling subsampling = ChromaSubsampling::S420;
+    bool fastDct = false;       // Faster, slightly less accurate DCT
+    size_t maxBytes = 0;        // Lower the quality until the file fits (0 = no cap)
+    int minQuality = 60;        // Never go below this while fitting maxBytes
+};
+
+/**
+ * JpegCodec - Every JPEG encode and decode in the backend
+ * Uses TurboJPEG when available, with one compressor and decompressor handle
+ * per thread and a per-thread scratch buffer the encoder writes into, so
+ * live view frames don't allocate a worst-case buffer each time. Falls back
+ * to cv::imencode / cv::imdecode otherwise.
+ * Decodes honour the EXIF orientation, like cv::imread.
+ */
+class JpegCodec {
+public:
+    static JpegCodec& getInstance();
+
+    JpegProfile profile(JpegUse use) const;
+    void setProfile(JpegUse use, const JpegProfile& profile);
+
+    // Encode an 8-bit BGR (or grayscale) image. out is overwritten; keep
+    // passing the same vector to reuse its capacity.
+    bool encode(const cv::Mat& image, JpegUse use, std::vector<uint8_t>& out);
+    bool encode(const cv::Mat& image, const JpegProfile& profile, std::vector<uint8_t>& out);
+
+    // Encode straight to a file
+    bool encodeToFile(const cv::Mat& image, JpegUse use, const std::string& path);
+    bool encodeToFile(const cv::Mat& image, const JpegProfile& profile, const std::string& path);
+
+    // Decode to BGR, reduced by scaleDenom (1, 2, 4 or 8) in the DCT.
+    // Non-JPEG data is handed to cv::imdecode at full size.
+    cv::Mat decode(const uint8_t* data, size_t size, int scaleDenom = 1);
+    cv::Mat decode(const std::vector<uint8_t>& data, int scaleDenom = 1);
+    cv::Mat decodeFile(const std::string& path, int scaleDenom = 1);
+
+    // EXIF orientation tag (1-8) of a JPEG, 1 when absent
+    static int readExifOrientation(const uint8_t* data, size_t size);
+
+private:
+    JpegCodec();
+    ~JpegCodec() = default;
+
+    JpegCodec(const JpegCodec&) = delete;
+    JpegCodec& operator=(const JpegCodec&) = delete;
+
+    mutable std::mutex mutex_;
+    JpegProfile profiles_[4];
+
+    // Encode into the calling thread's scratch buffer
+    bool encodeScratch(const cv::Mat& image, const JpegProfile& profile,
+                       const uint8_t*& data, size_t& size);
+};
+
+} // namespace photobooth
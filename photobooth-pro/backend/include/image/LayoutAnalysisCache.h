@@ -0,0 +1,49 @@
+#pragma once
+
+#include "image/LayoutAnalyzer.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * LayoutAnalysisCache - Slot analysis results keyed by PNG content
+ * The key is a hash of the PNG bytes plus the analyzer settings, so the same
+ * template uploaded to another event, renamed or re-uploaded reuses the
+ * earlier result. Entries are kept in memory and as small JSON files under
+ * the data directory, so they survive restarts.
+ */
+class LayoutAnalysisCache {
+public:
+    static LayoutAnalysisCache& getInstance();
+
+    // Where entries are persisted (default: <data>/cache/layout_analysis)
+    void setDirectory(const std::string& directory);
+
+    // Slots for a PNG, running the analyzer only on a miss
+    std::vector<SlotInfo> analyze(const std::string& pngPath, LayoutAnalyzer& analyzer);
+    std::vector<SlotInfo> analyze(const std::vector<uint8_t>& pngData, LayoutAnalyzer& analyzer);
+
+    // Lower level, for callers that already decoded the PNG
+    static std::string makeKey(const uint8_t* data, size_t size, const LayoutAnalyzer& analyzer);
+    bool lookup(const std::string& key, std::vector<SlotInfo>& slots);
+    void store(const std::string& key, const std::vector<SlotInfo>& slots);
+
+private:
+    LayoutAnalysisCache();
+    ~LayoutAnalysisCache() = default;
+
+    LayoutAnalysisCache(const LayoutAnalysisCache&) = delete;
+    LayoutAnalysisCache& operator=(const LayoutAnalysisCache&) = delete;
+
+    std::mutex mutex_;
+    std::string directory_;
+    std::map<std::string, std::vector<SlotInfo>> entries_;
+
+    std::string entryPath(const std::string& key) const;
+};
+
+} // namespace photobooth
@@ -1,19 +1,35 @@
 #pragma once
 
 #include "storage/FileManager.h"
+#include "image/TransparencyScanner.h"
 #include <string>
 #include <vector>
 #include <cstdint>
 
 namespace photobooth {
 
-// Bounding box for a transparent region
-struct BoundingBox {
+// Run of same-class pixels within one row of a layout's alpha plane
+enum class SpanKind : uint8_t {
+    Transparent,    // alpha <= threshold, photo shows through
+    Opaque,         // alpha == 255, layout covers the photo
+    Partial         // Anti-aliased edges and soft shadows, needs blending
+};
+
+struct AlphaSpan {
     int x;
-    int y;
-    int width;
-    int height;
-    int area;
+    int length;
+    SpanKind kind;
+};
+
+// Per-row run-length index of a layout's transparency.
+// Spans of row y are spans[rowStart[y]] .. spans[rowStart[y + 1] - 1].
+struct SpanIndex {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> rowStart;
+    std::vector<AlphaSpan> spans;
+
+    bool empty() const { return spans.empty(); }
 };
 
 class LayoutAnalyzer {
@@ -28,6 +44,12 @@ public:
     // Analyze PNG from memory
     std::vector<SlotInfo> analyzePNG(const std::vector<uint8_t>& pngData);
 
+    // Analyze an already decoded 8-bit alpha plane (width * height, no padding)
+    std::vector<SlotInfo> analyzeAlpha(const uint8_t* alpha, int width, int height);
+
+    // Classify each row of an alpha plane into transparent/opaque/partial runs
+    SpanIndex buildSpanIndex(const uint8_t* alpha, int width, int height);
+
     // Create LayoutConfig from analysis
     LayoutConfig analyzeLayout(const std::string& pngPath, const std::string& layoutName);
 
@@ -39,25 +61,45 @@ public:
     void setAlphaThreshold(uint8_t threshold) { alphaThreshold_ = threshold; }
     void setMergeDistance(int distance) { mergeDistance_ = distance; }
 
+    int getMinSlotArea() const { return minSlotArea_; }
+    uint8_t getAlphaThreshold() const { return alphaThreshold_; }
+    int getMergeDistance() const { return mergeDistance_; }
+
 private:
     int minSlotArea_;           // Minimum area to consider as slot (default: 10000 px)
     uint8_t alphaThreshold_;    // Alpha below this = transparent (default: 10)
     int mergeDistance_;         // Distance to merge nearby regions (default: 5)
 
     // Internal helpers
-    std::vector<BoundingBox> findTransparentRegions(
-        const uint8_t* alphaChannel, int width, int height);
-
     std::vector<BoundingBox> mergeOverlappingBoxes(
         const std::vector<BoundingBox>& boxes);
 
-    void floodFillMask(
-        const uint8_t* alpha, uint8_t* visited,
-        int width, int height,
-        int startX, int startY,
-        int& minX, int& maxX, int& minY, int& maxY);
+    // Filter, merge and order labelled regions into slots
+    std::vector<SlotInfo> slotsFromRegions(const std::vector<BoundingBox>& regions);
+};
+
+// Smaller copy of a print compose (share size, gallery thumbnail, WebP),
+// written from the same render instead of decoding the print again
+struct Rendition {
+    std::string path;       // Encoder picked by extension (.jpg, .webp, ...)
+    int maxWidth = 0;       // Fits within maxWidth x maxHeight keeping the
+    int maxHeight = 0;      // aspect ratio; 0 leaves that side unbounded
+    int quality = 0;        // 0 = the share JPEG profile / WebP default
 };
 
+// Output resolution and banding for ImageCompositor::composeForPrint
+struct PrintOptions {
+    int dpi = 300;          // Printer resolution
+    int layoutDpi = 300;    // Resolution the layout PNG was designed at
+    int jpegQuality = 0;    // 0 = the print JPEG profile
+    int bandRows = 256;     // Output rows rendered and encoded at a time
+    std::vector<Rendition> renditions;
+};
+
+// Slot rectangle at another resolution. Edges are rounded rather than sizes,
+// so slots that touch in the layout still touch after scaling.
+SlotInfo scaleSlot(const SlotInfo& slot, double scale);
+
 // Image composition functions
 class ImageCompositor {
 public:
@@ -79,6 +121,25 @@ public:
                 const LayoutConfig& config,
                 std::vector<uint8_t>& output);
 
+    // Compose at printer resolution, rendering the output in bands that are
+    // streamed to the encoder (JPEG or TIFF by extension). Slot coordinates
+    // are in layout pixels and scaled by dpi / layoutDpi.
+    bool composeForPrint(const std::string& layoutPath,
+                         const std::vector<std::string>& photos,
+                         const LayoutConfig& config,
+                         const std::string& outputPath,
+                         const PrintOptions& options);
+
+    // Screen-resolution JPEG of the same composite, fitting within
+    // maxWidth x maxHeight. Built from the cached downscaled layout and
+    // small photo decodes, for the review screen while the print renders.
+    bool composePreview(const std::string& layoutPath,
+                        const std::vector<std::string>& photos,
+                        const LayoutConfig& config,
+                        int maxWidth, int maxHeight,
+                        std::vector<uint8_t>& output,
+                        int quality = 80);
+
     // Resize and crop image to fit slot (center crop)
     std::vector<uint8_t> fitImageToSlot(
         const std::vector<uint8_t>& imageData,
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "image/LayoutAnalyzer.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace photobooth {
+
+// Decoded layout, ready to composite
+struct LayoutAsset {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    double scale = 1.0;             // Relative to the layout PNG
+    cv::Mat overlay;                // Premultiplied BGRA, empty if the PNG has no alpha
+    cv::Mat alpha;                  // 8-bit alpha plane, empty if the PNG has no alpha
+    std::vector<SlotInfo> slots;    // Detected with default LayoutAnalyzer settings
+    SpanIndex spans;                // Opaque/transparent/partial runs of the alpha plane
+    size_t bytes = 0;
+};
+
+/**
+ * LayoutAssetCache - Process-wide cache of decoded layout PNGs
+ * Every guest at an event composes onto the same layout, so the PNG decode,
+ * premultiply and slot scan are done once per file version. Entries are keyed
+ * by path and validated against the file's mtime and size on every lookup.
+ * Least recently used entries are evicted once the memory cap is exceeded.
+ */
+class LayoutAssetCache {
+public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+    static LayoutAssetCache& getInstance();
+
+    // Cached asset for a layout, decoding it on a miss. nullptr if unreadable.
+    std::shared_ptr<const LayoutAsset> get(const std::string& layoutPath);
+
+    // Downscaled copy fitting within maxWidth x maxHeight (e.g. for previews),
+    // with slots and spans at that size. Cached alongside the full asset.
+    std::shared_ptr<const LayoutAsset> getScaled(const std::string& layoutPath,
+                                                 int maxWidth, int maxHeight);
+
+    // Decode layouts ahead of the first guest (e.g. when an event is launched)
+    void warm(const std::vector<std::string>& layoutPaths);
+
+    void invalidate(const std::string& layoutPath);
+    void clear();
+
+    void setMemoryLimit(size_t bytes);
+    size_t memoryUsage() const;
+
+private:
+    LayoutAssetCache();
+    ~LayoutAssetCache() = default;
+
+    LayoutAssetCache(const LayoutAssetCache&) = delete;
+    LayoutAssetCache& operator=(const LayoutAssetCache&) = delete;
+
+    struct FileStamp {
+        std::time_t mtime = 0;
+        uint64_t size = 0;
+
+        bool operator==(const FileStamp& other) const {
+            return mtime == other.mtime && size == other.size;
+        }
+    };
+
+    struct Entry {
+        FileStamp stamp;
+        std::shared_ptr<const LayoutAsset> asset;
+        std::map<std::pair<int, int>, std::shared_ptr<const LayoutAsset>> scaled;  // By max size
+        size_t bytes;                   // asset plus scaled copies
+        std::list<std::string>::iterator lruPos;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    std::list<std::string> lru_;    // Front = most recently used
+    size_t memoryUsage_;
+    size_t memoryLimit_;
+
+    static bool statFile(const std::string& path, FileStamp& stamp);
+    static std::shared_ptr<LayoutAsset> load(const std::string& path);
+    static std::shared_ptr<LayoutAsset> downscale(const LayoutAsset& asset, double scale);
+
+    void eraseLocked(std::map<std::string, Entry>::iterator it);
+    void evictLocked();
+};
+
+} // namespace photobooth
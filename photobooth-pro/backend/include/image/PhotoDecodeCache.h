@@ -0,0 +1,94 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ctime>
+#include <istream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * PhotoDecodeCache - Camera photos decoded straight to slot size
+ * A 24-45 MP JPEG is decoded with libjpeg's DCT scaling (via JpegCodec)
+ * at the smallest scale that still covers the slot, then center-cropped,
+ * scaled and rotated in a single resample. Results are cached per photo
+ * version, slot size and rotation, so a reprint or a second rendition of the
+ * same strip skips the decode entirely.
+ */
+class PhotoDecodeCache {
+public:
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = 128 * 1024 * 1024;
+
+    // Preview sources are decoded so their short side covers this
+    static constexpr int PREVIEW_SOURCE_SIZE = 800;
+
+    static PhotoDecodeCache& getInstance();
+
+    // Photo fitted to width x height (BGR), turned by rotation degrees
+    // counter-clockwise. Shared with the cache, don't modify.
+    cv::Mat getFitted(const std::string& photoPath, int width, int height, int rotation = 0);
+
+    // Whole photo at the smallest JPEG scale covering PREVIEW_SOURCE_SIZE,
+    // for screen previews. Shared with the cache, don't modify.
+    cv::Mat getPreviewSource(const std::string& photoPath);
+
+    // Same as getFitted for an in-memory photo; not cached
+    static cv::Mat decodeFitted(const std::vector<uint8_t>& data, int width, int height,
+                                int rotation = 0);
+
+    // Center crop and resize to cover width x height. The crop is taken in
+    // source coordinates, so only the pixels that stay visible are resampled;
+    // a rotated slot is scaled, cropped and turned in one warpAffine.
+    static cv::Mat fitToSlot(const cv::Mat& photo, int width, int height, int rotation = 0);
+
+    // Smallest JPEG DCT scale (1, 2, 4 or 8) that still covers the slot
+    static int reducedScale(int srcWidth, int srcHeight, int width, int height);
+
+    // Image size from the JPEG frame header, without decoding
+    static bool readJpegSize(std::istream& in, int& width, int& height);
+
+    void clear();
+    void setMemoryLimit(size_t bytes);
+
+private:
+    PhotoDecodeCache();
+    ~PhotoDecodeCache() = default;
+
+    PhotoDecodeCache(const PhotoDecodeCache&) = delete;
+    PhotoDecodeCache& operator=(const PhotoDecodeCache&) = delete;
+
+    struct Key {
+        std::string path;
+        std::time_t mtime;
+        uint64_t size;
+        int width;
+        int height;
+        int rotation;
+        bool fitted;    // Cropped to width x height, otherwise a preview source
+
+        bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+        cv::Mat image;
+        size_t bytes;
+        std::list<Key>::iterator lruPos;
+    };
+
+    std::mutex mutex_;
+    std::map<Key, Entry> entries_;
+    std::list<Key> lru_;    // Front = most recently used
+    size_t memoryUsage_;
+    size_t memoryLimit_;
+
+    cv::Mat getCached(const std::string& photoPath, int width, int height, int rotation,
+                      bool fit);
+    void evictLocked();
+};
+
+} // namespace photobooth
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "image/LayoutAnalyzer.h"
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * RenditionPyramid - Share, thumbnail and WebP copies of a banded compose
+ * Each output band is box-filtered by a power of two into a base image just
+ * large enough for the biggest rendition, so the full-size print is never
+ * held in memory. finish() halves the base down to the smaller renditions
+ * and resizes and encodes each one from the nearest level in parallel on the
+ * WorkerPool.
+ */
+class RenditionPyramid {
+public:
+    // bandRows is the height of every band but the last
+    RenditionPyramid(const std::vector<Rendition>& renditions, int width, int height,
+                     int bandRows);
+
+    // Next band of full-size BGR rows, in order
+    void addRows(const cv::Mat& band);
+
+    // Write every rendition; false if any failed
+    bool finish();
+
+private:
+    std::vector<Rendition> renditions_;
+    std::vector<cv::Size> sizes_;   // Per rendition
+    int height_;
+    int factor_;                    // Full-size rows per base row
+    int rowsAdded_;                 // Full-size rows seen so far
+    cv::Mat base_;
+
+    static bool write(const cv::Mat& image, const Rendition& rendition);
+};
+
+} // namespace photobooth
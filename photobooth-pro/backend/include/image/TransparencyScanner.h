@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+// Bounding box for a transparent region
+struct BoundingBox {
+    int x;
+    int y;
+    int width;
+    int height;
+    int area;
+};
+
+/**
+ * RegionLabeler - Row-incremental connected components of transparent pixels
+ * Rows are fed top to bottom. Each row is split into transparent runs that
+ * are joined (4-connectivity) to the runs above them through union-find, so
+ * only the previous row's runs and one bounding box per label are kept.
+ */
+class RegionLabeler {
+public:
+    explicit RegionLabeler(uint8_t alphaThreshold);
+
+    // alpha points at the row's first alpha sample; step is the distance
+    // between samples (1 for an alpha plane, 4 for interleaved RGBA)
+    void addRow(const uint8_t* alpha, int width, int step = 1);
+
+    // Bounds of every component, in raster order of its first pixel
+    std::vector<BoundingBox> finish();
+
+private:
+    struct Run {
+        int x0;     // [x0, x1)
+        int x1;
+        int label;
+    };
+
+    uint8_t alphaThreshold_;
+    int row_;
+    std::vector<int> parent_;
+    std::vector<BoundingBox> labelBoxes_;
+    std::vector<Run> previous_;
+    std::vector<Run> current_;
+};
+
+// Merge boxes that overlap or lie within distance of each other on both
+// axes, repeating until stable since a merged box can reach new neighbours
+std::vector<BoundingBox> mergeNearbyBoxes(const std::vector<BoundingBox>& boxes, int distance);
+
+struct TransparencyScan {
+    bool loaded = false;        // The image could be read
+    bool hasAlpha = false;
+    int width = 0;
+    int height = 0;
+    std::vector<BoundingBox> regions;   // Unmerged, unfiltered components
+};
+
+// Label the transparent regions of a PNG. With libpng the image is streamed
+// row by row, so peak memory is a single row regardless of layout size;
+// otherwise (or for interlaced PNGs) it is decoded whole with OpenCV.
+TransparencyScan scanTransparency(const std::string& pngPath, uint8_t alphaThreshold);
+TransparencyScan scanTransparency(const uint8_t* pngData, size_t size, uint8_t alphaThreshold);
+
+} // namespace photobooth
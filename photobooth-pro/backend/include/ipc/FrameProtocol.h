@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+namespace ipc {
+
+// Binary request/response protocol between ProcessManager and MultiCamCui
+// running with --machine. Every message is a fixed FrameHeader followed by
+// payloadLength bytes. Both ends run on the same host, so integers are sent
+// in native byte order.
+
+constexpr uint32_t FRAME_MAGIC = 0x4D434250; // "PBCM"
+constexpr uint16_t PROTOCOL_VERSION = 2;
+constexpr uint32_t MAX_PAYLOAD = 16 * 1024 * 1024;
+
+enum class MessageType : uint8_t {
+  Request = 1,
+  Response = 2,
+  Event = 3 // Unsolicited, correlationId is 0
+};
+
+enum class Opcode : uint16_t {
+  // Requests (bodyID is 1-based, 0 = every opened camera)
+  Ping = 1,
+  ListCameras = 2,  // -> u32 count, count x (string name, string port)
+  OpenSession = 3,  // u32 bodyID
+  CloseSession = 4, // u32 bodyID
+  OpenSessionByPort = 5, // string port -> u32 bodyID
+  TakePicture = 10, // u32 bodyID
+  PressShutter = 11, // u32 bodyID, u32 EdsShutterButton
+  SetProperty = 20, // u32 bodyID, u32 propertyID, u32 value
+  GetProperty = 21, // u32 bodyID, u32 propertyID -> u32 value
+  GetPropertyDesc = 22, // u32 bodyID, u32 propertyID -> u32 n, n x i32
+  StartLiveView = 30, // u32 bodyID
+  StopLiveView = 31,  // u32 bodyID
+  GrabLiveViewFrame = 32, // u32 bodyID -> u64 ring sequence
+  Shutdown = 99,
+
+  // Events
+  CaptureComplete = 100, // u32 bodyID, string path
+  CameraRemoved = 101,   // u32 bodyID
+  PropertyChanged = 102  // u32 bodyID, u32 propertyID, u32 EdsPropertyEvent
+};
+
+// Status codes. Anything else is the EdsError returned by the SDK.
+constexpr uint32_t STATUS_OK = 0;
+constexpr uint32_t STATUS_BAD_REQUEST = 0xFFFF0001;
+constexpr uint32_t STATUS_NO_CAMERA = 0xFFFF0002;
+constexpr uint32_t STATUS_TIMEOUT = 0xFFFF0003;
+constexpr uint32_t STATUS_DISCONNECTED = 0xFFFF0004;
+
+#pragma pack(push, 1)
+struct FrameHeader {
+  uint32_t magic = FRAME_MAGIC;
+  uint16_t version = PROTOCOL_VERSION;
+  uint8_t type = 0;
+  uint8_t flags = 0;
+  uint16_t opcode = 0;
+  uint16_t reserved = 0;
+  uint32_t correlationId = 0;
+  uint32_t status = STATUS_OK;
+  uint32_t payloadLength = 0;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FrameHeader) == 24, "FrameHeader must stay 24 bytes");
+
+inline bool isValidHeader(const FrameHeader &header) {
+  return header.magic == FRAME_MAGIC && header.version == PROTOCOL_VERSION &&
+         header.payloadLength <= MAX_PAYLOAD;
+}
+
+// A decoded message (header + payload)
+struct Frame {
+  FrameHeader header;
+  std::vector<uint8_t> payload;
+
+  Opcode opcode() const { return static_cast<Opcode>(header.opcode); }
+  MessageType type() const { return static_cast<MessageType>(header.type); }
+  bool ok() const { return header.status == STATUS_OK; }
+};
+
+// Serialize header + payload into one buffer so it goes out in one write
+inline std::vector<uint8_t> encodeFrame(MessageType type, Opcode opcode,
+                                        uint32_t correlationId,
+                                        uint32_t status,
+                                        const std::vector<uint8_t> &payload) {
+  FrameHeader header;
+  header.type = static_cast<uint8_t>(type);
+  header.opcode = static_cast<uint16_t>(opcode);
+  header.correlationId = correlationId;
+  header.status = status;
+  header.payloadLength = static_cast<uint32_t>(payload.size());
+
+  std::vector<uint8_t> buffer(sizeof(header) + payload.size());
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  if (!payload.empty()) {
+    std::memcpy(buffer.data() + sizeof(header), payload.data(), payload.size());
+  }
+  return buffer;
+}
+
+// Payload builders/parsers
+class PayloadWriter {
+public:
+  PayloadWriter &u32(uint32_t value) { return raw(&value, sizeof(value)); }
+  PayloadWriter &i32(int32_t value) { return raw(&value, sizeof(value)); }
+  PayloadWriter &u64(uint64_t value) { return raw(&value, sizeof(value)); }
+  PayloadWriter &str(const std::string &value) {
+    u32(static_cast<uint32_t>(value.size()));
+    return raw(value.data(), value.size());
+  }
+
+  const std::vector<uint8_t> &data() const { return data_; }
+
+private:
+  std::vector<uint8_t> data_;
+
+  PayloadWriter &raw(const void *src, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    data_.insert(data_.end(), bytes, bytes + size);
+    return *this;
+  }
+};
+
+class PayloadReader {
+public:
+  explicit PayloadReader(const std::vector<uint8_t> &data) : data_(data) {}
+
+  bool u32(uint32_t &value) { return raw(&value, sizeof(value)); }
+  bool i32(int32_t &value) { return raw(&value, sizeof(value)); }
+  bool u64(uint64_t &value) { return raw(&value, sizeof(value)); }
+  bool str(std::string &value) {
+    uint32_t length = 0;
+    if (!u32(length) || offset_ + length > data_.size())
+      return false;
+    value.assign(reinterpret_cast<const char *>(data_.data()) + offset_,
+                 length);
+    offset_ += length;
+    return true;
+  }
+
+private:
+  const std::vector<uint8_t> &data_;
+  size_t offset_ = 0;
+
+  bool raw(void *dst, size_t size) {
+    if (offset_ + size > data_.size())
+      return false;
+    std::memcpy(dst, data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+};
+
+} // namespace ipc
+} // namespace photobooth
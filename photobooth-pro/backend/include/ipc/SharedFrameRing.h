@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+namespace ipc {
+
+// Single-producer ring of live view frames in a named shared memory segment.
+// ProcessManager creates it and passes the name to MultiCamCui (--ring), which
+// writes each EVF JPEG into the next slot. Slots are guarded by a per-slot
+// sequence counter (odd while being written), so the reader never blocks the
+// camera process and simply retries a torn read.
+class SharedFrameRing {
+public:
+  static constexpr uint32_t DEFAULT_SLOT_COUNT = 4;
+  static constexpr uint32_t DEFAULT_SLOT_SIZE = 4 * 1024 * 1024;
+
+  SharedFrameRing() = default;
+  ~SharedFrameRing();
+
+  SharedFrameRing(const SharedFrameRing &) = delete;
+  SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+
+  // Owner side: create and initialize the segment
+  bool create(const std::string &name, uint32_t slotCount = DEFAULT_SLOT_COUNT,
+              uint32_t slotSize = DEFAULT_SLOT_SIZE);
+
+  // Peer side: map an existing segment
+  bool open(const std::string &name);
+
+  void close();
+  bool isOpen() const { return header_ != nullptr; }
+  const std::string &name() const { return name_; }
+
+  // Producer: copy a frame into the next slot. Returns its sequence number
+  // (0 on failure, e.g. frame larger than a slot).
+  uint64_t write(const uint8_t *data, uint32_t size, uint32_t bodyID);
+
+  // Consumer: copy the newest frame. Returns false if no frame is available or
+  // it is not newer than afterSequence.
+  bool readLatest(std::vector<uint8_t> &data, uint32_t &bodyID,
+                  uint64_t &sequence, uint64_t afterSequence = 0) const;
+
+  uint64_t latestSequence() const;
+
+private:
+  struct RingHeader {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    uint32_t reserved;
+    std::atomic<uint64_t> writeSequence;
+  };
+
+  struct SlotHeader {
+    std::atomic<uint64_t> guard; // Odd while the producer is writing
+    uint64_t sequence;
+    uint32_t length;
+    uint32_t bodyID;
+  };
+
+  std::string name_;
+  bool owner_ = false;
+  RingHeader *header_ = nullptr;
+  size_t mappingSize_ = 0;
+
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+
+  bool map(size_t size, bool create);
+  SlotHeader *slot(uint32_t index) const;
+  uint8_t *slotData(uint32_t index) const;
+  static size_t totalSize(uint32_t slotCount, uint32_t slotSize);
+};
+
+} // namespace ipc
+} // namespace photobooth
@@ -1,12 +1,13 @@
 #pragma once
 
-#include "ICamera.h"
+#include "camera/ICamera.h"
 #include "media/GifCreator.h"
-#include <vector>
-<parameter name = "string">
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <string>
 #include <thread>
+#include <vector>
 
     namespace photobooth {
 
@@ -24,7 +25,10 @@
 
     struct BurstResult {
       bool success = false;
-      std::vector<std::string> framePaths;
+      std::vector<std::string> framePaths; // File camera đã lưu
+      // JPEG của từng frame trong RAM, cùng thứ tự với framePaths; rỗng nếu
+      // camera chỉ trả về file
+      std::vector<std::vector<uint8_t>> frameData;
       std::string errorMessage;
       int capturedFrames = 0;
     };
@@ -53,7 +57,7 @@
     bool isCapturing() const { return capturing_; }
 
     /**
-     * Tạo GIF từ burst đã chụp
+     * Tạo GIF từ burst đã chụp, decode frame từ RAM; chỉ ghi file GIF
      */
     std::string createGifFromBurst(
         const BurstResult &burstResult,
@@ -82,16 +86,21 @@
     void burstCaptureLoop();
 
     /**
-     * Chụp một frame
+     * Chụp một frame, giữ nguyên file camera đã lưu và JPEG trong RAM
+     */
+    bool captureFrame(std::string &framePath, std::vector<uint8_t> &frameData);
+
+    /**
+     * Đưa các frame của burst vào sequence, ưu tiên JPEG trong RAM
      */
-    bool captureFrame(const std::string &outputPath);
+    static void addBurstFrames(const BurstResult &burstResult,
+                               FrameSequence &sequence);
 
     /**
-     * Tạo sequence boomerang từ danh sách ảnh
+     * Thứ tự phát boomerang cho frameCount frame
      */
-    std::vector<std::string>
-    createBoomerangSequence(const std::vector<std::string> &frames,
-                            bool smoothReverse = true);
+    std::vector<size_t> createBoomerangSequence(size_t frameCount,
+                                                bool smoothReverse = true);
   };
 
 } // namespace photobooth
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * FrameSequence - Chuỗi frame BGR đã decode và crop sẵn, giữ trong RAM
+ * Burst, live view và encoder GIF trao đổi frame qua đây thay vì file tạm.
+ * Mỗi frame được decode (JPEG giảm scale ngay trong DCT) và center crop về
+ * kích thước đích trên WorkerPool ngay khi được thêm vào, nên việc resize
+ * chạy song song và chồng lên thời gian chụp.
+ * Các hàm add* gọi từ một thread; không gọi từ task của WorkerPool.
+ */
+class FrameSequence {
+public:
+  FrameSequence(int width, int height);
+  ~FrameSequence();
+
+  FrameSequence(const FrameSequence &) = delete;
+  FrameSequence &operator=(const FrameSequence &) = delete;
+
+  // Ảnh đã mã hóa (JPEG, PNG, ...) trong RAM, vd: CaptureResult::imageData
+  void addEncoded(std::vector<uint8_t> data);
+
+  // Ảnh trên đĩa, chỉ đọc một lần
+  void addFile(const std::string &path);
+
+  // Frame BGR đã decode, kích thước bất kỳ; không sửa frame sau khi thêm
+  void addFrame(const cv::Mat &frame);
+
+  size_t size() const { return pending_.size(); }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  /**
+   * Chờ mọi frame xử lý xong
+   * @return Frame theo thứ tự thêm vào, Mat rỗng cho frame lỗi
+   */
+  std::vector<cv::Mat> frames();
+
+private:
+  int width_;
+  int height_;
+  std::vector<std::future<cv::Mat>> pending_;
+  std::vector<cv::Mat> done_;
+};
+
+} // namespace photobooth
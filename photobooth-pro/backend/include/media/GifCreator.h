@@ -1,5 +1,7 @@
 #pragma once
 
+#include "media/FrameSequence.h"
+#include "media/GifEncoder.h"
 #include <string>
 #include <vector>
 
@@ -7,7 +9,9 @@ namespace photobooth {
 
 /**
  * GifCreator - Tạo ảnh GIF động từ nhiều ảnh JPEG
- * Sử dụng ImageMagick hoặc gifsicle thông qua system call
+ * Decode song song (giảm scale ngay trong DCT) rồi mã hóa bằng GifEncoder
+ * trong process, không cần ImageMagick/gifsicle hay thư mục tạm.
+ * Frame có thể đến từ file hoặc từ FrameSequence trong RAM (burst, live view)
  */
 class GifCreator {
 public:
@@ -16,15 +20,16 @@ public:
     int loopCount = 0;    // 0 = infinite loop
     int width = 800;      // Chiều rộng output
     int height = 600;     // Chiều cao output
-    int quality = 80;     // Chất lượng JPEG (1-100)
-    bool optimize = true; // Tối ưu file size
+    int paletteSize = 256; // Số màu trong bảng màu (2-256)
+    GifEncoder::Dither dither = GifEncoder::Dither::Ordered;
+    bool optimize = true; // Chỉ ghi phần thay đổi giữa các frame
   };
 
   GifCreator();
   ~GifCreator();
 
   /**
-   * Tạo GIF từ danh sách ảnh
+   * Tạo GIF từ danh sách ảnh. Đường dẫn lặp lại dùng lại frame đã nén
    * @param imagePaths Danh sách đường dẫn ảnh input
    * @param outputPath Đường dẫn file GIF output
    * @param options Tùy chọn tạo GIF
@@ -35,64 +40,40 @@ public:
                         const GifOptions &options = GifOptions());
 
   /**
-   * Kiểm tra ImageMagick có sẵn không
+   * Như trên, đồng thời gửi từng phần của GIF cho sink ngay khi mã hóa
+   * xong (vd: chunked HTTP response), trong lúc vẫn ghi ra file
    */
-  static bool isImageMagickAvailable();
-
-  /**
-   * Kiểm tra gifsicle có sẵn không
-   */
-  static bool isGifsicleAvailable();
-
-private:
-  /**
-   * Resize tất cả ảnh về cùng kích thước
-   * @param imagePaths Danh sách ảnh input
-   * @param tempDir Thư mục tạm để lưu ảnh đã resize
-   * @param width Chiều rộng target
-   * @param height Chiều cao target
-   * @return Danh sách đường dẫn ảnh đã resize
-   */
-  std::vector<std::string>
-  resizeImages(const std::vector<std::string> &imagePaths,
-               const std::string &tempDir, int width, int height);
-
-  /**
-   * Tạo GIF bằng ImageMagick
-   */
-  bool createGifWithImageMagick(const std::vector<std::string> &imagePaths,
-                                const std::string &outputPath,
-                                const GifOptions &options);
-
-  /**
-   * Tạo GIF bằng gifsicle (yêu cầu convert PNG trước)
-   */
-  bool createGifWithGifsicle(const std::vector<std::string> &imagePaths,
-                             const std::string &outputPath,
-                             const GifOptions &options);
-
-  /**
-   * Build ImageMagick command
-   */
-  std::string
-  buildImageMagickCommand(const std::vector<std::string> &imagePaths,
-                          const std::string &outputPath,
-                          const GifOptions &options);
+  std::string createGif(const std::vector<std::string> &imagePaths,
+                        const std::string &outputPath,
+                        const GifOptions &options,
+                        const GifEncoder::Sink &sink);
 
   /**
-   * Execute system command và capture output
+   * Tạo GIF từ frame trong RAM; chỉ ghi đĩa cho file GIF output.
+   * Kích thước GIF là kích thước của sequence, options.width/height bỏ qua
+   * @param order Thứ tự phát theo index trong sequence, rỗng = tuần tự.
+   *              Index lặp lại dùng lại frame đã nén
+   * @param sink Nhận từng phần GIF khi mã hóa xong, có thể null
    */
-  int executeCommand(const std::string &command, std::string &output);
+  std::string createGif(FrameSequence &sequence,
+                        const std::vector<size_t> &order,
+                        const std::string &outputPath,
+                        const GifOptions &options,
+                        const GifEncoder::Sink &sink);
 
   /**
-   * Tạo thư mục tạm
+   * Chuỗi boomerang: chạy xuôi rồi chạy ngược
+   * @param smoothReverse Bỏ frame đầu và cuối ở nửa ngược để tránh giật
    */
-  std::string createTempDirectory();
+  static std::vector<std::string>
+  boomerangSequence(const std::vector<std::string> &frames,
+                    bool smoothReverse = true);
 
   /**
-   * Xóa thư mục tạm
+   * Như boomerangSequence nhưng trả về thứ tự phát cho count frame
    */
-  void cleanupTempDirectory(const std::string &dir);
+  static std::vector<size_t> boomerangOrder(size_t count,
+                                            bool smoothReverse = true);
 };
 
 } // namespace photobooth
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * GifEncoder - Mã hóa GIF89a ngay trong process, từ các frame trong RAM
+ * Bảng màu global dùng median-cut, dither ordered (Bayer 8x8) hoặc
+ * Floyd-Steinberg, nén LZW. Mỗi frame được index và nén song song trên
+ * WorkerPool; không cần ImageMagick hay file tạm.
+ */
+class GifEncoder {
+public:
+  enum class Dither {
+    None,
+    Ordered,       // Nhanh, pattern ổn định giữa các frame (nén LZW tốt)
+    FloydSteinberg // Mượt hơn, chậm hơn
+  };
+
+  struct Options {
+    int frameDelay = 10;  // Delay giữa các frame (x10ms)
+    int loopCount = 0;    // 0 = infinite loop
+    int paletteSize = 256;
+    Dither dither = Dither::Ordered;
+    bool optimize = true; // Chỉ ghi vùng thay đổi so với frame trước
+    int deltaTolerance = 10; // Lệch tối đa mỗi kênh vẫn coi là không đổi
+  };
+
+  // Nhận file GIF theo từng phần, đúng thứ tự, ngay khi mỗi phần sẵn sàng
+  using Sink = std::function<void(const uint8_t *data, size_t size)>;
+
+  // Bảng màu RGB dùng chung cho cả GIF
+  struct Palette {
+    std::vector<std::array<uint8_t, 3>> colors;
+    std::vector<uint8_t> lookup; // Màu 15-bit (5:5:5) -> index gần nhất
+  };
+
+  // Hình chữ nhật của một image block trên logical screen
+  struct Region {
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  /**
+   * Mã hóa các frame BGR (CV_8UC3, cùng kích thước) thành file GIF
+   * @return false nếu không có frame hoặc frame không hợp lệ
+   */
+  static bool encode(const std::vector<cv::Mat> &frames, const Options &options,
+                     std::vector<uint8_t> &out);
+
+  static bool encodeToFile(const std::vector<cv::Mat> &frames,
+                           const std::string &outputPath,
+                           const Options &options);
+
+  /**
+   * Như trên, nhưng phát frames[order[0]], frames[order[1]], ...
+   * Mỗi frame chỉ được index một lần dù xuất hiện nhiều lần trong order
+   * (vd: nửa chạy ngược của boomerang). Chỉ khi optimize = false block LZW
+   * mới được nén một lần và dùng lại; với optimize = true mỗi lần xuất hiện
+   * được tính delta so với frame trước nó và nén LZW lại
+   */
+  static bool encode(const std::vector<cv::Mat> &frames,
+                     const std::vector<size_t> &order, const Options &options,
+                     std::vector<uint8_t> &out);
+
+  static bool encodeToFile(const std::vector<cv::Mat> &frames,
+                           const std::vector<size_t> &order,
+                           const std::string &outputPath,
+                           const Options &options);
+
+  /**
+   * Streaming: header và bảng màu được gửi trước, sau đó từng frame được
+   * gửi ngay khi nén xong, nên người nhận hiển thị được frame đầu trước khi
+   * cả GIF mã hóa xong. Bản ghi file vừa ghi đĩa vừa gửi sink (nếu có).
+   */
+  static bool encode(const std::vector<cv::Mat> &frames,
+                     const std::vector<size_t> &order, const Options &options,
+                     const Sink &sink);
+
+  static bool encodeToFile(const std::vector<cv::Mat> &frames,
+                           const std::vector<size_t> &order,
+                           const std::string &outputPath,
+                           const Options &options, const Sink &sink);
+
+  // 0, 1, ..., frameCount - 1
+  static std::vector<size_t> playOrder(size_t frameCount);
+
+  /**
+   * Median-cut trên histogram 15-bit lấy mẫu từ tất cả các frame
+   */
+  static Palette buildPalette(const std::vector<cv::Mat> &frames,
+                              int paletteSize);
+
+  /**
+   * Map một frame sang index của bảng màu
+   */
+  static void indexFrame(const cv::Mat &frame, const Palette &palette,
+                         Dither dither, std::vector<uint8_t> &indices);
+
+  /**
+   * Vùng thay đổi của frame so với những gì đang hiển thị. reference giữ
+   * màu nguồn (BGR) lần cuối được vẽ ở mỗi pixel; pixel lệch không quá
+   * tolerance ở mọi kênh được thay bằng transparentIndex, nên nhiễu sensor
+   * không làm cả frame bị ghi lại. Frame không đổi trả về vùng 1x1 trong
+   * suốt.
+   * @param indices Frame đã index
+   * @param reference Cập nhật cho các pixel được ghi
+   * @param out Index của vùng, theo từng hàng
+   */
+  static Region deltaFrame(const cv::Mat &frame, const uint8_t *indices,
+                           int tolerance, uint8_t transparentIndex,
+                           std::vector<uint8_t> &reference,
+                           std::vector<uint8_t> &out);
+
+  /**
+   * Nén LZW một frame đã index, gồm byte min code size, các sub-block
+   * và block terminator
+   */
+  static void lzwEncode(const uint8_t *indices, size_t count, int minCodeSize,
+                        std::vector<uint8_t> &out);
+};
+
+} // namespace photobooth
@@ -13,7 +13,7 @@ struct LayoutSlot {
   int y;
   int width;
   int height;
-  int rotation; // 0 for now
+  int rotation; // Degrees the photo is turned counter-clockwise
 };
 
 struct LayoutInfo {
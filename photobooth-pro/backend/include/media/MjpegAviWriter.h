@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * MjpegAviWriter - Ghi file AVI (Motion JPEG) từ các frame đã là JPEG
+ * Frame live view được ghi nguyên byte, không decode/encode lại. Header có
+ * kích thước cố định và được ghi lại trong finish() với số frame và FPS
+ * thật; file chỉ hoàn chỉnh sau finish().
+ */
+class MjpegAviWriter {
+public:
+  MjpegAviWriter();
+  ~MjpegAviWriter();
+
+  bool open(const std::string &path, int width, int height);
+  bool writeFrame(const uint8_t *jpeg, size_t size);
+
+  /**
+   * Ghi index và header, đóng file
+   * @param fps FPS đo được của đoạn đã ghi
+   */
+  bool finish(double fps);
+
+  bool isOpen() const { return file_.is_open(); }
+  size_t frameCount() const { return index_.size(); }
+  uint64_t bytesWritten() const { return position_; }
+  const std::string &path() const { return path_; }
+
+private:
+  struct IndexEntry {
+    uint32_t offset; // Tính từ fourcc 'movi'
+    uint32_t size;
+  };
+
+  std::ofstream file_;
+  std::string path_;
+  int width_ = 0;
+  int height_ = 0;
+  uint64_t position_ = 0;
+  uint64_t moviEnd_ = 0;
+  uint32_t maxFrameSize_ = 0;
+  std::vector<IndexEntry> index_;
+  bool failed_ = false;
+
+  std::vector<uint8_t> header(double fps) const;
+  void write(const void *data, size_t size);
+};
+
+} // namespace photobooth
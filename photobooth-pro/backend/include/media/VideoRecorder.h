@@ -0,0 +1,94 @@
+#pragma once
+
+#include "media/MjpegAviWriter.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace photobooth {
+
+/**
+ * VideoRecorder - Quay video từ live view thành các đoạn MJPEG-AVI
+ * addFrame() chạy trên thread camera: chỉ copy frame JPEG vào một buffer
+ * dùng lại rồi đẩy vào hàng đợi có giới hạn bộ nhớ; ghi đĩa nằm trên thread
+ * write-behind riêng. Hàng đợi đầy thì bỏ frame chứ không chặn live view.
+ * Mỗi đoạn được đóng thành file hoàn chỉnh khi đủ thời lượng, nên các đoạn
+ * đầu dùng được ngay trong lúc vẫn đang quay.
+ */
+class VideoRecorder {
+public:
+  struct Options {
+    int segmentSeconds = 10;
+    size_t memoryBudget = 32 * 1024 * 1024; // Byte frame đang chờ ghi
+  };
+
+  struct Status {
+    bool recording = false;
+    size_t framesWritten = 0;
+    size_t framesDropped = 0;
+    std::vector<std::string> segments; // Các đoạn đã đóng, theo thứ tự
+  };
+
+  /**
+   * @param outputPath "video.avi" -> "video_000.avi", "video_001.avi", ...
+   */
+  VideoRecorder(const std::string &outputPath, const Options &options);
+  ~VideoRecorder();
+
+  bool start();
+
+  /**
+   * Ghi nốt hàng đợi, đóng đoạn cuối và dừng thread ghi
+   */
+  Status stop();
+
+  Status status() const;
+
+  /**
+   * Frame JPEG từ live view; gọi trên thread camera, không bao giờ chờ I/O
+   */
+  void addFrame(const std::vector<uint8_t> &jpeg, int width, int height);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Frame {
+    std::vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+    Clock::time_point time;
+  };
+
+  std::string outputPath_;
+  Options options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable queueCV_;
+  std::deque<Frame> queue_;
+  std::vector<std::vector<uint8_t>> spareBuffers_; // Buffer dùng lại
+  size_t queuedBytes_ = 0;
+  bool running_ = false;
+  Status status_;
+
+  std::thread writerThread_;
+
+  // Chỉ dùng trên thread ghi
+  MjpegAviWriter writer_;
+  int segmentIndex_ = 0;
+  Clock::time_point segmentStart_;
+  Clock::time_point segmentLast_;
+  int segmentWidth_ = 0;
+  int segmentHeight_ = 0;
+
+  void writerLoop();
+  void writeFrame(const Frame &frame);
+  void closeSegment();
+  std::string segmentPath(int index) const;
+};
+
+} // namespace photobooth
@@ -13,6 +13,7 @@ struct SlotInfo {
     int y;
     int width;
     int height;
+    int rotation = 0;   // Degrees the photo is turned counter-clockwise in the slot
 };
 
 // Layout configuration
@@ -2,15 +2,31 @@
 #include "core/Application.h"
 #include "storage/DatabaseManager.h"
 #include "storage/FileManager.h"
+#include "core/WorkerPool.h"
+#include "image/ComposeQueue.h"
+#include "image/ComposeSession.h"
 #include "image/LayoutAnalyzer.h"
+#include "image/LayoutAnalysisCache.h"
+#include "image/LayoutAssetCache.h"
+#include "image/PhotoDecodeCache.h"
+#include "media/GifCreator.h"
+#include "media/VideoRecorder.h"
 
 // #define CPPHTTPLIB_OPENSSL_SUPPORT
 #include "httplib.h"
 #include "nlohmann/json.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
@@ -51,6 +67,17 @@ void HTTPServer::stop() {
     serverThread_->join();
   }
 
+  // Finish a recording left running, so its last segment is playable
+  if (auto recorder = releaseVideoRecorder()) {
+    recorder->stop();
+  }
+
+  // Let GIFs already being encoded finish writing their files
+  {
+    std::unique_lock<std::mutex> lock(gifJobsMutex_);
+    gifJobsDone_.wait(lock, [this]() { return gifJobs_ == 0; });
+  }
+
   std::cout << "HTTP Server stopped" << std::endl;
 }
 
@@ -190,6 +217,11 @@ void HTTPServer::setupRoutes() {
                   handleStartVideo(req, res);
                 });
 
+  server_->Get("/api/capture/video/status",
+               [this](const httplib::Request &req, httplib::Response &res) {
+                 handleGetVideoStatus(req, res);
+               });
+
   server_->Post("/api/capture/video/stop",
                 [this](const httplib::Request &req, httplib::Response &res) {
                   handleStopVideo(req, res);
@@ -290,6 +322,31 @@ void HTTPServer::setupRoutes() {
                   handleComposePhotos(req, res);
                 });
 
+  server_->Post("/api/layouts/compose/preview",
+                [this](const httplib::Request &req, httplib::Response &res) {
+                  handleComposePreview(req, res);
+                });
+
+  server_->Post("/api/compose/sessions",
+                [this](const httplib::Request &req, httplib::Response &res) {
+                  handleCreateComposeSession(req, res);
+                });
+
+  server_->Get(R"(/api/compose/sessions/([\w-]+))",
+               [this](const httplib::Request &req, httplib::Response &res) {
+                 handleGetComposeSession(req, res);
+               });
+
+  server_->Delete(R"(/api/compose/sessions/([\w-]+))",
+                  [this](const httplib::Request &req, httplib::Response &res) {
+                    handleDeleteComposeSession(req, res);
+                  });
+
+  server_->Post(R"(/api/compose/sessions/([\w-]+)/photos)",
+                [this](const httplib::Request &req, httplib::Response &res) {
+                  handleAddComposeSessionPhoto(req, res);
+                });
+
   server_->Get(R"(/api/layouts/(\w+)/slots)",
                [this](const httplib::Request &req, httplib::Response &res) {
                  handleGetLayoutSlots(req, res);
@@ -605,6 +662,19 @@ void HTTPServer::handleGetEventConfig(const httplib::Request &req,
     // Try to load full config from file system
     FileManager fm;
     std::string fileConfigStr = fm.loadEventFullConfig(std::to_string(eventId));
+
+    // The booth fetches this when an event is launched; decode its layouts
+    // in the background so the first guest doesn't pay for it
+    std::vector<std::string> layoutPaths;
+    for (const auto &name : fm.listLayouts(std::to_string(eventId))) {
+      layoutPaths.push_back(fm.getLayoutPath(std::to_string(eventId), name));
+    }
+    if (!layoutPaths.empty()) {
+      std::thread([layoutPaths]() {
+        LayoutAssetCache::getInstance().warm(layoutPaths);
+      }).detach();
+    }
+
     if (fileConfigStr.length() > 2) {
         try {
             configJson = json::parse(fileConfigStr);
@@ -931,9 +1001,12 @@ void HTTPServer::handleCapture(const httplib::Request &req,
 
   // Parse eventId
   int eventId = 0;
+  std::shared_ptr<ComposeSession> composeSession;
   try {
     json body = json::parse(req.body);
     eventId = body.value("eventId", 0);
+    // Fit the shot into a strip being composed as the session goes
+    composeSession = findComposeSession(body.value("composeSession", ""));
   } catch (...) {
   } // Optional or error
 
@@ -975,7 +1048,7 @@ void HTTPServer::handleCapture(const httplib::Request &req,
   // takes a callback.
 
   camMgr->capture(CaptureMode::Single,
-                  [this, eventId](const CaptureResult &result) {
+                  [this, eventId, composeSession](const CaptureResult &result) {
                     if (result.success) {
                       // Save to DB
                       auto &db = app_->getDatabase();
@@ -989,6 +1062,17 @@ void HTTPServer::handleCapture(const httplib::Request &req,
 
                       db.savePhoto(photo);
 
+                      // Decode the review screen preview source before the
+                      // guest gets there
+                      std::string path = result.filePath;
+                      WorkerPool::getInstance().submit([path]() {
+                        PhotoDecodeCache::getInstance().getPreviewSource(path);
+                      });
+
+                      if (composeSession) {
+                        composeSession->addPhoto(result.filePath);
+                      }
+
                       // Broadcast to WebSocket
                       auto *ws = app_->getWebSocketServer();
                       if (ws)
@@ -999,34 +1083,427 @@ void HTTPServer::handleCapture(const httplib::Request &req,
   res.set_content(jsonResponse(true, "Capture initiated"), "application/json");
 }
 
+namespace {
+
+// Where a requested media file goes. A client-supplied path must stay inside
+// the storage directory and carry the extension; without one the file is
+// named after the event, next to its captured photos. "" = rejected.
+std::string resolveMediaPath(const std::string &requested, int eventId,
+                             const std::string &prefix,
+                             const std::string &extension) {
+  namespace fs = std::filesystem;
+  FileManager fm;
+  std::error_code ec;
+  fs::path base = fs::weakly_canonical(fm.getBaseDirectory(), ec);
+  if (ec) {
+    return "";
+  }
+
+  fs::path target;
+  if (!requested.empty()) {
+    target = requested;
+    if (target.is_relative()) {
+      target = base / target;
+    }
+  } else {
+    if (eventId <= 0) {
+      return "";
+    }
+    auto stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+    target = fs::path(fm.getEventPath(std::to_string(eventId))) /
+             "captured_photos" /
+             (prefix + "_" + std::to_string(stamp) + extension);
+  }
+
+  target = fs::weakly_canonical(target, ec);
+  if (ec || target.extension() != extension) {
+    return "";
+  }
+  fs::path inside = target.lexically_relative(base);
+  if (inside.empty() || *inside.begin() == "..") {
+    return "";
+  }
+  return target.string();
+}
+
+// From the request's "outputPath" and "eventId"
+std::string resolveMediaPath(const json &body, const std::string &prefix,
+                             const std::string &extension) {
+  return resolveMediaPath(body.value("outputPath", ""),
+                          body.value("eventId", 0), prefix, extension);
+}
+
+// An image whose format follows its extension, which must be one of allowed
+// (the first is used for generated names)
+std::string resolveImagePath(const std::string &requested, int eventId,
+                             const std::string &prefix,
+                             const std::vector<std::string> &allowed) {
+  std::string extension =
+      requested.empty() ? allowed.front()
+                        : std::filesystem::path(requested).extension().string();
+  std::string lower = extension;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (std::find(allowed.begin(), allowed.end(), lower) == allowed.end()) {
+    return "";
+  }
+  return resolveMediaPath(requested, eventId, prefix, extension);
+}
+
+// Reads an optional integer field into value; false if it is present but
+// not an integer in [minValue, maxValue]
+bool readIntInRange(const json &body, const char *key, int minValue,
+                    int maxValue, int &value) {
+  if (!body.contains(key)) {
+    return true;
+  }
+  const json &field = body[key];
+  if (!field.is_number_integer() || field.get<int64_t>() < minValue ||
+      field.get<int64_t>() > maxValue) {
+    return false;
+  }
+  value = field.get<int>();
+  return true;
+}
+
+// A GIF encoded on its own thread. The file is always finished; responses
+// follow the bytes as they are produced and may stop reading at any point
+struct GifStream {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<uint8_t> data;
+  bool done = false;
+  bool ok = false;
+};
+
+} // namespace
+
 void HTTPServer::handleCaptureGif(const httplib::Request &req,
                                   httplib::Response &res) {
-  setCorsHeaders(res);
-  // TODO: Implement
-  res.set_content(jsonResponse(true, "GIF captured"), "application/json");
+  handleStreamGif(req, res, false);
 }
 
 void HTTPServer::handleCaptureBoomerang(const httplib::Request &req,
                                         httplib::Response &res) {
+  handleStreamGif(req, res, true);
+}
+
+void HTTPServer::handleStreamGif(const httplib::Request &req,
+                                 httplib::Response &res, bool boomerang) {
   setCorsHeaders(res);
-  // TODO: Implement
-  res.set_content(jsonResponse(true, "Boomerang captured"), "application/json");
+
+  try {
+    json body = json::parse(req.body);
+
+    std::string source = body.value("source", "photos");
+    std::vector<std::string> photoPaths;
+    if (body.contains("photos") && body["photos"].is_array()) {
+      for (const auto &photo : body["photos"]) {
+        photoPaths.push_back(photo.get<std::string>());
+      }
+    }
+
+    bool liveView = source == "liveview";
+    if (!liveView && photoPaths.empty()) {
+      res.status = 400;
+      res.set_content(jsonError("photos required", 400), "application/json");
+      return;
+    }
+
+    std::string outputPath =
+        resolveMediaPath(body, boomerang ? "boomerang" : "gif", ".gif");
+    if (outputPath.empty()) {
+      res.status = 400;
+      res.set_content(
+          jsonError("outputPath must be a .gif inside the storage directory, "
+                    "or eventId given",
+                    400),
+          "application/json");
+      return;
+    }
+
+    // Bounded before anything is decoded: frames are scaled to width x
+    // height on the worker pool, live view sleeps frameDelay between grabs,
+    // and the GIF stores delay and loop count as 16-bit fields
+    GifCreator::GifOptions options;
+    if (!readIntInRange(body, "frameDelay", 1, 100, options.frameDelay) ||
+        !readIntInRange(body, "loopCount", 0, 65535, options.loopCount) ||
+        !readIntInRange(body, "width", 16, 1920, options.width) ||
+        !readIntInRange(body, "height", 16, 1920, options.height)) {
+      res.status = 400;
+      res.set_content(
+          jsonError("frameDelay must be 1-100, loopCount 0-65535, "
+                    "width and height 16-1920",
+                    400),
+          "application/json");
+      return;
+    }
+
+    if (boomerang) {
+      options.frameDelay = std::min(options.frameDelay, 8); // Max 80ms
+    }
+
+    // Frames are decoded and scaled on the worker pool as they are added;
+    // only the GIF itself touches the disk
+    auto frames =
+        std::make_shared<FrameSequence>(options.width, options.height);
+    std::vector<size_t> order;
+
+    if (liveView) {
+      auto *camMgr = app_->getCameraManager();
+      if (!camMgr || !camMgr->startMjpegStream()) {
+        res.status = 503;
+        res.set_content(jsonError("Live view not available", 503),
+                        "application/json");
+        return;
+      }
+
+      // Grab live view frames at the GIF's own frame rate
+      int frameCount = body.value("frameCount", 10);
+      frameCount = std::max(1, std::min(frameCount, 100));
+      auto interval = std::chrono::milliseconds(options.frameDelay * 10);
+      auto next = std::chrono::steady_clock::now();
+      std::vector<uint8_t> jpeg;
+      for (int i = 0; i < frameCount; i++) {
+        std::this_thread::sleep_until(next);
+        next += interval;
+        if (!camMgr->waitForFrame(jpeg, 2000)) {
+          break;
+        }
+        frames->addEncoded(jpeg);
+      }
+      camMgr->stopMjpegStream();
+
+      if (frames->size() == 0) {
+        res.status = 503;
+        res.set_content(jsonError("No live view frames received", 503),
+                        "application/json");
+        return;
+      }
+    } else {
+      // Repeated paths share one decoded frame
+      std::unordered_map<std::string, size_t> indexOf;
+      for (const auto &path : photoPaths) {
+        auto inserted = indexOf.emplace(path, frames->size());
+        if (inserted.second) {
+          frames->addFile(path);
+        }
+        order.push_back(inserted.first->second);
+      }
+    }
+
+    if (boomerang) {
+      std::vector<size_t> forward = order;
+      if (forward.empty()) {
+        for (size_t i = 0; i < frames->size(); i++) {
+          forward.push_back(i);
+        }
+      }
+      order.clear();
+      for (size_t index : GifCreator::boomerangOrder(forward.size())) {
+        order.push_back(forward[index]);
+      }
+    }
+
+    // The encode runs on its own thread and always writes the file; the
+    // response is sent as chunks while it is encoded, so the review screen
+    // can show the first frames early. A client leaving doesn't stop it
+    auto stream = std::make_shared<GifStream>();
+    {
+      std::lock_guard<std::mutex> lock(gifJobsMutex_);
+      gifJobs_++;
+    }
+    std::thread([this, frames, order, outputPath, options, stream]() {
+      std::string gifPath;
+      try {
+        GifCreator creator;
+        gifPath = creator.createGif(
+            *frames, order, outputPath, options,
+            [&stream](const uint8_t *data, size_t size) {
+              std::lock_guard<std::mutex> lock(stream->mutex);
+              stream->data.insert(stream->data.end(), data, data + size);
+              stream->changed.notify_all();
+            });
+      } catch (const std::exception &e) {
+        std::cerr << "GIF encode failed: " << e.what() << std::endl;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->ok = !gifPath.empty();
+        stream->done = true;
+        stream->changed.notify_all();
+      }
+
+      std::lock_guard<std::mutex> lock(gifJobsMutex_);
+      gifJobs_--;
+      gifJobsDone_.notify_all();
+    }).detach();
+
+    res.set_header("Access-Control-Expose-Headers", "X-Output-Path");
+    res.set_header("X-Output-Path", outputPath);
+    res.set_chunked_content_provider(
+        "image/gif", [stream](size_t offset, httplib::DataSink &sink) {
+          std::vector<uint8_t> chunk;
+          {
+            std::unique_lock<std::mutex> lock(stream->mutex);
+            stream->changed.wait(lock, [&]() {
+              return stream->done || stream->data.size() > offset;
+            });
+            if (stream->data.size() > offset) {
+              chunk.assign(stream->data.begin() + offset, stream->data.end());
+            } else if (!stream->ok) {
+              // Drops the connection, so the client sees a truncated GIF
+              return false;
+            }
+          }
+
+          if (chunk.empty()) {
+            sink.done();
+            return true;
+          }
+          return sink.write(reinterpret_cast<const char *>(chunk.data()),
+                            chunk.size());
+        });
+  } catch (const std::exception &e) {
+    res.status = 500;
+    res.set_content(jsonError(e.what(), 500), "application/json");
+  }
+}
+
+namespace {
+
+json videoStatusJson(const VideoRecorder::Status &status) {
+  return {{"recording", status.recording},
+          {"framesWritten", status.framesWritten},
+          {"framesDropped", status.framesDropped},
+          {"segments", status.segments}};
 }
 
+} // namespace
+
 void HTTPServer::handleStartVideo(const httplib::Request &req,
                                   httplib::Response &res) {
   setCorsHeaders(res);
-  // TODO: Implement
-  res.set_content(jsonResponse(true, "Video recording started"),
-                  "application/json");
+
+  auto *camMgr = app_->getCameraManager();
+  if (!camMgr) {
+    res.status = 500;
+    res.set_content(jsonError("Camera Manager not initialized", 500),
+                    "application/json");
+    return;
+  }
+
+  try {
+    json body = json::parse(req.body);
+
+    std::string outputPath = resolveMediaPath(body, "video", ".avi");
+    if (outputPath.empty()) {
+      res.status = 400;
+      res.set_content(
+          jsonError("outputPath must be an .avi inside the storage directory, "
+                    "or eventId given",
+                    400),
+          "application/json");
+      return;
+    }
+
+    VideoRecorder::Options options;
+    options.segmentSeconds =
+        std::max(1, body.value("segmentSeconds", options.segmentSeconds));
+
+    std::lock_guard<std::mutex> lock(videoRecorderMutex_);
+    if (videoRecorder_) {
+      res.status = 409;
+      res.set_content(jsonError("Video recording already in progress", 409),
+                      "application/json");
+      return;
+    }
+
+    // Frames come off the shared live view stream; joining it as a client
+    // keeps the UI live view running unchanged
+    if (!camMgr->startMjpegStream()) {
+      res.status = 400;
+      res.set_content(jsonError("Failed to start live view", 400),
+                      "application/json");
+      return;
+    }
+
+    videoRecorder_ = std::make_unique<VideoRecorder>(outputPath, options);
+    videoRecorder_->start();
+    VideoRecorder *recorder = videoRecorder_.get();
+    camMgr->setFrameSink(
+        [recorder](const std::vector<uint8_t> &data, int w, int h) {
+          recorder->addFrame(data, w, h);
+        });
+
+    res.set_content(jsonResponse(true, "Video recording started"),
+                    "application/json");
+  } catch (const std::exception &e) {
+    res.status = 500;
+    res.set_content(jsonError(e.what(), 500), "application/json");
+  }
 }
 
 void HTTPServer::handleStopVideo(const httplib::Request &req,
                                  httplib::Response &res) {
   setCorsHeaders(res);
-  // TODO: Implement
-  res.set_content(jsonResponse(true, "Video recording stopped"),
-                  "application/json");
+
+  std::unique_ptr<VideoRecorder> recorder = releaseVideoRecorder();
+  if (!recorder) {
+    res.status = 400;
+    res.set_content(jsonError("No video recording in progress", 400),
+                    "application/json");
+    return;
+  }
+
+  // Drains the write-behind queue and closes the last segment
+  VideoRecorder::Status status = recorder->stop();
+
+  json response;
+  response["success"] = true;
+  response["message"] = "Video recording stopped";
+  response["data"] = videoStatusJson(status);
+  res.set_content(response.dump(), "application/json");
+}
+
+void HTTPServer::handleGetVideoStatus(const httplib::Request &req,
+                                      httplib::Response &res) {
+  setCorsHeaders(res);
+
+  // Segments listed here are closed and can be played or shared already
+  VideoRecorder::Status status;
+  {
+    std::lock_guard<std::mutex> lock(videoRecorderMutex_);
+    if (videoRecorder_) {
+      status = videoRecorder_->status();
+    }
+  }
+
+  json response;
+  response["success"] = true;
+  response["data"] = videoStatusJson(status);
+  res.set_content(response.dump(), "application/json");
+}
+
+std::unique_ptr<VideoRecorder> HTTPServer::releaseVideoRecorder() {
+  std::unique_ptr<VideoRecorder> recorder;
+  {
+    std::lock_guard<std::mutex> lock(videoRecorderMutex_);
+    recorder = std::move(videoRecorder_);
+  }
+  if (!recorder) {
+    return nullptr;
+  }
+
+  auto *camMgr = app_->getCameraManager();
+  if (camMgr) {
+    camMgr->setFrameSink(nullptr);
+    camMgr->stopMjpegStream();
+  }
+  return recorder;
 }
 
 // ==================== Gallery API Stubs ====================
@@ -1242,13 +1719,57 @@ void HTTPServer::handleGetSettings(const httplib::Request &req,
                         {"captureMode", "photo"},
                         {"autoPreview", true}}},
                       {"print", {{"autoPrint", false}, {"copies", 1}}}};
+
+  auto &pool = WorkerPool::getInstance();
+  response["data"]["compose"] = {{"threads", pool.threadCount()},
+                                 {"lowPriority", pool.lowPriority()}};
   res.set_content(response.dump(), "application/json");
 }
 
 void HTTPServer::handleUpdateSettings(const httplib::Request &req,
                                       httplib::Response &res) {
   setCorsHeaders(res);
-  // TODO: Implement
+  // TODO: Persist with SettingsManager; only the compose pool is applied now
+  try {
+    json body = json::parse(req.body);
+
+    // Compose worker pool; fewer threads or low priority keep live view smooth
+    if (body.contains("compose") && body["compose"].is_object()) {
+      auto &pool = WorkerPool::getInstance();
+      const json &compose = body["compose"];
+
+      // Validate before touching the pool, which restarts all its threads
+      if ((compose.contains("threads") &&
+           !compose["threads"].is_number_integer()) ||
+          (compose.contains("lowPriority") &&
+           !compose["lowPriority"].is_boolean())) {
+        res.status = 400;
+        res.set_content(
+            jsonError("compose.threads must be an integer and "
+                      "compose.lowPriority a boolean",
+                      400),
+            "application/json");
+        return;
+      }
+
+      // 0 runs compose work on the request thread; more threads than cores
+      // only steal time from live view
+      int64_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+      int64_t requested = compose.value(
+          "threads", static_cast<int64_t>(pool.threadCount()));
+      size_t threads = static_cast<size_t>(
+          std::min(std::max(requested, int64_t(0)), maxThreads));
+      bool lowPriority = compose.value("lowPriority", pool.lowPriority());
+      if (threads != pool.threadCount() || lowPriority != pool.lowPriority()) {
+        pool.configure(threads, lowPriority);
+      }
+    }
+  } catch (const std::exception &e) {
+    res.status = 400;
+    res.set_content(jsonError(e.what(), 400), "application/json");
+    return;
+  }
+
   res.set_content(jsonResponse(true, "Settings updated"), "application/json");
 }
 
@@ -1300,9 +1821,13 @@ void HTTPServer::handleAnalyzeLayout(const httplib::Request &req,
         return;
       }
 
-      // Analyze layout
+      // Analyze layout (cached by PNG content across events and restarts)
       LayoutAnalyzer analyzer;
-      auto config = analyzer.analyzeLayout(layoutPath, "layout");
+      LayoutConfig config;
+      config.layoutName = "layout";
+      config.layoutPath = layoutPath;
+      config.slots = LayoutAnalysisCache::getInstance().analyze(layoutPath, analyzer);
+      config.slotsCount = static_cast<int>(config.slots.size());
 
       // Convert to JSON
       json slotsJson = json::array();
@@ -1313,6 +1838,7 @@ void HTTPServer::handleAnalyzeLayout(const httplib::Request &req,
         slotJson["y"] = slot.y;
         slotJson["width"] = slot.width;
         slotJson["height"] = slot.height;
+        slotJson["rotation"] = slot.rotation;
         slotsJson.push_back(slotJson);
       }
 
@@ -1337,7 +1863,7 @@ void HTTPServer::handleAnalyzeLayout(const httplib::Request &req,
     std::vector<uint8_t> pngData(file.content.begin(), file.content.end());
 
     LayoutAnalyzer analyzer;
-    auto slots = analyzer.analyzePNG(pngData);
+    auto slots = LayoutAnalysisCache::getInstance().analyze(pngData, analyzer);
 
     json slotsJson = json::array();
     for (const auto& slot : slots) {
@@ -1347,6 +1873,7 @@ void HTTPServer::handleAnalyzeLayout(const httplib::Request &req,
       slotJson["y"] = slot.y;
       slotJson["width"] = slot.width;
       slotJson["height"] = slot.height;
+      slotJson["rotation"] = slot.rotation;
       slotsJson.push_back(slotJson);
     }
 
@@ -1364,6 +1891,114 @@ void HTTPServer::handleAnalyzeLayout(const httplib::Request &req,
   }
 }
 
+namespace {
+
+std::vector<std::string> composePhotoPaths(const json &body) {
+  std::vector<std::string> photoPaths;
+  if (body.contains("photos") && body["photos"].is_array()) {
+    for (const auto& photo : body["photos"]) {
+      photoPaths.push_back(photo.get<std::string>());
+    }
+  }
+  return photoPaths;
+}
+
+// Slots from the request, otherwise the ones detected in the layout
+LayoutConfig composeConfig(const json &body, const std::string &layoutPath) {
+  LayoutConfig config;
+  config.layoutPath = layoutPath;
+  if (body.contains("slots") && body["slots"].is_array()) {
+    for (const auto& slot : body["slots"]) {
+      SlotInfo si;
+      si.id = slot.value("id", 0);
+      si.x = slot.value("x", 0);
+      si.y = slot.value("y", 0);
+      si.width = slot.value("width", 0);
+      si.height = slot.value("height", 0);
+      si.rotation = slot.value("rotation", 0);
+      config.slots.push_back(si);
+    }
+  } else {
+    // Slots from the layout cache, which reuses content-hash analysis results
+    auto layout = LayoutAssetCache::getInstance().get(layoutPath);
+    config.layoutName = "layout";
+    if (layout) {
+      config.slots = layout->slots;
+    }
+  }
+  config.slotsCount = static_cast<int>(config.slots.size());
+  return config;
+}
+
+// Tells clients a print-resolution file has landed, or that a session could
+// not be printed because some of its photos failed to load
+ComposeQueue::Callback broadcastComposeComplete(Application *app) {
+  return [app](const ComposeJob &done, bool success, int64_t elapsedMs) {
+    auto *ws = app->getWebSocketServer();
+    if (!ws) {
+      return;
+    }
+    json data = {{"jobId", done.id},
+                 {"outputPath", done.outputPath},
+                 {"success", success},
+                 {"durationMs", elapsedMs}};
+    if (!done.sessionId.empty()) {
+      data["sessionId"] = done.sessionId;
+    }
+    if (!done.failedSlots.empty()) {
+      data["failedSlots"] = done.failedSlots;
+    }
+    json renditions = json::array();
+    for (const auto &rendition : done.options.renditions) {
+      renditions.push_back(rendition.path);
+    }
+    data["renditions"] = renditions;
+    ws->broadcastEvent("compose:complete", data.dump());
+  };
+}
+
+// Optional print resolution: {"dpi": 600, "layoutDpi": 300, "quality": 95}
+// and smaller copies from the same render:
+// "renditions": [{"path": "share.jpg", "maxWidth": 1600, "maxHeight": 1600}]
+// False if a rendition path is outside the storage directory or not an image
+bool composePrintOptions(const json &body, PrintOptions &printOptions) {
+  if (body.contains("print") && body["print"].is_object()) {
+    const json &print = body["print"];
+    printOptions.dpi = print.value("dpi", printOptions.dpi);
+    printOptions.layoutDpi = print.value("layoutDpi", printOptions.layoutDpi);
+    printOptions.jpegQuality = print.value("quality", printOptions.jpegQuality);
+  }
+  if (body.contains("renditions") && body["renditions"].is_array()) {
+    for (const auto &item : body["renditions"]) {
+      std::string path = item.value("path", "");
+      if (path.empty()) {
+        continue;
+      }
+      Rendition rendition;
+      rendition.path =
+          resolveImagePath(path, 0, "", {".jpg", ".jpeg", ".webp", ".png"});
+      if (rendition.path.empty()) {
+        return false;
+      }
+      rendition.maxWidth = item.value("maxWidth", 0);
+      rendition.maxHeight = item.value("maxHeight", 0);
+      rendition.quality = item.value("quality", 0);
+      printOptions.renditions.push_back(rendition);
+    }
+  }
+  return true;
+}
+
+// Print file of a compose started from the booth: .jpg, .png or .tif inside
+// the storage directory, or named after the event when outputPath is omitted
+std::string composeOutputPath(const json &body) {
+  return resolveImagePath(body.value("outputPath", ""),
+                          body.value("eventId", 0), "strip",
+                          {".jpg", ".jpeg", ".png", ".tif", ".tiff"});
+}
+
+} // namespace
+
 void HTTPServer::handleComposePhotos(const httplib::Request &req,
                                      httplib::Response &res) {
   setCorsHeaders(res);
@@ -1373,13 +2008,7 @@ void HTTPServer::handleComposePhotos(const httplib::Request &req,
 
     std::string layoutPath = body.value("layoutPath", "");
     std::string outputPath = body.value("outputPath", "");
-    std::vector<std::string> photoPaths;
-
-    if (body.contains("photos") && body["photos"].is_array()) {
-      for (const auto& photo : body["photos"]) {
-        photoPaths.push_back(photo.get<std::string>());
-      }
-    }
+    std::vector<std::string> photoPaths = composePhotoPaths(body);
 
     if (layoutPath.empty() || outputPath.empty() || photoPaths.empty()) {
       res.status = 400;
@@ -1388,29 +2017,23 @@ void HTTPServer::handleComposePhotos(const httplib::Request &req,
       return;
     }
 
-    // Load layout config from request or analyze
-    LayoutConfig config;
-    if (body.contains("slots") && body["slots"].is_array()) {
-      config.layoutPath = layoutPath;
-      for (const auto& slot : body["slots"]) {
-        SlotInfo si;
-        si.id = slot.value("id", 0);
-        si.x = slot.value("x", 0);
-        si.y = slot.value("y", 0);
-        si.width = slot.value("width", 0);
-        si.height = slot.value("height", 0);
-        config.slots.push_back(si);
-      }
-      config.slotsCount = static_cast<int>(config.slots.size());
-    } else {
-      // Analyze layout if slots not provided
-      LayoutAnalyzer analyzer;
-      config = analyzer.analyzeLayout(layoutPath, "layout");
+    PrintOptions printOptions;
+    if (!composePrintOptions(body, printOptions)) {
+      res.status = 400;
+      res.set_content(
+          jsonError("renditions[].path must be a .jpg, .webp or .png inside "
+                    "the storage directory",
+                    400),
+          "application/json");
+      return;
     }
 
-    // Compose
+    LayoutConfig config = composeConfig(body, layoutPath);
+
+    // Compose, streaming bands to the output file
     ImageCompositor compositor;
-    if (compositor.compose(layoutPath, photoPaths, config, outputPath)) {
+    if (compositor.composeForPrint(layoutPath, photoPaths, config, outputPath,
+                                   printOptions)) {
       json response;
       response["success"] = true;
       response["message"] = "Photos composed successfully";
@@ -1427,6 +2050,291 @@ void HTTPServer::handleComposePhotos(const httplib::Request &req,
   }
 }
 
+void HTTPServer::handleComposePreview(const httplib::Request &req,
+                                      httplib::Response &res) {
+  setCorsHeaders(res);
+
+  try {
+    json body = json::parse(req.body);
+
+    std::string layoutPath = body.value("layoutPath", "");
+    std::vector<std::string> photoPaths = composePhotoPaths(body);
+
+    if (layoutPath.empty() || photoPaths.empty()) {
+      res.status = 400;
+      res.set_content(jsonError("layoutPath and photos required", 400),
+                      "application/json");
+      return;
+    }
+
+    // The print file is written later by ComposeQueue, so check it now
+    std::string outputPath = composeOutputPath(body);
+    if (outputPath.empty()) {
+      res.status = 400;
+      res.set_content(
+          jsonError("outputPath must be a .jpg, .png or .tif inside the "
+                    "storage directory, or eventId given",
+                    400),
+          "application/json");
+      return;
+    }
+
+    PrintOptions printOptions;
+    if (!composePrintOptions(body, printOptions)) {
+      res.status = 400;
+      res.set_content(
+          jsonError("renditions[].path must be a .jpg, .webp or .png inside "
+                    "the storage directory",
+                    400),
+          "application/json");
+      return;
+    }
+
+    LayoutConfig config = composeConfig(body, layoutPath);
+
+    // Preview size: {"maxWidth": 1280, "maxHeight": 1280, "quality": 80}
+    int maxWidth = 1280;
+    int maxHeight = 1280;
+    int quality = 80;
+    if (body.contains("preview") && body["preview"].is_object()) {
+      const json &preview = body["preview"];
+      maxWidth = preview.value("maxWidth", maxWidth);
+      maxHeight = preview.value("maxHeight", maxHeight);
+      quality = preview.value("quality", quality);
+    }
+
+    // Preview first, so it doesn't compete with the print render for workers
+    ImageCompositor compositor;
+    std::vector<uint8_t> preview;
+    if (!compositor.composePreview(layoutPath, photoPaths, config, maxWidth,
+                                   maxHeight, preview, quality)) {
+      res.status = 500;
+      res.set_content(jsonError("Failed to compose preview", 500),
+                      "application/json");
+      return;
+    }
+
+    // Print-resolution file in the background; clients get compose:complete
+    ComposeJob job;
+    job.layoutPath = layoutPath;
+    job.photos = photoPaths;
+    job.config = config;
+    job.outputPath = outputPath;
+    job.options = printOptions;
+
+    std::string jobId = ComposeQueue::getInstance().enqueue(
+        std::move(job), broadcastComposeComplete(app_));
+
+    res.set_header("X-Compose-Job", jobId);
+    res.set_header("Access-Control-Expose-Headers", "X-Compose-Job");
+    res.set_content(std::string(preview.begin(), preview.end()), "image/jpeg");
+  } catch (const std::exception& e) {
+    res.status = 500;
+    res.set_content(jsonError(e.what(), 500), "application/json");
+  }
+}
+
+std::shared_ptr<ComposeSession>
+HTTPServer::findComposeSession(const std::string &id) {
+  std::lock_guard<std::mutex> lock(composeSessionsMutex_);
+  auto it = composeSessions_.find(id);
+  return it != composeSessions_.end() ? it->second : nullptr;
+}
+
+namespace {
+
+// Each open session holds print-size fitted photos (tens of MB at 600 dpi)
+constexpr size_t MAX_COMPOSE_SESSIONS = 8;
+constexpr auto COMPOSE_SESSION_IDLE_TIMEOUT = std::chrono::minutes(15);
+
+} // namespace
+
+void HTTPServer::pruneComposeSessionsLocked() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = composeSessions_.begin(); it != composeSessions_.end();) {
+    // Submitted sessions are tracked by ComposeQueue from then on
+    if (it->second->submitted()) {
+      it = composeSessions_.erase(it);
+    } else if (now - it->second->lastActivity() > COMPOSE_SESSION_IDLE_TIMEOUT) {
+      std::cout << "Compose session " << it->first << " idle, dropped"
+                << std::endl;
+      it->second->cancel();
+      it = composeSessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Still full: the guest least recently seen has most likely walked away
+  while (composeSessions_.size() >= MAX_COMPOSE_SESSIONS) {
+    auto oldest = std::min_element(
+        composeSessions_.begin(), composeSessions_.end(),
+        [](const auto &a, const auto &b) {
+          return a.second->lastActivity() < b.second->lastActivity();
+        });
+    std::cout << "Compose session " << oldest->first << " evicted" << std::endl;
+    oldest->second->cancel();
+    composeSessions_.erase(oldest);
+  }
+}
+
+void HTTPServer::handleCreateComposeSession(const httplib::Request &req,
+                                            httplib::Response &res) {
+  setCorsHeaders(res);
+
+  try {
+    json body = json::parse(req.body);
+
+    std::string layoutPath = body.value("layoutPath", "");
+    if (layoutPath.empty()) {
+      res.status = 400;
+      res.set_content(jsonError("layoutPath required", 400),
+                      "application/json");
+      return;
+    }
+
+    std::string outputPath = composeOutputPath(body);
+    if (outputPath.empty()) {
+      res.status = 400;
+      res.set_content(
+          jsonError("outputPath must be a .jpg, .png or .tif inside the "
+                    "storage directory, or eventId given",
+                    400),
+          "application/json");
+      return;
+    }
+
+    PrintOptions printOptions;
+    if (!composePrintOptions(body, printOptions)) {
+      res.status = 400;
+      res.set_content(
+          jsonError("renditions[].path must be a .jpg, .webp or .png inside "
+                    "the storage directory",
+                    400),
+          "application/json");
+      return;
+    }
+
+    LayoutConfig config = composeConfig(body, layoutPath);
+    if (config.slots.empty()) {
+      res.status = 400;
+      res.set_content(jsonError("Layout has no slots", 400), "application/json");
+      return;
+    }
+
+    auto session = ComposeSession::create(layoutPath, config, outputPath,
+                                          printOptions,
+                                          broadcastComposeComplete(app_));
+
+    {
+      std::lock_guard<std::mutex> lock(composeSessionsMutex_);
+      pruneComposeSessionsLocked();
+      composeSessions_[session->id()] = session;
+    }
+
+    json response;
+    response["success"] = true;
+    response["data"] = {{"sessionId", session->id()},
+                        {"slotsCount", session->slotCount()}};
+    res.set_content(response.dump(), "application/json");
+  } catch (const std::exception& e) {
+    res.status = 500;
+    res.set_content(jsonError(e.what(), 500), "application/json");
+  }
+}
+
+void HTTPServer::handleAddComposeSessionPhoto(const httplib::Request &req,
+                                              httplib::Response &res) {
+  setCorsHeaders(res);
+
+  try {
+    auto session = findComposeSession(req.matches[1]);
+    if (!session) {
+      res.status = 404;
+      res.set_content(jsonError("Compose session not found", 404),
+                      "application/json");
+      return;
+    }
+
+    json body = json::parse(req.body);
+    std::string photo = body.value("photo", "");
+    if (photo.empty()) {
+      res.status = 400;
+      res.set_content(jsonError("photo required", 400), "application/json");
+      return;
+    }
+
+    int slot = session->addPhoto(photo, body.value("slot", -1));
+    if (slot < 0) {
+      res.status = 409;
+      res.set_content(jsonError("No free slot in compose session", 409),
+                      "application/json");
+      return;
+    }
+
+    json response;
+    response["success"] = true;
+    response["data"] = {{"sessionId", session->id()},
+                        {"slot", slot},
+                        {"photos", session->photoCount()},
+                        {"slotsCount", session->slotCount()}};
+    res.set_content(response.dump(), "application/json");
+  } catch (const std::exception& e) {
+    res.status = 500;
+    res.set_content(jsonError(e.what(), 500), "application/json");
+  }
+}
+
+void HTTPServer::handleGetComposeSession(const httplib::Request &req,
+                                         httplib::Response &res) {
+  setCorsHeaders(res);
+
+  auto session = findComposeSession(req.matches[1]);
+  if (!session) {
+    res.status = 404;
+    res.set_content(jsonError("Compose session not found", 404),
+                    "application/json");
+    return;
+  }
+
+  json response;
+  response["success"] = true;
+  response["data"] = {{"sessionId", session->id()},
+                      {"photos", session->photoCount()},
+                      {"slotsCount", session->slotCount()},
+                      {"submitted", session->submitted()},
+                      {"failedSlots", session->failedSlots()},
+                      {"jobId", session->jobId()}};
+  res.set_content(response.dump(), "application/json");
+}
+
+void HTTPServer::handleDeleteComposeSession(const httplib::Request &req,
+                                            httplib::Response &res) {
+  setCorsHeaders(res);
+
+  std::shared_ptr<ComposeSession> session;
+  {
+    std::lock_guard<std::mutex> lock(composeSessionsMutex_);
+    auto it = composeSessions_.find(req.matches[1]);
+    if (it != composeSessions_.end()) {
+      session = it->second;
+      composeSessions_.erase(it);
+    }
+  }
+
+  if (!session) {
+    res.status = 404;
+    res.set_content(jsonError("Compose session not found", 404),
+                    "application/json");
+    return;
+  }
+
+  // A strip already queued still prints; otherwise its photos are released
+  session->cancel();
+  res.set_content(jsonResponse(true, "Compose session deleted"),
+                  "application/json");
+}
+
 void HTTPServer::handleGetLayoutSlots(const httplib::Request &req,
                                       httplib::Response &res) {
   setCorsHeaders(res);
@@ -1445,6 +2353,7 @@ void HTTPServer::handleGetLayoutSlots(const httplib::Request &req,
     slotJson["y"] = slot.y;
     slotJson["width"] = slot.width;
     slotJson["height"] = slot.height;
+    slotJson["rotation"] = slot.rotation;
     slotsJson.push_back(slotJson);
   }
 
@@ -1480,6 +2389,7 @@ void HTTPServer::handleSaveLayoutConfig(const httplib::Request &req,
         si.y = slot.value("y", 0);
         si.width = slot.value("width", 0);
         si.height = slot.value("height", 0);
+        si.rotation = slot.value("rotation", 0);
         config.slots.push_back(si);
       }
     }
@@ -180,6 +180,26 @@ void WebSocketServer::onMessage(ConnectionHandle hdl,
       }
       // Debug logging (optional, can be removed in production)
       // std::cout << "Client ready. Total ready: " << readyCount << std::endl;
+    } else if (type == "camera:properties") {
+      // Snapshot served from the camera's property cache; later changes
+      // arrive as "camera:property" events
+      json response;
+      response["type"] = "camera:properties";
+      auto *camMgr = app_->getCameraManager();
+      if (camMgr) {
+        CameraSettings settings = camMgr->getSettings();
+        response["data"]["iso"] = settings.iso;
+        response["data"]["aperture"] = settings.aperture;
+        response["data"]["shutterSpeed"] = settings.shutterSpeed;
+        response["data"]["whiteBalance"] = settings.whiteBalance;
+        response["data"]["supportedISO"] = camMgr->getSupportedISO();
+        response["data"]["supportedAperture"] = camMgr->getSupportedApertures();
+        response["data"]["supportedShutterSpeed"] =
+            camMgr->getSupportedShutterSpeeds();
+        response["data"]["supportedWhiteBalance"] =
+            camMgr->getSupportedWhiteBalances();
+      }
+      server_.send(hdl, response.dump(), websocketpp::frame::opcode::text);
     }
   } catch (const std::exception &e) {
     std::cerr << "Error handling WebSocket message: " << e.what() << std::endl;
@@ -317,4 +337,30 @@ void WebSocketServer::broadcastCaptureComplete(const std::string &imagePath) {
   broadcast(message.dump());
 }
 
+void WebSocketServer::broadcastPropertyChange(const PropertyChange &change) {
+  json message;
+  message["type"] = "camera:property";
+  message["data"]["property"] = change.property;
+  message["data"]["value"] = change.value;
+  if (change.optionsChanged) {
+    message["data"]["options"] = change.options;
+  }
+  broadcast(message.dump());
+}
+
+void WebSocketServer::broadcastCameraList(
+    const std::vector<CameraInfo> &cameras) {
+  json message;
+  message["type"] = "cameras:changed";
+  message["data"] = json::array();
+  for (const auto &cam : cameras) {
+    json camJson;
+    camJson["name"] = cam.name;
+    camJson["type"] = cam.type == CameraType::Canon ? "canon" : "webcam";
+    camJson["connected"] = cam.connected;
+    message["data"].push_back(camJson);
+  }
+  broadcast(message.dump());
+}
+
 } // namespace photobooth
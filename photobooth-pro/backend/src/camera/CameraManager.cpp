@@ -11,11 +11,29 @@
 #ifdef _WIN32
 #include "camera/CanonCamera.h"
 #include "core/SharedMemoryManager.h"
+#include <objbase.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 #endif
 
 namespace photobooth {
 
-CameraManager::CameraManager() : activeCamera_(nullptr), initialized_(false) {
+// Registry refresh when no hot-plug event arrives. EDSDK only reports the
+// removal of a camera with an open session, so an idle body that gets
+// unplugged is noticed on this cadence.
+static constexpr int FALLBACK_RESCAN_MS = 3000;
+
+static EdsError EDSCALLBACK handleCameraAdded(EdsVoid *context) {
+  static_cast<CameraManager *>(context)->requestRescan();
+  return EDS_ERR_OK;
+}
+
+CameraManager::CameraManager() : initialized_(false) {
 #ifdef _WIN32
   sharedMemory_ = std::make_unique<SharedMemoryManager>();
   // 20MB buffer to be safe for 24MP+ images if raw, but high quality JPEG is usually 5-10MB max.
@@ -34,8 +52,16 @@ bool CameraManager::initialize() {
   if (err == EDS_ERR_OK) {
     initialized_ = true;
     std::cout << "EDSDK initialized successfully." << std::endl;
-    // Wait for SDK to detect USB-connected cameras
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    // Discovery runs in the background instead of blocking startup. The
+    // camera-added handler is dispatched from EdsGetEvent in the main loop.
+    EdsSetCameraAddedHandler(handleCameraAdded, this);
+    rescanRequested_ = true;
+    discoveryRunning_ = true;
+    discoveryThread_ = std::thread(&CameraManager::discoveryLoop, this);
+#ifdef __linux__
+    hotplugThread_ = std::thread(&CameraManager::hotplugWatchLoop, this);
+#endif
     return true;
   } else {
     std::cerr << "Failed to initialize EDSDK. Error: " << err << std::endl;
@@ -44,13 +70,31 @@ bool CameraManager::initialize() {
 }
 
 void CameraManager::shutdown() {
-  if (activeCamera_) {
-    activeCamera_->disconnect();
-    delete activeCamera_;
-    activeCamera_ = nullptr;
+  if (discoveryRunning_) {
+    {
+      std::lock_guard<std::mutex> lock(discoveryMutex_);
+      discoveryRunning_ = false;
+    }
+    discoveryCV_.notify_all();
+    if (discoveryThread_.joinable())
+      discoveryThread_.join();
+#ifdef __linux__
+    if (hotplugThread_.joinable())
+      hotplugThread_.join();
+#endif
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (activeCamera_) {
+      activeCamera_->disconnect();
+      activeCamera_.reset();
+      activeCameraName_.clear();
+    }
   }
 
   if (initialized_) {
+    EdsSetCameraAddedHandler(nullptr, nullptr);
     EdsTerminateSDK();
     initialized_ = false;
     std::cout << "EDSDK terminated." << std::endl;
@@ -62,34 +106,11 @@ void CameraManager::detectWebcams() {
 }
 
 std::vector<std::string> CameraManager::detectCameras() {
-  if (!initialized_)
-    return {};
-
-  EdsCameraListRef cameraList = nullptr;
-  EdsUInt32 count = 0;
   std::vector<std::string> cameras;
-
-  // 1. Detect Canon Cameras
-  EdsError err = EdsGetCameraList(&cameraList);
-  if (err == EDS_ERR_OK) {
-    err = EdsGetChildCount(cameraList, &count);
-    if (err == EDS_ERR_OK) {
-      for (EdsUInt32 i = 0; i < count; i++) {
-        EdsCameraRef camRef = nullptr;
-        err = EdsGetChildAtIndex(cameraList, i, &camRef);
-        if (err == EDS_ERR_OK) {
-          EdsDeviceInfo deviceInfo;
-          err = EdsGetDeviceInfo(camRef, &deviceInfo);
-          if (err == EDS_ERR_OK) {
-            cameras.push_back(std::string(deviceInfo.szDeviceDescription));
-          }
-          EdsRelease(camRef);
-        }
-      }
-    }
-    EdsRelease(cameraList);
+  std::lock_guard<std::mutex> lock(registryMutex_);
+  for (const auto &info : registry_) {
+    cameras.push_back(info.name);
   }
-
   return cameras;
 }
 
@@ -97,13 +118,29 @@ bool CameraManager::selectCamera(const std::string &cameraName) {
   if (!initialized_)
     return false;
 
-  // Close existing
-  if (activeCamera_) {
-    activeCamera_->disconnect();
-    delete activeCamera_;
-    activeCamera_ = nullptr;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Close existing
+    if (activeCamera_) {
+      activeCamera_->disconnect();
+      activeCamera_.reset();
+      activeCameraName_.clear();
+    }
+
+    found = openCamera(cameraName);
+    if (found) {
+      preferredCamera_ = activeCameraName_;
+    }
   }
 
+  notifyCameraList();
+  return found;
+}
+
+// Caller holds mutex_
+bool CameraManager::openCamera(const std::string &cameraName) {
   // Canon selection logic
   EdsCameraListRef cameraList = nullptr;
   EdsUInt32 count = 0;
@@ -122,14 +159,16 @@ bool CameraManager::selectCamera(const std::string &cameraName) {
 
           if (cameraName.empty() || std::string(deviceInfo.szDeviceDescription) == cameraName ||
               cameraName == "Auto") {
-            activeCamera_ = new CanonCamera(camRef);
+            auto canon = std::make_shared<CanonCamera>(camRef);
+            canon->setDisconnectCallback([this]() { onActiveCameraLost(); });
+            activeCamera_ = canon;
             if (activeCamera_->connect()) {
+              activeCamera_->setPropertyChangeCallback(propertyChangeCallback_);
+              activeCameraName_ = deviceInfo.szDeviceDescription;
               found = true;
               break;
             } else {
-              delete activeCamera_;
-              activeCamera_ = nullptr;
-              EdsRelease(camRef);
+              activeCamera_.reset();
             }
           } else {
             EdsRelease(camRef);
@@ -140,24 +179,114 @@ bool CameraManager::selectCamera(const std::string &cameraName) {
     EdsRelease(cameraList);
   }
 
+  // Resume the stream for clients that were watching before a replug
+  if (found && mjpegStreaming_) {
+    activeCamera_->startLiveView([this](const std::vector<uint8_t> &data,
+                                        int w, int h) {
+      pushStreamFrame(data, w, h);
+    });
+  }
+
   return found;
 }
 
-ICamera *CameraManager::getActiveCamera() { return activeCamera_; }
+void CameraManager::requestRescan() {
+  {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    rescanRequested_ = true;
+  }
+  discoveryCV_.notify_all();
+}
 
-std::string CameraManager::getActiveCameraName() const {
-  if (activeCamera_)
-    return activeCamera_->getName();
-  return "";
+void CameraManager::onActiveCameraLost() {
+  // Called from the EDSDK event thread; the discovery thread does the
+  // teardown so we never delete the camera from inside its own callback
+  {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    activeCameraLost_ = true;
+  }
+  discoveryCV_.notify_all();
 }
 
-std::vector<CameraInfo> CameraManager::getAvailableCameras() const {
-  std::vector<CameraInfo> cameras;
+void CameraManager::discoveryLoop() {
+#ifdef _WIN32
+  CoInitializeEx(NULL, COINIT_MULTITHREADED);
+#endif
 
-  if (!initialized_)
-    return cameras;
+  while (true) {
+    bool lost = false;
+    {
+      std::unique_lock<std::mutex> lock(discoveryMutex_);
+      discoveryCV_.wait_for(lock, std::chrono::milliseconds(FALLBACK_RESCAN_MS),
+                            [this] {
+                              return rescanRequested_ || activeCameraLost_ ||
+                                     !discoveryRunning_;
+                            });
+      if (!discoveryRunning_)
+        break;
+      lost = activeCameraLost_;
+      rescanRequested_ = false;
+      activeCameraLost_ = false;
+    }
+
+    bool changed = false;
+    if (lost) {
+      releaseLostCamera();
+      changed = true;
+    }
+    if (refreshRegistry()) {
+      changed = true;
+    }
+
+    // Pick a camera: the first one on a fresh start, otherwise only the body
+    // the operator had selected (so a second camera is never swapped in)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!activeCamera_) {
+        std::string target;
+        {
+          std::lock_guard<std::mutex> registryLock(registryMutex_);
+          for (const auto &info : registry_) {
+            if (preferredCamera_.empty() || info.name == preferredCamera_) {
+              target = info.name;
+              break;
+            }
+          }
+        }
+        if (!target.empty() && openCamera(target)) {
+          preferredCamera_ = activeCameraName_;
+          std::cout << "Selected camera: " << activeCameraName_ << std::endl;
+          changed = true;
+        }
+      }
+    }
+
+    if (changed) {
+      notifyCameraList();
+    }
+  }
+
+#ifdef _WIN32
+  CoUninitialize();
+#endif
+}
+
+void CameraManager::releaseLostCamera() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeCamera_ && !activeCamera_->isConnected()) {
+    std::cout << "Active camera lost, waiting for " << activeCameraName_
+              << " to reconnect" << std::endl;
+    // Request threads still using the camera hold their own reference; it is
+    // destroyed when the last of them is done
+    activeCamera_->disconnect();
+    activeCamera_.reset();
+    activeCameraName_.clear();
+  }
+}
+
+bool CameraManager::refreshRegistry() {
+  std::vector<CameraInfo> cameras;
 
-  // Detect Canon cameras
   EdsCameraListRef cameraList = nullptr;
   EdsUInt32 count = 0;
 
@@ -175,7 +304,7 @@ std::vector<CameraInfo> CameraManager::getAvailableCameras() const {
             CameraInfo info;
             info.name = std::string(deviceInfo.szDeviceDescription);
             info.type = CameraType::Canon;
-            info.connected = (activeCamera_ && activeCamera_->getName() == info.name);
+            info.connected = false;
             info.webcamIndex = -1;
             cameras.push_back(info);
           }
@@ -186,6 +315,97 @@ std::vector<CameraInfo> CameraManager::getAvailableCameras() const {
     EdsRelease(cameraList);
   }
 
+  std::lock_guard<std::mutex> lock(registryMutex_);
+  bool changed = cameras.size() != registry_.size();
+  for (size_t i = 0; !changed && i < cameras.size(); i++) {
+    changed = cameras[i].name != registry_[i].name;
+  }
+  if (changed) {
+    registry_ = std::move(cameras);
+    std::cout << "Camera registry updated: " << registry_.size()
+              << " camera(s)" << std::endl;
+  }
+  return changed;
+}
+
+void CameraManager::setCameraListCallback(CameraListCallback callback) {
+  std::lock_guard<std::mutex> lock(registryMutex_);
+  cameraListCallback_ = callback;
+}
+
+void CameraManager::notifyCameraList() {
+  CameraListCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    callback = cameraListCallback_;
+  }
+  if (callback)
+    callback(getAvailableCameras());
+}
+
+#ifdef __linux__
+void CameraManager::hotplugWatchLoop() {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  // USB bodies show up as /dev/bus/usb/<bus>/<device>. inotify is not
+  // recursive, so watch each bus directory.
+  if (DIR *dir = opendir("/dev/bus/usb")) {
+    while (dirent *entry = readdir(dir)) {
+      if (entry->d_name[0] == '.')
+        continue;
+      std::string path = std::string("/dev/bus/usb/") + entry->d_name;
+      inotify_add_watch(fd, path.c_str(), IN_CREATE | IN_DELETE);
+    }
+    closedir(dir);
+  }
+
+  alignas(inotify_event) char buffer[4096];
+  while (discoveryRunning_) {
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 500) <= 0)
+      continue;
+    // Drain the queue; any node change is worth one rescan
+    if (read(fd, buffer, sizeof(buffer)) > 0) {
+      requestRescan();
+    }
+  }
+
+  close(fd);
+}
+#endif
+
+std::shared_ptr<ICamera> CameraManager::getActiveCamera() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return activeCamera_;
+}
+
+std::string CameraManager::getActiveCameraName() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeCamera_)
+    return activeCamera_->getName();
+  return "";
+}
+
+std::vector<CameraInfo> CameraManager::getAvailableCameras() const {
+  if (!initialized_)
+    return {};
+
+  std::string activeName;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    activeName = activeCameraName_;
+  }
+
+  std::vector<CameraInfo> cameras;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    cameras = registry_;
+  }
+  for (auto &info : cameras) {
+    info.connected = !activeName.empty() && info.name == activeName;
+  }
   return cameras;
 }
 
@@ -196,44 +416,33 @@ bool CameraManager::selectWebcam(int deviceIndex) {
 }
 
 bool CameraManager::startLiveView(LiveViewCallback callback) {
-  if (activeCamera_)
-    return activeCamera_->startLiveView(callback);
+  if (auto camera = getActiveCamera())
+    return camera->startLiveView(callback);
   return false;
 }
 
 void CameraManager::stopLiveView() {
-  if (activeCamera_)
-    activeCamera_->stopLiveView();
+  if (auto camera = getActiveCamera())
+    camera->stopLiveView();
 }
 
 bool CameraManager::startMjpegStream() {
-  if (!activeCamera_) return false;
+  auto camera = getActiveCamera();
+  if (!camera) return false;
   if (mjpegStreaming_) {
     streamClients_++;
     return true;
   }
 
   // Stop any existing live view
-  activeCamera_->stopLiveView();
+  camera->stopLiveView();
 
   // Start live view with callback that feeds the frame buffer
   auto callback = [this](const std::vector<uint8_t> &data, int w, int h) {
-    {
-      std::lock_guard<std::mutex> lock(frameMutex_);
-      latestFrame_ = data;
-      frameSeq_++;
-      
-      // IPC: Write to Shared Memory for Electron
-#ifdef _WIN32
-      if (sharedMemory_) {
-          sharedMemory_->writeFrame(data, w, h);
-      }
-#endif
-    }
-    frameCV_.notify_all();
+    pushStreamFrame(data, w, h);
   };
 
-  if (activeCamera_->startLiveView(callback)) {
+  if (camera->startLiveView(callback)) {
     mjpegStreaming_ = true;
     streamClients_++;
     std::cout << "MJPEG stream started" << std::endl;
@@ -242,6 +451,33 @@ bool CameraManager::startMjpegStream() {
   return false;
 }
 
+void CameraManager::pushStreamFrame(const std::vector<uint8_t> &data, int w,
+                                    int h) {
+  {
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    latestFrame_ = data;
+    frameSeq_++;
+
+    // IPC: Write to Shared Memory for Electron
+#ifdef _WIN32
+    if (sharedMemory_) {
+        sharedMemory_->writeFrame(data, w, h);
+    }
+#endif
+  }
+  frameCV_.notify_all();
+
+  std::lock_guard<std::mutex> lock(frameSinkMutex_);
+  if (frameSink_) {
+    frameSink_(data, w, h);
+  }
+}
+
+void CameraManager::setFrameSink(LiveViewCallback sink) {
+  std::lock_guard<std::mutex> lock(frameSinkMutex_);
+  frameSink_ = std::move(sink);
+}
+
 void CameraManager::stopMjpegStream() {
   int clients = --streamClients_;
   if (clients <= 0) {
@@ -271,8 +507,8 @@ bool CameraManager::waitForFrame(std::vector<uint8_t> &frame, int timeoutMs) {
 }
 
 void CameraManager::capture(CaptureMode mode, CaptureCallback callback) {
-  if (activeCamera_) {
-    activeCamera_->capture(mode, callback);
+  if (auto camera = getActiveCamera()) {
+    camera->capture(mode, callback);
   } else {
     if (callback) {
       CaptureResult res;
@@ -285,8 +521,8 @@ void CameraManager::capture(CaptureMode mode, CaptureCallback callback) {
 
 void CameraManager::captureWithCountdown(int seconds, CaptureMode mode,
                                          CaptureCallback callback) {
-  if (activeCamera_) {
-    activeCamera_->captureWithCountdown(seconds, mode, callback);
+  if (auto camera = getActiveCamera()) {
+    camera->captureWithCountdown(seconds, mode, callback);
   } else {
     if (callback) {
       CaptureResult res;
@@ -298,40 +534,47 @@ void CameraManager::captureWithCountdown(int seconds, CaptureMode mode,
 }
 
 bool CameraManager::setSettings(const CameraSettings &settings) {
-  if (activeCamera_)
-    return activeCamera_->setSettings(settings);
+  if (auto camera = getActiveCamera())
+    return camera->setSettings(settings);
   return false;
 }
 
 CameraSettings CameraManager::getSettings() const {
-  if (activeCamera_)
-    return activeCamera_->getSettings();
+  if (auto camera = getActiveCamera())
+    return camera->getSettings();
   return CameraSettings();
 }
 
+void CameraManager::setPropertyChangeCallback(PropertyChangeCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  propertyChangeCallback_ = callback;
+  if (activeCamera_)
+    activeCamera_->setPropertyChangeCallback(callback);
+}
+
 void CameraManager::detectCanonCameras() {}
 
 std::vector<int> CameraManager::getSupportedISO() const {
-  if (activeCamera_)
-    return activeCamera_->getSupportedISO();
+  if (auto camera = getActiveCamera())
+    return camera->getSupportedISO();
   return {};
 }
 
 std::vector<std::string> CameraManager::getSupportedApertures() const {
-  if (activeCamera_)
-    return activeCamera_->getSupportedApertures();
+  if (auto camera = getActiveCamera())
+    return camera->getSupportedApertures();
   return {};
 }
 
 std::vector<std::string> CameraManager::getSupportedShutterSpeeds() const {
-  if (activeCamera_)
-    return activeCamera_->getSupportedShutterSpeeds();
+  if (auto camera = getActiveCamera())
+    return camera->getSupportedShutterSpeeds();
   return {};
 }
 
 std::vector<std::string> CameraManager::getSupportedWhiteBalances() const {
-  if (activeCamera_)
-    return activeCamera_->getSupportedWhiteBalances();
+  if (auto camera = getActiveCamera())
+    return camera->getSupportedWhiteBalances();
   return {};
 }
 
@@ -57,6 +57,44 @@ static const std::map<EdsUInt32, std::string> WB_MAP = {
     {0, "Auto"}, {1, "Daylight"}, {2, "Cloudy"}, {3, "Tungsten"},
     {4, "Fluorescent"}, {5, "Flash"}, {6, "Manual"}, {8, "Shade"}, {9, "ColorTemp"}};
 
+// Properties mirrored in the PropertyCache and pushed to the change feed
+static const std::vector<EdsPropertyID> CACHED_PROPERTIES = {
+    kEdsPropID_ISOSpeed, kEdsPropID_Av, kEdsPropID_Tv, kEdsPropID_WhiteBalance};
+
+static const char *propertyKey(EdsPropertyID propertyID) {
+  switch (propertyID) {
+  case kEdsPropID_ISOSpeed: return "iso";
+  case kEdsPropID_Av: return "aperture";
+  case kEdsPropID_Tv: return "shutterSpeed";
+  case kEdsPropID_WhiteBalance: return "whiteBalance";
+  default: return nullptr;
+  }
+}
+
+static std::string propertyLabel(EdsPropertyID propertyID, EdsUInt32 code) {
+  switch (propertyID) {
+  case kEdsPropID_ISOSpeed: {
+    auto it = ISO_MAP.find(code);
+    if (it == ISO_MAP.end()) return "";
+    return it->second == 0 ? "Auto" : std::to_string(it->second);
+  }
+  case kEdsPropID_Av: {
+    auto it = AV_MAP_CORRECT.find(code);
+    return it != AV_MAP_CORRECT.end() ? it->second : "";
+  }
+  case kEdsPropID_Tv: {
+    auto it = TV_MAP.find(code);
+    return it != TV_MAP.end() ? it->second : "";
+  }
+  case kEdsPropID_WhiteBalance: {
+    auto it = WB_MAP.find(code);
+    return it != WB_MAP.end() ? it->second : "";
+  }
+  default:
+    return "";
+  }
+}
+
 // Helpers to reverse lookup
 EdsUInt32 getISOCode(int iso) {
   for (const auto &pair : ISO_MAP) {
@@ -186,6 +224,10 @@ bool CanonCamera::connect() {
     setPropertyUInt32(kEdsPropID_SaveTo, kEdsSaveTo_Host);
     setCapacity();
 
+    // One round-trip per property now; property events keep it current
+    propertyCache_.setCamera(camera_);
+    propertyCache_.prime(CACHED_PROPERTIES);
+
     uiUnlock();
 
     // ========================================================================
@@ -267,11 +309,13 @@ bool CanonCamera::connect() {
 }
 
 void CanonCamera::disconnect() {
+  // Live view may still need joining after a Shutdown event cleared connected_
+  stopLiveView();
   if (connected_) {
-    stopLiveView();
     EdsCloseSession(camera_);
     connected_ = false;
   }
+  propertyCache_.clear();
 }
 
 bool CanonCamera::isConnected() const { return connected_; }
@@ -391,11 +435,20 @@ bool CanonCamera::setSettings(const CameraSettings &settings) {
   if (!connected_) return false;
 
   bool success = true;
+  auto apply = [this, &success](EdsPropertyID propertyID, EdsUInt32 code) {
+    if (setPropertyUInt32(propertyID, code) == EDS_ERR_OK) {
+      if (propertyCache_.storeValue(propertyID, code)) {
+        notifyPropertyChange(propertyID, false);
+      }
+    } else {
+      success = false;
+    }
+  };
 
-  if (setPropertyUInt32(kEdsPropID_ISOSpeed, getISOCode(settings.iso)) != EDS_ERR_OK) success = false;
-  if (setPropertyUInt32(kEdsPropID_Av, getAvCode(settings.aperture)) != EDS_ERR_OK) success = false;
-  if (setPropertyUInt32(kEdsPropID_Tv, getTvCode(settings.shutterSpeed)) != EDS_ERR_OK) success = false;
-  if (setPropertyUInt32(kEdsPropID_WhiteBalance, getWBCode(settings.whiteBalance)) != EDS_ERR_OK) success = false;
+  apply(kEdsPropID_ISOSpeed, getISOCode(settings.iso));
+  apply(kEdsPropID_Av, getAvCode(settings.aperture));
+  apply(kEdsPropID_Tv, getTvCode(settings.shutterSpeed));
+  apply(kEdsPropID_WhiteBalance, getWBCode(settings.whiteBalance));
 
   settings_ = settings;
   return success;
@@ -407,22 +460,22 @@ CameraSettings CanonCamera::getSettings() const {
   CameraSettings current;
   EdsUInt32 val;
 
-  if (getPropertyData(kEdsPropID_ISOSpeed, &val, sizeof(val)) == EDS_ERR_OK) {
+  if (propertyCache_.getValue(kEdsPropID_ISOSpeed, val)) {
       auto it = ISO_MAP.find(val);
       current.iso = (it != ISO_MAP.end()) ? it->second : 0;
   }
 
-  if (getPropertyData(kEdsPropID_Av, &val, sizeof(val)) == EDS_ERR_OK) {
+  if (propertyCache_.getValue(kEdsPropID_Av, val)) {
       auto it = AV_MAP_CORRECT.find(val);
       current.aperture = (it != AV_MAP_CORRECT.end()) ? it->second : "";
   }
 
-  if (getPropertyData(kEdsPropID_Tv, &val, sizeof(val)) == EDS_ERR_OK) {
+  if (propertyCache_.getValue(kEdsPropID_Tv, val)) {
       auto it = TV_MAP.find(val);
       current.shutterSpeed = (it != TV_MAP.end()) ? it->second : "";
   }
 
-  if (getPropertyData(kEdsPropID_WhiteBalance, &val, sizeof(val)) == EDS_ERR_OK) {
+  if (propertyCache_.getValue(kEdsPropID_WhiteBalance, val)) {
       auto it = WB_MAP.find(val);
       current.whiteBalance = (it != WB_MAP.end()) ? it->second : "";
   }
@@ -433,12 +486,9 @@ CameraSettings CanonCamera::getSettings() const {
 std::vector<int> CanonCamera::getSupportedISO() const {
   if (!connected_) return {};
 
-  EdsPropertyDesc desc = {0};
-  EdsGetPropertyDesc(camera_, kEdsPropID_ISOSpeed, &desc);
-
   std::vector<int> result;
-  for (EdsInt32 i = 0; i < desc.numElements; i++) {
-    auto it = ISO_MAP.find(desc.propDesc[i]);
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_ISOSpeed)) {
+    auto it = ISO_MAP.find(code);
     if (it != ISO_MAP.end() && it->second != 0) {
       result.push_back(it->second);
     }
@@ -449,12 +499,9 @@ std::vector<int> CanonCamera::getSupportedISO() const {
 std::vector<std::string> CanonCamera::getSupportedApertures() const {
   if (!connected_) return {};
 
-  EdsPropertyDesc desc = {0};
-  EdsGetPropertyDesc(camera_, kEdsPropID_Av, &desc);
-
   std::vector<std::string> result;
-  for (EdsInt32 i = 0; i < desc.numElements; i++) {
-    auto it = AV_MAP_CORRECT.find(desc.propDesc[i]);
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_Av)) {
+    auto it = AV_MAP_CORRECT.find(code);
     if (it != AV_MAP_CORRECT.end()) {
       result.push_back(it->second);
     }
@@ -465,12 +512,9 @@ std::vector<std::string> CanonCamera::getSupportedApertures() const {
 std::vector<std::string> CanonCamera::getSupportedShutterSpeeds() const {
   if (!connected_) return {};
 
-  EdsPropertyDesc desc = {0};
-  EdsGetPropertyDesc(camera_, kEdsPropID_Tv, &desc);
-
   std::vector<std::string> result;
-  for (EdsInt32 i = 0; i < desc.numElements; i++) {
-    auto it = TV_MAP.find(desc.propDesc[i]);
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_Tv)) {
+    auto it = TV_MAP.find(code);
     if (it != TV_MAP.end()) {
       result.push_back(it->second);
     }
@@ -481,12 +525,9 @@ std::vector<std::string> CanonCamera::getSupportedShutterSpeeds() const {
 std::vector<std::string> CanonCamera::getSupportedWhiteBalances() const {
   if (!connected_) return {};
 
-  EdsPropertyDesc desc = {0};
-  EdsGetPropertyDesc(camera_, kEdsPropID_WhiteBalance, &desc);
-
   std::vector<std::string> result;
-  for (EdsInt32 i = 0; i < desc.numElements; i++) {
-    auto it = WB_MAP.find(desc.propDesc[i]);
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_WhiteBalance)) {
+    auto it = WB_MAP.find(code);
     if (it != WB_MAP.end()) {
       result.push_back(it->second);
     }
@@ -494,6 +535,46 @@ std::vector<std::string> CanonCamera::getSupportedWhiteBalances() const {
   return result;
 }
 
+void CanonCamera::setPropertyChangeCallback(PropertyChangeCallback callback) {
+  std::lock_guard<std::mutex> lock(propertyCallbackMutex_);
+  propertyChangeCallback_ = callback;
+}
+
+void CanonCamera::notifyPropertyChange(EdsPropertyID propertyID,
+                                       bool optionsChanged) {
+  PropertyChangeCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(propertyCallbackMutex_);
+    callback = propertyChangeCallback_;
+  }
+  if (!callback) return;
+
+  PropertyChange change;
+  change.property = propertyKey(propertyID);
+  change.optionsChanged = optionsChanged;
+
+  EdsUInt32 code;
+  if (propertyCache_.getValue(propertyID, code)) {
+    change.value = propertyLabel(propertyID, code);
+  }
+
+  if (optionsChanged) {
+    for (EdsInt32 option : propertyCache_.getDesc(propertyID)) {
+      std::string label = propertyLabel(propertyID, option);
+      // Auto ISO is not offered as a selectable option (see getSupportedISO)
+      if (!label.empty() && label != "Auto") {
+        change.options.push_back(label);
+      }
+    }
+  }
+
+  callback(change);
+}
+
+void CanonCamera::setDisconnectCallback(std::function<void()> callback) {
+  disconnectCallback_ = callback;
+}
+
 // Callbacks
 
 bool CanonCamera::downloadImage(EdsDirectoryItemRef dirItem, CaptureResult &result) {
@@ -548,12 +629,37 @@ EdsError EDSCALLBACK CanonCamera::handlePropertyEvent(EdsPropertyEvent event,
                                                       EdsPropertyID property,
                                                       EdsUInt32 param,
                                                       EdsVoid *context) {
+  CanonCamera *cam = static_cast<CanonCamera *>(context);
+  if (!cam || !propertyKey(property)) return EDS_ERR_OK;
+
+  // Only re-read when the camera says something moved; skip the feed if the
+  // value matches what we already hold (e.g. echo of our own setSettings,
+  // which notifies on its own)
+  if (event == kEdsPropertyEvent_PropertyChanged) {
+    if (cam->propertyCache_.refreshValue(property)) {
+      cam->notifyPropertyChange(property, false);
+    }
+  } else if (event == kEdsPropertyEvent_PropertyDescChanged) {
+    if (cam->propertyCache_.refreshDesc(property)) {
+      cam->notifyPropertyChange(property, true);
+    }
+  }
   return EDS_ERR_OK;
 }
 
 EdsError EDSCALLBACK CanonCamera::handleStateEvent(EdsStateEvent event,
                                                    EdsUInt32 param,
                                                    EdsVoid *context) {
+  CanonCamera *cam = static_cast<CanonCamera *>(context);
+  if (!cam) return EDS_ERR_OK;
+
+  if (event == kEdsStateEvent_Shutdown) {
+    // Cable pulled or body switched off: the session is already closed on the
+    // camera side, so just mark it dead and let the owner clean up
+    std::cout << "Camera disconnected: " << cam->name_ << std::endl;
+    cam->connected_ = false;
+    if (cam->disconnectCallback_) cam->disconnectCallback_();
+  }
   return EDS_ERR_OK;
 }
 
@@ -6,6 +6,7 @@
 #include <opencv2/opencv.hpp>
 #include <sstream>
 
+#include "image/JpegCodec.h"
 #include "server/LiveViewServer.h"
 
 namespace fs = std::filesystem;
@@ -15,6 +16,15 @@ namespace photobooth {
 // Static instance for callbacks
 CanonSDKCamera *CanonSDKCamera::currentInstance_ = nullptr;
 
+// Properties whose values and descriptors are served from propertyCache_
+static const std::vector<EdsPropertyID> CACHED_PROPERTIES = {
+    kEdsPropID_ISOSpeed,     kEdsPropID_Av,
+    kEdsPropID_Tv,           kEdsPropID_WhiteBalance,
+    kEdsPropID_ExposureCompensation,
+    kEdsPropID_PictureStyle, kEdsPropID_AFMode,
+    kEdsPropID_ImageQuality, kEdsPropID_DriveMode,
+    kEdsPropID_AEModeSelect};
+
 CanonSDKCamera::CanonSDKCamera(EdsCameraRef camera, EdsUInt32 bodyID)
     : cameraRef_(camera) {
   // Create CameraModel from MultiCamCui with save to host
@@ -54,21 +64,19 @@ bool CanonSDKCamera::connect() {
     EdsSetCameraStateEventHandler(cameraRef_, kEdsStateEvent_All,
                                   handleStateEvent, this);
 
-    // Read current settings from camera
-    EdsUInt32 iso = 0, av = 0, tv = 0, wb = 0, iq = 0, ae = 0;
-    EdsGetPropertyData(cameraRef_, kEdsPropID_ISOSpeed, 0, sizeof(iso), &iso);
-    EdsGetPropertyData(cameraRef_, kEdsPropID_Av, 0, sizeof(av), &av);
-    EdsGetPropertyData(cameraRef_, kEdsPropID_Tv, 0, sizeof(tv), &tv);
-    EdsGetPropertyData(cameraRef_, kEdsPropID_WhiteBalance, 0, sizeof(wb), &wb);
-    EdsGetPropertyData(cameraRef_, kEdsPropID_ImageQuality, 0, sizeof(iq), &iq);
-    EdsGetPropertyData(cameraRef_, kEdsPropID_AEModeSelect, 0, sizeof(ae), &ae);
-
-    extendedSettings_.isoCode = iso;
-    extendedSettings_.apertureCode = av;
-    extendedSettings_.shutterSpeedCode = tv;
-    extendedSettings_.whiteBalanceCode = wb;
-    extendedSettings_.imageQualityCode = iq;
-    extendedSettings_.aeModeCode = ae;
+    // Read current settings and descriptors from camera once; property
+    // events keep the cache current from here on
+    propertyCache_.setCamera(cameraRef_);
+    propertyCache_.prime(CACHED_PROPERTIES);
+
+    extendedSettings_.isoCode = getPropertyCode(kEdsPropID_ISOSpeed);
+    extendedSettings_.apertureCode = getPropertyCode(kEdsPropID_Av);
+    extendedSettings_.shutterSpeedCode = getPropertyCode(kEdsPropID_Tv);
+    extendedSettings_.whiteBalanceCode =
+        getPropertyCode(kEdsPropID_WhiteBalance);
+    extendedSettings_.imageQualityCode =
+        getPropertyCode(kEdsPropID_ImageQuality);
+    extendedSettings_.aeModeCode = getPropertyCode(kEdsPropID_AEModeSelect);
 
     return true;
   }
@@ -87,6 +95,7 @@ void CanonSDKCamera::disconnect() {
     cameraModel_->CloseSessionCommand();
   }
   connected_ = false;
+  propertyCache_.clear();
 }
 
 bool CanonSDKCamera::isConnected() const { return connected_; }
@@ -213,7 +222,7 @@ void CanonSDKCamera::liveViewLoop() {
           if (!rawData.empty()) {
             try {
               // Decode (EDSDK sends JPEG usually)
-              cv::Mat frame = cv::imdecode(rawData, cv::IMREAD_COLOR);
+              cv::Mat frame = JpegCodec::getInstance().decode(rawData);
 
               if (!frame.empty()) {
                 cv::Mat resized;
@@ -221,10 +230,10 @@ void CanonSDKCamera::liveViewLoop() {
                 // Note: This might change aspect ratio if input isn't 16:9
                 cv::resize(frame, resized, cv::Size(1280, 720));
 
-                // Encode to JPEG with quality 70
+                // Encode with the live view profile (q70, 4:2:0, fast DCT)
                 std::vector<uint8_t> encoded;
-                std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 70};
-                cv::imencode(".jpg", resized, encoded, params);
+                JpegCodec::getInstance().encode(resized, JpegUse::LiveView,
+                                                encoded);
 
                 // 4. Send to LiveViewServer
                 LiveViewServer::getInstance().updateFrame(std::move(encoded));
@@ -390,18 +399,13 @@ CameraSettings CanonSDKCamera::syncToBasicSettings() const {
 
 std::vector<int> CanonSDKCamera::getSupportedISO() const {
   std::vector<int> result;
-  EdsPropertyDesc desc = {0};
-
-  if (EdsGetPropertyDesc(cameraRef_, kEdsPropID_ISOSpeed, &desc) ==
-      EDS_ERR_OK) {
-    for (int i = 0; i < desc.numElements; i++) {
-      auto it = iso_table.find(desc.propDesc[i]);
-      if (it != iso_table.end()) {
-        try {
-          int value = std::stoi(it->second);
-          result.push_back(value);
-        } catch (...) {
-        }
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_ISOSpeed)) {
+    auto it = iso_table.find(code);
+    if (it != iso_table.end()) {
+      try {
+        int value = std::stoi(it->second);
+        result.push_back(value);
+      } catch (...) {
       }
     }
   }
@@ -410,14 +414,10 @@ std::vector<int> CanonSDKCamera::getSupportedISO() const {
 
 std::vector<std::string> CanonSDKCamera::getSupportedApertures() const {
   std::vector<std::string> result;
-  EdsPropertyDesc desc = {0};
-
-  if (EdsGetPropertyDesc(cameraRef_, kEdsPropID_Av, &desc) == EDS_ERR_OK) {
-    for (int i = 0; i < desc.numElements; i++) {
-      auto it = av_table.find(desc.propDesc[i]);
-      if (it != av_table.end() && strlen(it->second) > 0) {
-        result.push_back("f/" + std::string(it->second));
-      }
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_Av)) {
+    auto it = av_table.find(code);
+    if (it != av_table.end() && strlen(it->second) > 0) {
+      result.push_back("f/" + std::string(it->second));
     }
   }
   return result;
@@ -425,14 +425,10 @@ std::vector<std::string> CanonSDKCamera::getSupportedApertures() const {
 
 std::vector<std::string> CanonSDKCamera::getSupportedShutterSpeeds() const {
   std::vector<std::string> result;
-  EdsPropertyDesc desc = {0};
-
-  if (EdsGetPropertyDesc(cameraRef_, kEdsPropID_Tv, &desc) == EDS_ERR_OK) {
-    for (int i = 0; i < desc.numElements; i++) {
-      auto it = tv_table.find(desc.propDesc[i]);
-      if (it != tv_table.end()) {
-        result.push_back(it->second);
-      }
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_Tv)) {
+    auto it = tv_table.find(code);
+    if (it != tv_table.end()) {
+      result.push_back(it->second);
     }
   }
   return result;
@@ -440,15 +436,10 @@ std::vector<std::string> CanonSDKCamera::getSupportedShutterSpeeds() const {
 
 std::vector<std::string> CanonSDKCamera::getSupportedWhiteBalances() const {
   std::vector<std::string> result;
-  EdsPropertyDesc desc = {0};
-
-  if (EdsGetPropertyDesc(cameraRef_, kEdsPropID_WhiteBalance, &desc) ==
-      EDS_ERR_OK) {
-    for (int i = 0; i < desc.numElements; i++) {
-      auto it = whitebalance_table.find(desc.propDesc[i]);
-      if (it != whitebalance_table.end()) {
-        result.push_back(it->second);
-      }
+  for (EdsInt32 code : propertyCache_.getDesc(kEdsPropID_WhiteBalance)) {
+    auto it = whitebalance_table.find(code);
+    if (it != whitebalance_table.end()) {
+      result.push_back(it->second);
     }
   }
   return result;
@@ -467,6 +458,8 @@ bool CanonSDKCamera::setPropertyByCode(EdsPropertyID propertyID,
   cameraModel_->UIUnLock();
 
   if (err == EDS_ERR_OK) {
+    propertyCache_.storeValue(propertyID, code);
+
     // Update local settings cache
     switch (propertyID) {
     case kEdsPropID_ISOSpeed:
@@ -507,7 +500,7 @@ bool CanonSDKCamera::setPropertyByCode(EdsPropertyID propertyID,
 
 EdsUInt32 CanonSDKCamera::getPropertyCode(EdsPropertyID propertyID) const {
   EdsUInt32 value = 0;
-  EdsGetPropertyData(cameraRef_, propertyID, 0, sizeof(value), &value);
+  propertyCache_.getValue(propertyID, value);
   return value;
 }
 
@@ -538,18 +531,14 @@ std::vector<SDKOption> CanonSDKCamera::getPropertyDescWithLabels(
     EdsPropertyID propertyID, const std::map<EdsUInt32, const char *> &table) {
 
   std::vector<SDKOption> result;
-  EdsPropertyDesc desc = {0};
-
-  if (EdsGetPropertyDesc(cameraRef_, propertyID, &desc) == EDS_ERR_OK) {
-    for (int i = 0; i < desc.numElements; i++) {
-      EdsUInt32 code = desc.propDesc[i];
-      auto it = table.find(code);
-      if (it != table.end()) {
-        SDKOption option;
-        option.code = code;
-        option.label = it->second;
-        result.push_back(option);
-      }
+
+  for (EdsUInt32 code : propertyCache_.getDesc(propertyID)) {
+    auto it = table.find(code);
+    if (it != table.end()) {
+      SDKOption option;
+      option.code = code;
+      option.label = it->second;
+      result.push_back(option);
     }
   }
   return result;
@@ -682,9 +671,12 @@ EdsError EDSCALLBACK CanonSDKCamera::handlePropertyEvent(EdsPropertyEvent event,
     return EDS_ERR_OK;
 
   // Update local cache when camera property changes
-  if (event == kEdsPropertyEvent_PropertyChanged) {
-    EdsUInt32 value = 0;
-    EdsGetPropertyData(camera->cameraRef_, property, 0, sizeof(value), &value);
+  if (event == kEdsPropertyEvent_PropertyDescChanged) {
+    camera->propertyCache_.refreshDesc(property);
+  } else if (event == kEdsPropertyEvent_PropertyChanged) {
+    if (!camera->propertyCache_.refreshValue(property))
+      return EDS_ERR_OK;
+    EdsUInt32 value = camera->getPropertyCode(property);
 
     switch (property) {
     case kEdsPropID_ISOSpeed:
@@ -1,17 +1,47 @@
 #include "camera/ProcessManager.h"
 #include <chrono>
-#include <fstream>
 #include <iostream>
-#include <sstream>
-#include <thread>
+#include <random>
 
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 namespace photobooth {
 
+using ipc::Frame;
+using ipc::MessageType;
+using ipc::Opcode;
+using ipc::PayloadReader;
+using ipc::PayloadWriter;
+
+namespace {
+constexpr int CHILD_EXIT_TIMEOUT_MS = 2000;
+
+// EDSDK values forwarded to the child. Kept local so this file builds
+// without the SDK headers, which only compile on Windows and macOS.
+constexpr uint32_t SHUTTER_BUTTON_OFF = 0x00000000;        // kEdsCameraCommand_ShutterButton_OFF
+constexpr uint32_t SHUTTER_BUTTON_HALFWAY = 0x00000001;    // kEdsCameraCommand_ShutterButton_Halfway
+constexpr uint32_t SHUTTER_BUTTON_COMPLETELY = 0x00000003; // kEdsCameraCommand_ShutterButton_Completely
+constexpr uint32_t PROP_SAVE_TO = 0x0000000b;              // kEdsPropID_SaveTo
+constexpr uint32_t PROP_IMAGE_QUALITY = 0x00000100;        // kEdsPropID_ImageQuality
+constexpr uint32_t PROP_ISO_SPEED = 0x00000402;            // kEdsPropID_ISOSpeed
+constexpr uint32_t PROP_AV = 0x00000405;                   // kEdsPropID_Av
+constexpr uint32_t PROP_TV = 0x00000406;                   // kEdsPropID_Tv
+
+// Pipe creation and process spawn must not interleave between managers,
+// otherwise one child inherits another child's pipe ends and EOF never
+// arrives when the owner dies.
+std::mutex spawnMutex;
+} // namespace
+
 ProcessManager::ProcessManager(const std::string &executablePath)
     : executablePath_(executablePath) {
 #ifdef _WIN32
@@ -32,17 +62,31 @@ bool ProcessManager::initialize() {
   std::cout << "Initializing ProcessManager with: " << executablePath_
             << std::endl;
 
+  // Live view still works without the ring, frames are just unavailable
+  std::string ringName =
+      "photobooth_evf_" + std::to_string(std::random_device{}());
+  if (!frameRing_.create(ringName)) {
+    std::cerr << "Live view frame ring unavailable" << std::endl;
+  }
+  lastFrameSequence_ = 0;
+
   if (!createProcess()) {
     std::cerr << "Failed to create process" << std::endl;
+    cleanupProcess();
+    frameRing_.close();
     return false;
   }
 
   processRunning_ = true;
-
-  // Wait for initial prompt (camera selection menu)
-  if (!waitForPrompt("Select camera", 10000)) {
-    std::cerr << "Did not receive camera selection prompt" << std::endl;
-    shutdown();
+  readerThread_ = std::thread(&ProcessManager::readerLoop, this);
+
+  // First answer arrives once the child has initialized EDSDK
+  Frame response;
+  if (!sendRequest(Opcode::Ping, {}, response, STARTUP_TIMEOUT_MS)) {
+    std::cerr << "MultiCamCui did not answer ping" << std::endl;
+    processRunning_ = false;
+    cleanupProcess();
+    frameRing_.close();
     return false;
   }
 
@@ -53,22 +97,45 @@ bool ProcessManager::initialize() {
 void ProcessManager::shutdown() {
   std::lock_guard<std::mutex> lock(processMutex_);
 
-  if (!processRunning_) {
-    return;
+  if (processRunning_) {
+    std::cout << "Shutting down ProcessManager" << std::endl;
+
+    // Child closes its sessions and exits after answering
+    Frame response;
+    sendRequest(Opcode::Shutdown, {}, response, CHILD_EXIT_TIMEOUT_MS);
   }
 
-  std::cout << "Shutting down ProcessManager" << std::endl;
+  // Also reaps a child whose pipe already broke
+  processRunning_ = false;
+  cleanupProcess();
+  frameRing_.close();
+}
 
-  // Send 'x' to quit
-  writeToStdin("x\n");
-  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+bool ProcessManager::ping(int timeoutMs) {
+  Frame response;
+  return sendRequest(Opcode::Ping, {}, response, timeoutMs);
+}
 
-  cleanupProcess();
-  processRunning_ = false;
+void ProcessManager::stopReader() {
+  if (!readerThread_.joinable()) {
+    return;
+  }
+
+  // An event callback may tear us down from the reader thread itself
+  if (readerThread_.get_id() == std::this_thread::get_id()) {
+    readerThread_.detach();
+  } else {
+    readerThread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(responseMutex_);
+  responses_.clear();
 }
 
 #ifdef _WIN32
 bool ProcessManager::createProcess() {
+  std::lock_guard<std::mutex> spawnLock(spawnMutex);
+
   SECURITY_ATTRIBUTES saAttr;
   saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
   saAttr.bInheritHandle = TRUE;
@@ -94,17 +161,26 @@ bool ProcessManager::createProcess() {
     return false;
   }
 
-  // Setup STARTUPINFO
+  // Setup STARTUPINFO. stdout carries frames only, the child's logging goes
+  // to our stderr.
   STARTUPINFOA siStartInfo;
   ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
   siStartInfo.cb = sizeof(STARTUPINFO);
-  siStartInfo.hStdError = hChildStdOutWr_;
+  siStartInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
   siStartInfo.hStdOutput = hChildStdOutWr_;
   siStartInfo.hStdInput = hChildStdInRd_;
   siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
 
+  std::string commandLine = "\"" + executablePath_ + "\" --machine";
+  if (frameRing_.isOpen()) {
+    commandLine += " --ring " + frameRing_.name();
+  }
+  std::vector<char> commandLineBuffer(commandLine.begin(), commandLine.end());
+  commandLineBuffer.push_back('\0');
+
   // Create the child process
-  BOOL success = CreateProcessA(executablePath_.c_str(), NULL, NULL, NULL,
+  BOOL success = CreateProcessA(executablePath_.c_str(),
+                                commandLineBuffer.data(), NULL, NULL,
                                 TRUE,             // Inherit handles
                                 CREATE_NO_WINDOW, // Don't show console window
                                 NULL, NULL, &siStartInfo, &processInfo_);
@@ -127,172 +203,376 @@ bool ProcessManager::createProcess() {
 }
 
 void ProcessManager::cleanupProcess() {
+  // Closing stdin makes a machine-mode child exit on its own
+  if (hChildStdInWr_)
+    CloseHandle(hChildStdInWr_);
+  hChildStdInWr_ = NULL;
+
   if (processInfo_.hProcess != NULL) {
-    TerminateProcess(processInfo_.hProcess, 0);
-    WaitForSingleObject(processInfo_.hProcess, 2000);
+    if (WaitForSingleObject(processInfo_.hProcess, CHILD_EXIT_TIMEOUT_MS) ==
+        WAIT_TIMEOUT) {
+      TerminateProcess(processInfo_.hProcess, 0);
+      WaitForSingleObject(processInfo_.hProcess, CHILD_EXIT_TIMEOUT_MS);
+    }
     CloseHandle(processInfo_.hProcess);
     CloseHandle(processInfo_.hThread);
     ZeroMemory(&processInfo_, sizeof(PROCESS_INFORMATION));
   }
 
-  if (hChildStdInWr_)
-    CloseHandle(hChildStdInWr_);
+  // The child is gone, so the reader sees a broken pipe and exits
+  stopReader();
+
+  if (hChildStdInRd_)
+    CloseHandle(hChildStdInRd_);
+  if (hChildStdOutWr_)
+    CloseHandle(hChildStdOutWr_);
   if (hChildStdOutRd_)
     CloseHandle(hChildStdOutRd_);
 
-  hChildStdInWr_ = NULL;
+  hChildStdInRd_ = NULL;
+  hChildStdOutWr_ = NULL;
   hChildStdOutRd_ = NULL;
 }
 
-bool ProcessManager::writeToStdin(const std::string &data) {
+bool ProcessManager::writeToStdin(const std::vector<uint8_t> &data) {
   if (!hChildStdInWr_) {
     return false;
   }
 
   DWORD written;
-  BOOL success = WriteFile(hChildStdInWr_, data.c_str(),
-                           static_cast<DWORD>(data.length()), &written, NULL);
+  BOOL success = WriteFile(hChildStdInWr_, data.data(),
+                           static_cast<DWORD>(data.size()), &written, NULL);
 
-  if (!success || written != data.length()) {
+  if (!success || written != data.size()) {
     std::cerr << "WriteFile to stdin failed" << std::endl;
     return false;
   }
+  return true;
+}
+
+bool ProcessManager::readExact(void *dst, size_t size) {
+  uint8_t *out = static_cast<uint8_t *>(dst);
+
+  while (size > 0) {
+    DWORD bytesRead = 0;
+    if (!ReadFile(hChildStdOutRd_, out, static_cast<DWORD>(size), &bytesRead,
+                  NULL) ||
+        bytesRead == 0) {
+      return false;
+    }
+    out += bytesRead;
+    size -= bytesRead;
+  }
 
-  // Flush to ensure data is sent
-  FlushFileBuffers(hChildStdInWr_);
   return true;
 }
+#else
+bool ProcessManager::createProcess() {
+  std::lock_guard<std::mutex> spawnLock(spawnMutex);
 
-std::string ProcessManager::readFromStdout(size_t maxBytes, int timeoutMs) {
-  if (!hChildStdOutRd_) {
-    return "";
+  int stdinPipe[2] = {-1, -1};
+  int stdoutPipe[2] = {-1, -1};
+
+  if (pipe(stdinPipe) != 0) {
+    std::cerr << "pipe (stdin) failed: " << errno << std::endl;
+    return false;
+  }
+  if (pipe(stdoutPipe) != 0) {
+    std::cerr << "pipe (stdout) failed: " << errno << std::endl;
+    close(stdinPipe[0]);
+    close(stdinPipe[1]);
+    return false;
   }
 
-  std::string result;
-  char buffer[1024];
-  DWORD bytesRead;
-  DWORD totalBytesAvail;
+  // dup2 clears the flag on the child's stdin/stdout, everything else closes
+  // on exec
+  for (int fd : {stdinPipe[0], stdinPipe[1], stdoutPipe[0], stdoutPipe[1]}) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
 
-  auto startTime = std::chrono::steady_clock::now();
+  // A dead child must surface as a write error, not kill the server
+  signal(SIGPIPE, SIG_IGN);
 
-  while (true) {
-    // Check timeout
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                       std::chrono::steady_clock::now() - startTime)
-                       .count();
+  // Build argv before fork, the child may only call async-signal-safe code
+  std::vector<std::string> args = {executablePath_, "--machine"};
+  if (frameRing_.isOpen()) {
+    args.push_back("--ring");
+    args.push_back(frameRing_.name());
+  }
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
 
-    if (elapsed >= timeoutMs) {
-      break;
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "fork failed: " << errno << std::endl;
+    for (int fd : {stdinPipe[0], stdinPipe[1], stdoutPipe[0], stdoutPipe[1]}) {
+      close(fd);
     }
+    return false;
+  }
 
-    // Check if data is available
-    BOOL success =
-        PeekNamedPipe(hChildStdOutRd_, NULL, 0, NULL, &totalBytesAvail, NULL);
-    if (!success || totalBytesAvail == 0) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(50));
-      continue;
+  if (pid == 0) {
+    dup2(stdinPipe[0], STDIN_FILENO);
+    dup2(stdoutPipe[1], STDOUT_FILENO);
+    execv(executablePath_.c_str(), argv.data());
+    _exit(127);
+  }
+
+  // Close the ends the child owns
+  close(stdinPipe[0]);
+  close(stdoutPipe[1]);
+
+  childPid_ = pid;
+  childStdIn_ = stdinPipe[1];
+  childStdOut_ = stdoutPipe[0];
+
+  std::cout << "Process created successfully" << std::endl;
+  return true;
+}
+
+void ProcessManager::cleanupProcess() {
+  // Closing stdin makes a machine-mode child exit on its own
+  if (childStdIn_ >= 0)
+    close(childStdIn_);
+  childStdIn_ = -1;
+
+  if (childPid_ > 0) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(CHILD_EXIT_TIMEOUT_MS);
+    int status = 0;
+    while (waitpid(childPid_, &status, WNOHANG) == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        kill(childPid_, SIGKILL);
+        waitpid(childPid_, &status, 0);
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+    childPid_ = -1;
+  }
 
-    // Read available data
-    DWORD toRead = min(totalBytesAvail, sizeof(buffer) - 1);
-    success = ReadFile(hChildStdOutRd_, buffer, toRead, &bytesRead, NULL);
+  // The child is gone, so the reader sees EOF and exits
+  stopReader();
 
-    if (!success || bytesRead == 0) {
-      break;
+  if (childStdOut_ >= 0)
+    close(childStdOut_);
+  childStdOut_ = -1;
+}
+
+bool ProcessManager::writeToStdin(const std::vector<uint8_t> &data) {
+  if (childStdIn_ < 0) {
+    return false;
+  }
+
+  const uint8_t *in = data.data();
+  size_t size = data.size();
+  while (size > 0) {
+    ssize_t written = write(childStdIn_, in, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "write to stdin failed: " << errno << std::endl;
+      return false;
     }
+    in += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
 
-    buffer[bytesRead] = '\0';
-    result.append(buffer, bytesRead);
+bool ProcessManager::readExact(void *dst, size_t size) {
+  uint8_t *out = static_cast<uint8_t *>(dst);
 
-    if (result.length() >= maxBytes) {
-      break;
+  while (size > 0) {
+    ssize_t bytesRead = read(childStdOut_, out, size);
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      return false;
     }
+    out += bytesRead;
+    size -= static_cast<size_t>(bytesRead);
   }
 
-  return result;
+  return true;
 }
 #endif
 
-bool ProcessManager::waitForPrompt(const std::string &prompt, int timeoutMs) {
-  auto startTime = std::chrono::steady_clock::now();
-  std::string accumulated;
+bool ProcessManager::readFrame(Frame &frame) {
+  if (!readExact(&frame.header, sizeof(frame.header))) {
+    return false;
+  }
+
+  if (!ipc::isValidHeader(frame.header)) {
+    std::cerr << "Invalid frame from MultiCamCui, stopping" << std::endl;
+    return false;
+  }
 
-  while (true) {
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                       std::chrono::steady_clock::now() - startTime)
-                       .count();
+  frame.payload.resize(frame.header.payloadLength);
+  return frame.payload.empty() ||
+         readExact(frame.payload.data(), frame.payload.size());
+}
 
-    if (elapsed >= timeoutMs) {
-      std::cerr << "Timeout waiting for prompt: " << prompt << std::endl;
-      return false;
+void ProcessManager::readerLoop() {
+  Frame frame;
+  while (readFrame(frame)) {
+    if (frame.type() == MessageType::Event) {
+      if (eventCallback_) {
+        eventCallback_(frame);
+      }
+      continue;
     }
 
-    std::string output = readFromStdout(4096, 500);
-    if (!output.empty()) {
-      accumulated += output;
-      std::cout << output; // Echo output for debugging
+    if (frame.type() != MessageType::Response) {
+      continue;
+    }
 
-      if (accumulated.find(prompt) != std::string::npos) {
-        return true;
-      }
+    // Late answers to requests that already timed out are dropped
+    std::lock_guard<std::mutex> lock(responseMutex_);
+    if (waiting_.count(frame.header.correlationId)) {
+      responses_[frame.header.correlationId] = std::move(frame);
+      responseCond_.notify_all();
     }
   }
 
-  return false;
+  std::cerr << "MultiCamCui output closed" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(responseMutex_);
+    processRunning_ = false;
+  }
+  responseCond_.notify_all();
 }
 
-std::string ProcessManager::sendCommand(const std::string &command) {
+bool ProcessManager::sendRequest(Opcode opcode,
+                                 const std::vector<uint8_t> &payload,
+                                 Frame &response, int timeoutMs) {
   if (!processRunning_) {
-    return "";
+    return false;
   }
 
-  std::cout << "[CMD] Sending: " << command << std::endl;
+  uint32_t correlationId = nextCorrelationId_++;
+  {
+    std::lock_guard<std::mutex> lock(responseMutex_);
+    waiting_.insert(correlationId);
+  }
 
-  if (!writeToStdin(command + "\n")) {
-    std::cerr << "Failed to write command" << std::endl;
-    return "";
+  bool written;
+  {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    written = writeToStdin(ipc::encodeFrame(MessageType::Request, opcode,
+                                            correlationId, ipc::STATUS_OK,
+                                            payload));
   }
 
-  // Wait a bit for response
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  std::unique_lock<std::mutex> lock(responseMutex_);
+  if (written) {
+    responseCond_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
+      return responses_.count(correlationId) || !processRunning_;
+    });
+  }
+  waiting_.erase(correlationId);
 
-  std::string response = readFromStdout(8192, 2000);
-  std::cout << "[RESP] " << response << std::endl;
+  auto it = responses_.find(correlationId);
+  if (it == responses_.end()) {
+    std::cerr << "No response from MultiCamCui for request "
+              << static_cast<int>(opcode) << std::endl;
+    return false;
+  }
 
-  return response;
+  response = std::move(it->second);
+  responses_.erase(it);
+  return true;
+}
+
+bool ProcessManager::sendBodyCommand(Opcode opcode, uint32_t argument,
+                                     bool hasArgument) {
+  PayloadWriter payload;
+  payload.u32(activeBodyID_);
+  if (hasArgument) {
+    payload.u32(argument);
+  }
+
+  Frame response;
+  if (!sendRequest(opcode, payload.data(), response)) {
+    return false;
+  }
+
+  if (!response.ok()) {
+    std::cerr << "MultiCamCui request " << static_cast<int>(opcode)
+              << " failed: 0x" << std::hex << response.header.status
+              << std::dec << std::endl;
+    return false;
+  }
+  return true;
 }
 
 // ==================== Camera Detection & Selection ====================
 
-std::vector<std::string> ProcessManager::detectCameras() {
-  std::vector<std::string> cameras;
+std::vector<ProcessManager::CameraEntry> ProcessManager::listCameras() {
+  std::vector<CameraEntry> cameras;
 
   if (!processRunning_) {
     std::cerr << "Process not running" << std::endl;
     return cameras;
   }
 
-  // The initial output should contain camera list
-  // Example: "Canon EOS 5D Mark IV"
-  // For now, return a placeholder
-  // In real implementation, parse the stdout buffer
+  Frame response;
+  if (!sendRequest(Opcode::ListCameras, {}, response) || !response.ok()) {
+    return cameras;
+  }
+
+  PayloadReader reader(response.payload);
+  uint32_t count = 0;
+  reader.u32(count);
+  for (uint32_t i = 0; i < count; i++) {
+    CameraEntry camera;
+    if (!reader.str(camera.name) || !reader.str(camera.port)) {
+      break;
+    }
+    cameras.push_back(camera);
+  }
 
-  cameras.push_back("Canon Camera 1");
   return cameras;
 }
 
+std::vector<std::string> ProcessManager::detectCameras() {
+  std::vector<std::string> names;
+  for (const auto &camera : listCameras()) {
+    names.push_back(camera.name);
+  }
+  return names;
+}
+
+bool ProcessManager::openSessions(uint32_t firstBodyID, uint32_t lastBodyID) {
+  for (uint32_t bodyID = firstBodyID; bodyID <= lastBodyID; bodyID++) {
+    PayloadWriter payload;
+    payload.u32(bodyID);
+
+    Frame response;
+    if (!sendRequest(Opcode::OpenSession, payload.data(), response) ||
+        !response.ok()) {
+      std::cerr << "Failed to open camera " << bodyID << std::endl;
+      return false;
+    }
+  }
+
+  activeBodyID_ = (firstBodyID == lastBodyID) ? firstBodyID : 0;
+  primaryBodyID_ = firstBodyID;
+  return true;
+}
+
 bool ProcessManager::selectCamera(int cameraIndex) {
-  if (!processRunning_) {
+  if (!processRunning_ || cameraIndex < 1) {
     return false;
   }
 
   std::cout << "Selecting camera index: " << cameraIndex << std::endl;
 
-  std::string response = sendCommand(std::to_string(cameraIndex));
-
-  // Wait for control menu prompt
-  if (!waitForPrompt("Set Save To", 5000)) {
-    std::cerr << "Failed to get control menu" << std::endl;
+  if (!openSessions(cameraIndex, cameraIndex)) {
     return false;
   }
 
@@ -300,50 +580,89 @@ bool ProcessManager::selectCamera(int cameraIndex) {
   return true;
 }
 
+bool ProcessManager::selectCameraByPort(const std::string &port) {
+  if (!processRunning_ || port.empty()) {
+    return false;
+  }
+
+  // The child resolves the port to its own body ID, which need not match
+  // the index this body had in another process
+  PayloadWriter payload;
+  payload.str(port);
+
+  Frame response;
+  uint32_t bodyID = 0;
+  if (!sendRequest(Opcode::OpenSessionByPort, payload.data(), response) ||
+      !response.ok() || !PayloadReader(response.payload).u32(bodyID)) {
+    std::cerr << "Failed to open camera on port " << port << std::endl;
+    return false;
+  }
+
+  activeBodyID_ = bodyID;
+  primaryBodyID_ = bodyID;
+  return true;
+}
+
 bool ProcessManager::selectAllCameras() {
-  return selectCamera('a'); // Send 'a' for all cameras
+  PayloadWriter payload;
+  payload.u32(0); // All detected cameras
+
+  Frame response;
+  if (!sendRequest(Opcode::OpenSession, payload.data(), response) ||
+      !response.ok()) {
+    return false;
+  }
+
+  activeBodyID_ = 0;
+  primaryBodyID_ = 1;
+  return true;
 }
 
 bool ProcessManager::selectCameraRange(int startIndex, int endIndex) {
-  std::string rangeCmd =
-      std::to_string(startIndex) + "-" + std::to_string(endIndex);
-  std::string response = sendCommand(rangeCmd);
-  return waitForPrompt("Set Save To", 5000);
+  if (startIndex < 1 || endIndex < startIndex) {
+    return false;
+  }
+  return openSessions(startIndex, endIndex);
 }
 
 // ==================== Live View Commands ====================
 
 bool ProcessManager::startLiveView() {
-  std::string response = sendCommand("21");
-  // Check response for success
-  return response.find("error") == std::string::npos;
+  lastFrameSequence_ = 0;
+  return sendBodyCommand(Opcode::StartLiveView);
 }
 
 bool ProcessManager::stopLiveView() {
-  std::string response = sendCommand("22");
-  return response.find("error") == std::string::npos;
+  return sendBodyCommand(Opcode::StopLiveView);
 }
 
 std::vector<uint8_t> ProcessManager::getLiveViewFrame() {
   std::vector<uint8_t> frame;
 
-  // Send command 20 to get one live view image
-  std::string response = sendCommand("20");
+  if (!frameRing_.isOpen()) {
+    return frame;
+  }
 
-  // TODO: Parse binary JPEG data from response
-  // For now, try to read image file saved by MultiCamCui
-  // MultiCamCui saves to cam{N}/LiveView.jpg
+  // The child downloads one EVF image straight into the ring
+  PayloadWriter payload;
+  payload.u32(primaryBodyID_);
 
-  std::string imagePath = "cam1/LiveView.jpg";
-  std::ifstream file(imagePath, std::ios::binary);
-  if (file.is_open()) {
-    file.seekg(0, std::ios::end);
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
+  Frame response;
+  if (!sendRequest(Opcode::GrabLiveViewFrame, payload.data(), response) ||
+      !response.ok()) {
+    return frame;
+  }
+
+  uint32_t bodyID = 0;
+  uint64_t sequence = 0;
+  if (!frameRing_.readLatest(frame, bodyID, sequence, lastFrameSequence_)) {
+    frame.clear();
+    return frame;
+  }
+  lastFrameSequence_ = sequence;
 
-    frame.resize(fileSize);
-    file.read(reinterpret_cast<char *>(frame.data()), fileSize);
-    file.close();
+  if (frameCallback_) {
+    frameCallback_(frame);
   }
 
   return frame;
@@ -353,69 +672,69 @@ std::vector<uint8_t> ProcessManager::getLiveViewFrame() {
 
 bool ProcessManager::takePicture() {
   std::cout << "Taking picture..." << std::endl;
-  std::string response = sendCommand("3");
-
-  // MultiCamCui will save to cam{N}/IMG_XXXX.jpg
-  // Wait for operation to complete
-  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-
-  return response.find("error") == std::string::npos;
+  return sendBodyCommand(Opcode::TakePicture);
 }
 
 bool ProcessManager::pressHalfway() {
-  std::string response = sendCommand("4");
-  return response.find("error") == std::string::npos;
+  return sendBodyCommand(Opcode::PressShutter,
+                         SHUTTER_BUTTON_HALFWAY, true);
 }
 
 bool ProcessManager::pressCompletely() {
-  std::string response = sendCommand("5");
-  return response.find("error") == std::string::npos;
+  return sendBodyCommand(Opcode::PressShutter,
+                         SHUTTER_BUTTON_COMPLETELY, true);
 }
 
 bool ProcessManager::pressOff() {
-  std::string response = sendCommand("6");
-  return response.find("error") == std::string::npos;
+  return sendBodyCommand(Opcode::PressShutter,
+                         SHUTTER_BUTTON_OFF, true);
 }
 
 // ==================== Settings Commands ====================
 
+bool ProcessManager::setProperty(uint32_t propertyID, uint32_t value) {
+  PayloadWriter payload;
+  payload.u32(activeBodyID_).u32(propertyID).u32(value);
+
+  Frame response;
+  if (!sendRequest(Opcode::SetProperty, payload.data(), response)) {
+    return false;
+  }
+  return response.ok();
+}
+
+bool ProcessManager::getProperty(uint32_t propertyID, uint32_t &value) {
+  PayloadWriter payload;
+  payload.u32(activeBodyID_ ? activeBodyID_ : primaryBodyID_).u32(propertyID);
+
+  Frame response;
+  if (!sendRequest(Opcode::GetProperty, payload.data(), response) ||
+      !response.ok()) {
+    return false;
+  }
+
+  PayloadReader reader(response.payload);
+  return reader.u32(value);
+}
+
 bool ProcessManager::setSaveTo(int option) {
-  sendCommand("1"); // Enter Set Save To menu
-  std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  std::string response = sendCommand(std::to_string(option));
-  return response.find("error") == std::string::npos;
+  return setProperty(PROP_SAVE_TO, static_cast<uint32_t>(option));
 }
 
 bool ProcessManager::setImageQuality(int quality) {
-  sendCommand("2"); // Enter Image Quality menu
-  std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  std::string response = sendCommand(std::to_string(quality));
-  return response.find("error") == std::string::npos;
+  return setProperty(PROP_IMAGE_QUALITY, static_cast<uint32_t>(quality));
 }
 
 bool ProcessManager::setTV(int value) {
-  sendCommand("7");
-  std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  std::string response = sendCommand(std::to_string(value));
-  return response.find("error") == std::string::npos;
+  return setProperty(PROP_TV, static_cast<uint32_t>(value));
 }
 
 bool ProcessManager::setAV(int value) {
-  sendCommand("8");
-  std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  std::string response = sendCommand(std::to_string(value));
-  return response.find("error") == std::string::npos;
+  return setProperty(PROP_AV, static_cast<uint32_t>(value));
 }
 
 bool ProcessManager::setISO(int value) {
-  sendCommand("9");
-  std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  std::string response = sendCommand(std::to_string(value));
-  return response.find("error") == std::string::npos;
-}
-
-std::string ProcessManager::executeCommand(const std::string &command) {
-  return sendCommand(command);
+  return setProperty(PROP_ISO_SPEED, static_cast<uint32_t>(value));
 }
 
 } // namespace photobooth
@@ -0,0 +1,138 @@
+#include "camera/PropertyCache.h"
+
+namespace photobooth {
+
+void PropertyCache::setCamera(EdsCameraRef camera) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  camera_ = camera;
+  values_.clear();
+  descs_.clear();
+}
+
+void PropertyCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  values_.clear();
+  descs_.clear();
+}
+
+void PropertyCache::prime(const std::vector<EdsPropertyID> &propertyIDs) {
+  for (EdsPropertyID id : propertyIDs) {
+    refreshValue(id);
+    refreshDesc(id);
+  }
+}
+
+EdsCameraRef PropertyCache::camera() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return camera_;
+}
+
+bool PropertyCache::fetchValue(EdsCameraRef camera, EdsPropertyID propertyID,
+                               EdsUInt32 &value) {
+  if (!camera)
+    return false;
+  return EdsGetPropertyData(camera, propertyID, 0, sizeof(value), &value) ==
+         EDS_ERR_OK;
+}
+
+bool PropertyCache::fetchDesc(EdsCameraRef camera, EdsPropertyID propertyID,
+                              std::vector<EdsInt32> &desc) {
+  if (!camera)
+    return false;
+
+  EdsPropertyDesc raw = {0};
+  if (EdsGetPropertyDesc(camera, propertyID, &raw) != EDS_ERR_OK)
+    return false;
+
+  desc.assign(raw.propDesc, raw.propDesc + raw.numElements);
+  return true;
+}
+
+bool PropertyCache::refreshValue(EdsPropertyID propertyID) {
+  EdsCameraRef camera = this->camera();
+  EdsUInt32 value = 0;
+  if (!fetchValue(camera, propertyID, value))
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (camera_ != camera)
+    return false; // Camera switched while fetching
+  auto it = values_.find(propertyID);
+  if (it != values_.end() && it->second == value)
+    return false;
+  values_[propertyID] = value;
+  return true;
+}
+
+bool PropertyCache::refreshDesc(EdsPropertyID propertyID) {
+  EdsCameraRef camera = this->camera();
+  std::vector<EdsInt32> desc;
+  if (!fetchDesc(camera, propertyID, desc))
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (camera_ != camera)
+    return false; // Camera switched while fetching
+  auto it = descs_.find(propertyID);
+  if (it != descs_.end() && it->second == desc)
+    return false;
+  descs_[propertyID] = std::move(desc);
+  return true;
+}
+
+bool PropertyCache::storeValue(EdsPropertyID propertyID, EdsUInt32 value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = values_.find(propertyID);
+  if (it != values_.end() && it->second == value)
+    return false;
+  values_[propertyID] = value;
+  return true;
+}
+
+bool PropertyCache::getValue(EdsPropertyID propertyID,
+                             EdsUInt32 &value) const {
+  EdsCameraRef camera = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(propertyID);
+    if (it != values_.end()) {
+      value = it->second;
+      return true;
+    }
+    camera = camera_;
+  }
+
+  // Fetch without the lock so the property event handler is never stuck
+  // behind a camera round-trip
+  if (!fetchValue(camera, propertyID, value))
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (camera_ == camera) {
+    // An event may have stored a newer value meanwhile; keep that one
+    value = values_.emplace(propertyID, value).first->second;
+  }
+  return true;
+}
+
+std::vector<EdsInt32> PropertyCache::getDesc(EdsPropertyID propertyID) const {
+  EdsCameraRef camera = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = descs_.find(propertyID);
+    if (it != descs_.end())
+      return it->second;
+    camera = camera_;
+  }
+
+  std::vector<EdsInt32> desc;
+  if (!fetchDesc(camera, propertyID, desc))
+    return desc;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (camera_ == camera)
+    return descs_.emplace(propertyID, std::move(desc)).first->second;
+  return desc;
+}
+
+} // namespace photobooth
@@ -2,10 +2,24 @@
 #include <chrono>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
 
+#ifdef USE_OPENCV
+#include "image/JpegCodec.h"
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 namespace photobooth {
 
+static constexpr int MAX_WEBCAM_INDEX = 10;
+
 WebcamCamera::WebcamCamera(int deviceIndex, const std::string &name)
     : deviceIndex_(deviceIndex), name_(name), connected_(false),
       liveViewActive_(false) {
@@ -100,6 +114,9 @@ void WebcamCamera::stopLiveView() {
 bool WebcamCamera::isLiveViewActive() const { return liveViewActive_; }
 
 void WebcamCamera::liveViewLoop() {
+  // Reused for every frame; the callback only borrows it
+  std::vector<uint8_t> jpegData;
+
   while (liveViewActive_) {
     auto frameStart = std::chrono::steady_clock::now();
 
@@ -143,9 +160,7 @@ void WebcamCamera::liveViewLoop() {
     }
 
     // Encode to JPEG
-    std::vector<uint8_t> jpegData;
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 80};
-    cv::imencode(".jpg", frame, jpegData, params);
+    JpegCodec::getInstance().encode(frame, JpegUse::LiveView, jpegData);
 
     if (liveViewCallback_ && !jpegData.empty()) {
       liveViewCallback_(jpegData, frame.cols, frame.rows);
@@ -245,13 +260,16 @@ void WebcamCamera::capture(CaptureMode mode, CaptureCallback callback) {
     std::string filename =
         "data/captures/webcam_" + std::to_string(timestamp) + ".jpg";
 
-    // Save to disk
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-    if (cv::imwrite(filename, frame, params)) {
-      // Also encode to memory for immediate use
-      std::vector<uint8_t> jpegData;
-      cv::imencode(".jpg", frame, jpegData, params);
-
+    // Encode once, keep the bytes for immediate use and save them to disk
+    std::vector<uint8_t> jpegData;
+    bool saved = JpegCodec::getInstance().encode(frame, JpegUse::Print, jpegData);
+    if (saved) {
+      std::ofstream file(filename, std::ios::binary);
+      saved = file.write(reinterpret_cast<const char *>(jpegData.data()),
+                         static_cast<std::streamsize>(jpegData.size()))
+                  .good();
+    }
+    if (saved) {
       if (callback) {
         callback({true, filename, jpegData, frame.cols, frame.rows, ""});
       }
@@ -333,15 +351,44 @@ std::vector<std::pair<int, std::string>> WebcamCamera::listAvailableWebcams() {
   std::vector<std::pair<int, std::string>> webcams;
 
 #ifdef USE_OPENCV
-  // Try to open cameras at indices 0-9
-  for (int i = 0; i < 10; i++) {
-    cv::VideoCapture cap(i, cv::CAP_DSHOW);
-    if (cap.isOpened()) {
-      std::string name = "Webcam " + std::to_string(i);
-      webcams.push_back({i, name});
-      cap.release();
+#ifdef __linux__
+  // V4L2 answers VIDIOC_QUERYCAP without starting the sensor, so there is no
+  // need to open a VideoCapture per index (and we get the real device name)
+  for (int i = 0; i < MAX_WEBCAM_INDEX; i++) {
+    std::string path = "/dev/video" + std::to_string(i);
+    int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0)
+      continue;
+
+    v4l2_capability cap;
+    std::memset(&cap, 0, sizeof(cap));
+    if (::ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+      uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                          ? cap.device_caps
+                          : cap.capabilities;
+      // UVC cameras expose a second metadata-only node; skip it
+      if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+        webcams.push_back({i, reinterpret_cast<const char *>(cap.card)});
+      }
     }
+    ::close(fd);
   }
+#else
+  // Opening a DirectShow device can take hundreds of ms, so probe every index
+  // concurrently instead of one after another
+  std::vector<std::future<bool>> probes;
+  for (int i = 0; i < MAX_WEBCAM_INDEX; i++) {
+    probes.push_back(std::async(std::launch::async, [i]() {
+      cv::VideoCapture cap(i, cv::CAP_DSHOW);
+      return cap.isOpened();
+    }));
+  }
+  for (int i = 0; i < MAX_WEBCAM_INDEX; i++) {
+    if (probes[i].get()) {
+      webcams.push_back({i, "Webcam " + std::to_string(i)});
+    }
+  }
+#endif
 #else
   // Return a dummy webcam in simulation mode
   webcams.push_back({0, "Simulated Webcam"});
@@ -356,8 +403,7 @@ WebcamCamera::encodeFrameToJpeg(const std::vector<uint8_t> &rgbData, int width,
 #ifdef USE_OPENCV
   cv::Mat frame(height, width, CV_8UC3, const_cast<uint8_t *>(rgbData.data()));
   std::vector<uint8_t> jpegData;
-  std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 80};
-  cv::imencode(".jpg", frame, jpegData, params);
+  JpegCodec::getInstance().encode(frame, JpegUse::LiveView, jpegData);
   return jpegData;
 #else
   return rgbData;
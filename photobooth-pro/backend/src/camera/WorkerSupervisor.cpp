@@ -0,0 +1,369 @@
+#include "camera/WorkerSupervisor.h"
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <iostream>
+
+namespace photobooth {
+
+WorkerSupervisor::WorkerSupervisor(const std::string &executablePath)
+    : executablePath_(executablePath) {}
+
+WorkerSupervisor::~WorkerSupervisor() { stop(); }
+
+bool WorkerSupervisor::start() {
+  if (running_) {
+    return true;
+  }
+
+  // EDSDK's enumeration order is not stable across processes, so a
+  // short-lived probe collects each body's port name and workers select
+  // their body by port
+  std::vector<ProcessManager::CameraEntry> cameras;
+  {
+    ProcessManager probe(executablePath_);
+    if (!probe.initialize()) {
+      std::cerr << "WorkerSupervisor: camera helper failed to start"
+                << std::endl;
+      return false;
+    }
+    cameras = probe.listCameras();
+    probe.shutdown();
+  }
+
+  size_t count = cameras.size();
+  if (count == 0) {
+    std::cerr << "WorkerSupervisor: no camera bodies found" << std::endl;
+    return false;
+  }
+
+  // EDSDK start-up dominates, so bring the workers up side by side
+  std::vector<std::future<std::shared_ptr<ProcessManager>>> launches;
+  for (uint32_t bodyID = 1; bodyID <= count; bodyID++) {
+    launches.push_back(std::async(std::launch::async,
+                                  &WorkerSupervisor::launch, this, bodyID,
+                                  cameras[bodyID - 1].port));
+  }
+
+  std::map<uint32_t, Worker> workers;
+  for (uint32_t bodyID = 1; bodyID <= count; bodyID++) {
+    Worker worker;
+    worker.bodyID = bodyID;
+    worker.port = cameras[bodyID - 1].port;
+    worker.process = launches[bodyID - 1].get();
+    worker.healthy = worker.process != nullptr;
+    if (!worker.healthy) {
+      markFailed(worker);
+    }
+    workers[bodyID] = worker;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    workers_ = std::move(workers);
+  }
+
+  running_ = true;
+  monitorThread_ = std::thread(&WorkerSupervisor::monitorLoop, this);
+
+  std::cout << "WorkerSupervisor started " << count << " worker(s)"
+            << std::endl;
+  return true;
+}
+
+void WorkerSupervisor::stop() {
+  {
+    std::lock_guard<std::mutex> lock(monitorMutex_);
+    running_ = false;
+  }
+  monitorCond_.notify_all();
+
+  if (monitorThread_.joinable()) {
+    monitorThread_.join();
+  }
+
+  std::map<uint32_t, Worker> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    workers.swap(workers_);
+  }
+
+  // A wedged worker takes a few seconds to kill, don't serialize that
+  std::vector<std::future<void>> shutdowns;
+  for (auto &entry : workers) {
+    if (entry.second.process) {
+      auto process = entry.second.process;
+      shutdowns.push_back(
+          std::async(std::launch::async, [process] { process->shutdown(); }));
+    }
+  }
+  for (auto &shutdown : shutdowns) {
+    shutdown.get();
+  }
+}
+
+std::shared_ptr<ProcessManager>
+WorkerSupervisor::launch(uint32_t bodyID, const std::string &port) {
+  auto process = std::make_shared<ProcessManager>(executablePath_);
+  process->setEventCallback([this, bodyID](const ipc::Frame &event) {
+    dispatchEvent(bodyID, event);
+  });
+
+  if (!process->initialize() || !process->selectCameraByPort(port)) {
+    std::cerr << "WorkerSupervisor: failed to start worker for body "
+              << bodyID << " (" << port << ")" << std::endl;
+    process->shutdown();
+    return nullptr;
+  }
+  return process;
+}
+
+void WorkerSupervisor::markFailed(Worker &worker) {
+  int shift = (std::min)(worker.failures, 16);
+  int backoffMs = (std::min)(MAX_BACKOFF_MS, INITIAL_BACKOFF_MS << shift);
+
+  worker.healthy = false;
+  worker.failures++;
+  worker.nextRestart =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(backoffMs);
+}
+
+std::vector<uint32_t> WorkerSupervisor::getBodies() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<uint32_t> bodies;
+  for (const auto &entry : workers_) {
+    bodies.push_back(entry.first);
+  }
+  return bodies;
+}
+
+bool WorkerSupervisor::isHealthy(uint32_t bodyID) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = workers_.find(bodyID);
+  return it != workers_.end() && it->second.healthy;
+}
+
+std::shared_ptr<ProcessManager>
+WorkerSupervisor::getProcess(uint32_t bodyID) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = workers_.find(bodyID);
+  if (it == workers_.end() || !it->second.healthy) {
+    return nullptr;
+  }
+  return it->second.process;
+}
+
+// Calls run outside mutex_ on a copy of the process pointer, so a restart can
+// swap the worker while a request is in flight.
+template <typename Fn> bool WorkerSupervisor::forEachBody(uint32_t bodyID, Fn fn) {
+  std::vector<std::shared_ptr<ProcessManager>> targets;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : workers_) {
+      if ((bodyID == 0 || entry.first == bodyID) && entry.second.healthy &&
+          entry.second.process) {
+        targets.push_back(entry.second.process);
+      }
+    }
+  }
+
+  if (targets.empty()) {
+    return false;
+  }
+  if (targets.size() == 1) {
+    return fn(*targets.front());
+  }
+
+  std::vector<std::future<bool>> results;
+  for (auto &process : targets) {
+    results.push_back(std::async(std::launch::async,
+                                 [&fn, process] { return fn(*process); }));
+  }
+
+  bool success = true;
+  for (auto &result : results) {
+    success = result.get() && success;
+  }
+  return success;
+}
+
+bool WorkerSupervisor::takePicture(uint32_t bodyID) {
+  return forEachBody(bodyID,
+                     [](ProcessManager &process) { return process.takePicture(); });
+}
+
+bool WorkerSupervisor::startLiveView(uint32_t bodyID) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : workers_) {
+      if (bodyID == 0 || entry.first == bodyID) {
+        entry.second.liveView = true;
+      }
+    }
+  }
+  return forEachBody(bodyID, [](ProcessManager &process) {
+    return process.startLiveView();
+  });
+}
+
+bool WorkerSupervisor::stopLiveView(uint32_t bodyID) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : workers_) {
+      if (bodyID == 0 || entry.first == bodyID) {
+        entry.second.liveView = false;
+      }
+    }
+  }
+  return forEachBody(bodyID, [](ProcessManager &process) {
+    return process.stopLiveView();
+  });
+}
+
+bool WorkerSupervisor::setProperty(uint32_t bodyID, uint32_t propertyID,
+                                   uint32_t value) {
+  return forEachBody(bodyID, [propertyID, value](ProcessManager &process) {
+    return process.setProperty(propertyID, value);
+  });
+}
+
+std::vector<uint8_t> WorkerSupervisor::getLiveViewFrame(uint32_t bodyID) {
+  auto process = getProcess(bodyID);
+  if (!process) {
+    return {};
+  }
+  return process->getLiveViewFrame();
+}
+
+void WorkerSupervisor::setEventCallback(EventCallback callback) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  eventCallback_ = callback;
+}
+
+void WorkerSupervisor::dispatchEvent(uint32_t bodyID,
+                                     const ipc::Frame &event) {
+  // Every event payload starts with the child's own body ID; replace it with
+  // ours, which is the one callers route by
+  ipc::Frame routed = event;
+  if (routed.payload.size() >= sizeof(bodyID)) {
+    std::memcpy(routed.payload.data(), &bodyID, sizeof(bodyID));
+  }
+
+  // The child keeps answering pings after its body is unplugged; restart it
+  // so the session is reopened once the camera comes back
+  if (event.opcode() == ipc::Opcode::CameraRemoved) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = workers_.find(bodyID);
+    if (it != workers_.end() && it->second.healthy) {
+      std::cerr << "WorkerSupervisor: body " << bodyID << " removed"
+                << std::endl;
+      it->second.cameraLost = true;
+      markFailed(it->second);
+    }
+  }
+
+  EventCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    callback = eventCallback_;
+  }
+  if (callback) {
+    callback(routed);
+  }
+}
+
+void WorkerSupervisor::monitorLoop() {
+  while (running_) {
+    {
+      std::unique_lock<std::mutex> lock(monitorMutex_);
+      monitorCond_.wait_for(
+          lock, std::chrono::milliseconds(HEALTH_CHECK_INTERVAL_MS),
+          [this] { return !running_; });
+    }
+    if (!running_) {
+      break;
+    }
+
+    std::vector<std::pair<uint32_t, std::shared_ptr<ProcessManager>>> checks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &entry : workers_) {
+        checks.emplace_back(entry.first, entry.second.process);
+      }
+    }
+
+    // Ping in parallel so one hung body doesn't delay the others' checks
+    std::vector<std::future<bool>> pings;
+    for (auto &check : checks) {
+      auto process = check.second;
+      pings.push_back(std::async(std::launch::async, [process] {
+        return process && process->isRunning() &&
+               process->ping(HEALTH_CHECK_TIMEOUT_MS);
+      }));
+    }
+
+    for (size_t i = 0; i < checks.size() && running_; i++) {
+      uint32_t bodyID = checks[i].first;
+      std::shared_ptr<ProcessManager> process = checks[i].second;
+      std::string port;
+      bool alive = pings[i].get();
+
+      bool restartDue = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Worker &worker = workers_[bodyID];
+        port = worker.port;
+        if (alive && !worker.cameraLost) {
+          worker.healthy = true;
+          worker.failures = 0;
+          continue;
+        }
+        if (worker.healthy) {
+          std::cerr << "WorkerSupervisor: worker for body " << bodyID
+                    << " is unresponsive" << std::endl;
+          markFailed(worker);
+        }
+        restartDue = std::chrono::steady_clock::now() >= worker.nextRestart;
+      }
+
+      if (!restartDue) {
+        continue;
+      }
+
+      // shutdown() terminates the child if it doesn't exit on request
+      if (process) {
+        process->shutdown();
+      }
+      auto replacement = launch(bodyID, port);
+
+      bool restoreLiveView = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Worker &worker = workers_[bodyID];
+        worker.process = replacement;
+        if (replacement) {
+          worker.healthy = true;
+          worker.cameraLost = false;
+          restoreLiveView = worker.liveView;
+          std::cout << "WorkerSupervisor: restarted worker for body "
+                    << bodyID << std::endl;
+        } else {
+          markFailed(worker);
+        }
+      }
+
+      if (restoreLiveView) {
+        replacement->startLiveView();
+      }
+    }
+
+    // Let the remaining pings finish before the next round
+    for (size_t i = 0; i < pings.size(); i++) {
+      if (pings[i].valid()) {
+        pings[i].wait();
+      }
+    }
+  }
+}
+
+} // namespace photobooth
@@ -23,18 +23,8 @@ bool Application::initialize() {
         return false;
     }
 
-    // Detect cameras
-    auto cameras = cameraManager_->detectCameras();
-    std::cout << "Found " << cameras.size() << " camera(s):" << std::endl;
-    for (const auto& cam : cameras) {
-        std::cout << "  - " << cam << std::endl;
-    }
-
-    // Select first available camera
-    if (!cameras.empty()) {
-        cameraManager_->selectCamera(cameras[0]);
-        std::cout << "Selected camera: " << cameras[0] << std::endl;
-    }
+    // Cameras are discovered and the first one selected in the background
+    std::cout << "Camera discovery running in background" << std::endl;
 
     std::cout << "Initializing Database Manager..." << std::endl;
     dbManager_ = std::make_unique<DatabaseManager>();
@@ -57,6 +47,20 @@ bool Application::initialize() {
         return false;
     }
 
+    // Hot-plug: tell clients whenever a camera appears, drops or reconnects
+    cameraManager_->setCameraListCallback([this](const std::vector<CameraInfo>& cameras) {
+        if (wsServer_) {
+            wsServer_->broadcastCameraList(cameras);
+        }
+    });
+
+    // Push camera-side setting changes (body dials, mode switch) to clients
+    cameraManager_->setPropertyChangeCallback([this](const PropertyChange& change) {
+        if (wsServer_) {
+            wsServer_->broadcastPropertyChange(change);
+        }
+    });
+
     running_ = true;
     return true;
 }
@@ -0,0 +1,133 @@
+#include "core/WorkerPool.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace photobooth {
+
+WorkerPool& WorkerPool::getInstance() {
+    static WorkerPool instance;
+    return instance;
+}
+
+WorkerPool::WorkerPool()
+    : stopping_(false)
+    , lowPriority_(true) {
+    start(defaultThreadCount());
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+size_t WorkerPool::defaultThreadCount() {
+    size_t cores = std::thread::hardware_concurrency();
+    return cores > 2 ? cores - 2 : 1;
+}
+
+void WorkerPool::configure(size_t threads, bool lowPriority) {
+    std::lock_guard<std::mutex> configLock(configMutex_);
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lowPriority_ = lowPriority;
+    }
+    start(threads);
+
+    std::cout << "Worker pool: " << threads << " thread(s)"
+              << (lowPriority ? ", below normal priority" : "") << std::endl;
+}
+
+size_t WorkerPool::threadCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+bool WorkerPool::lowPriority() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lowPriority_;
+}
+
+void WorkerPool::start(size_t threads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+    for (size_t i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+void WorkerPool::stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        threads.swap(threads_);
+    }
+    cond_.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+bool WorkerPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (threads_.empty()) {
+            return false;
+        }
+        tasks_.push(std::move(task));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    std::vector<std::future<void>> results;
+    results.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        results.push_back(submit([&fn, i]() { fn(i); }));
+    }
+    for (auto& result : results) {
+        result.get();
+    }
+}
+
+void WorkerPool::workerLoop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Booth PCs run Windows; elsewhere threads keep the default priority
+        if (lowPriority_) {
+#ifdef _WIN32
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+        }
+    }
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            // Drain the queue before exiting so no submitted future is abandoned
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+} // namespace photobooth
@@ -0,0 +1,222 @@
+#include "image/AlphaBlend.h"
+#include "image/LayoutAnalyzer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHOTOBOOTH_BLEND_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PHOTOBOOTH_BLEND_NEON 1
+#endif
+
+namespace photobooth {
+namespace blend {
+
+namespace {
+
+// x / 255 rounded, exact for x <= 255 * 255
+inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline void blendPixel(const uint8_t* src, uint8_t* dst) {
+    uint8_t a = src[3];
+    if (a == 0) return;
+    if (a == 255) {
+        std::memcpy(dst, src, 4);
+        return;
+    }
+
+    uint32_t inv = 255 - a;
+    for (int c = 0; c < 4; c++) {
+        dst[c] = static_cast<uint8_t>(src[c] + div255(dst[c] * inv));
+    }
+}
+
+} // namespace
+
+void premultiplyRow(uint8_t* bgra, int width, uint8_t cutoff) {
+    for (int x = 0; x < width; x++, bgra += 4) {
+        uint32_t a = bgra[3];
+        if (a <= cutoff) {
+            std::memset(bgra, 0, 4);
+        } else if (a < 255) {
+            bgra[0] = static_cast<uint8_t>(div255(bgra[0] * a));
+            bgra[1] = static_cast<uint8_t>(div255(bgra[1] * a));
+            bgra[2] = static_cast<uint8_t>(div255(bgra[2] * a));
+        }
+    }
+}
+
+void blendRow(const uint8_t* overlay, uint8_t* dst, int width) {
+    int x = 0;
+
+#if defined(PHOTOBOOTH_BLEND_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i round = _mm_set1_epi16(128);
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(overlay + x * 4));
+        __m128i alpha = _mm_and_si128(s, alphaMask);
+
+        // Slot holes: leave the photo untouched
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) continue;
+
+        // Solid frame: premultiplied color is the color
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x * 4));
+
+        // Broadcast each pixel's alpha to its 4 bytes, then invert
+        __m128i a = _mm_srli_epi32(s, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        __m128i inv = _mm_xor_si128(a, _mm_set1_epi8(static_cast<char>(0xFF)));
+
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero));
+        lo = _mm_add_epi16(lo, round);
+        hi = _mm_add_epi16(hi, round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        __m128i out = _mm_adds_epu8(_mm_packus_epi16(lo, hi), s);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), out);
+    }
+#elif defined(PHOTOBOOTH_BLEND_NEON)
+    const uint16x8_t round = vdupq_n_u16(128);
+
+    for (; x + 4 <= width; x += 4) {
+        uint8x16_t s = vld1q_u8(overlay + x * 4);
+        uint32x4_t a32 = vshrq_n_u32(vreinterpretq_u32_u8(s), 24);
+
+        if (vmaxvq_u32(a32) == 0) continue;
+
+        if (vminvq_u32(a32) == 255) {
+            vst1q_u8(dst + x * 4, s);
+            continue;
+        }
+
+        uint8x16_t d = vld1q_u8(dst + x * 4);
+        uint8x16_t inv = vmvnq_u8(vreinterpretq_u8_u32(vmulq_n_u32(a32, 0x01010101)));
+
+        uint16x8_t lo = vaddq_u16(vmull_u8(vget_low_u8(d), vget_low_u8(inv)), round);
+        uint16x8_t hi = vaddq_u16(vmull_high_u8(d, inv), round);
+        lo = vaddq_u16(lo, vshrq_n_u16(lo, 8));
+        hi = vaddq_u16(hi, vshrq_n_u16(hi, 8));
+
+        uint8x16_t out = vqaddq_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)), s);
+        vst1q_u8(dst + x * 4, out);
+    }
+#endif
+
+    for (; x < width; x++) {
+        blendPixel(overlay + x * 4, dst + x * 4);
+    }
+}
+
+cv::Mat premultiply(const cv::Mat& bgra, uint8_t cutoff) {
+    if (bgra.type() != CV_8UC4) {
+        std::cerr << "premultiply expects a BGRA image" << std::endl;
+        return cv::Mat();
+    }
+
+    cv::Mat out = bgra.clone();
+    cv::parallel_for_(cv::Range(0, out.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            premultiplyRow(out.ptr<uint8_t>(y), out.cols, cutoff);
+        }
+    });
+    return out;
+}
+
+bool blendOver(const cv::Mat& overlay, cv::Mat& canvas) {
+    if (overlay.type() != CV_8UC4 || canvas.type() != CV_8UC4) {
+        std::cerr << "blendOver expects BGRA overlay and canvas" << std::endl;
+        return false;
+    }
+
+    int rows = std::min(overlay.rows, canvas.rows);
+    int cols = std::min(overlay.cols, canvas.cols);
+
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            blendRow(overlay.ptr<uint8_t>(y), canvas.ptr<uint8_t>(y), cols);
+        }
+    });
+    return true;
+}
+
+bool blendSpans(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& canvas) {
+    int rows = std::min(overlay.rows, canvas.rows);
+    std::atomic<bool> ok(true);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        if (!blendSpanRows(overlay, spans, canvas, range.start, range.end)) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+bool blendSpanRows(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& canvas,
+                   int rowBegin, int rowEnd) {
+    rowBegin = std::max(rowBegin, 0);
+    rowEnd = std::min(rowEnd, canvas.rows);
+    if (rowBegin >= rowEnd) {
+        return true;
+    }
+
+    cv::Mat band = canvas.rowRange(rowBegin, rowEnd);
+    return blendSpanBand(overlay, spans, band, rowBegin);
+}
+
+bool blendSpanBand(const cv::Mat& overlay, const SpanIndex& spans, cv::Mat& band,
+                   int rowOffset) {
+    if (overlay.type() != CV_8UC4 || band.type() != CV_8UC4) {
+        std::cerr << "blendSpans expects BGRA overlay and canvas" << std::endl;
+        return false;
+    }
+    if (spans.width != overlay.cols || spans.height != overlay.rows) {
+        std::cerr << "Span index does not match the overlay" << std::endl;
+        return false;
+    }
+
+    int rowBegin = std::max(rowOffset, 0);
+    int rowEnd = std::min(rowOffset + band.rows, overlay.rows);
+    int cols = std::min(overlay.cols, band.cols);
+
+    for (int y = rowBegin; y < rowEnd; y++) {
+        const uint8_t* src = overlay.ptr<uint8_t>(y);
+        uint8_t* dst = band.ptr<uint8_t>(y - rowOffset);
+
+        for (uint32_t i = spans.rowStart[y]; i < spans.rowStart[y + 1]; i++) {
+            const AlphaSpan& span = spans.spans[i];
+            if (span.x >= cols) break;
+            int length = std::min(span.length, cols - span.x);
+
+            switch (span.kind) {
+                case SpanKind::Transparent:
+                    break;
+                case SpanKind::Opaque:
+                    std::memcpy(dst + span.x * 4, src + span.x * 4, length * 4);
+                    break;
+                case SpanKind::Partial:
+                    blendRow(src + span.x * 4, dst + span.x * 4, length);
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace blend
+} // namespace photobooth
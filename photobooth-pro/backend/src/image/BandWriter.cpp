@@ -0,0 +1,447 @@
+#include "image/BandWriter.h"
+#include "image/JpegCodec.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef PHOTOBOOTH_HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+namespace photobooth {
+
+namespace {
+
+std::string lowerExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return "";
+    }
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+void bgrToRgb(const uint8_t* bgr, uint8_t* rgb, int width) {
+    for (int x = 0; x < width; x++, bgr += 3, rgb += 3) {
+        rgb[0] = bgr[2];
+        rgb[1] = bgr[1];
+        rgb[2] = bgr[0];
+    }
+}
+
+// ============== Buffered fallback ==============
+
+int openCvSamplingFactor(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S444: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_444;
+    case ChromaSubsampling::S422: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_422;
+    case ChromaSubsampling::S420: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_420;
+    }
+    return cv::IMWRITE_JPEG_SAMPLING_FACTOR_420;
+}
+
+// Collects the bands into a full image and saves it with OpenCV
+class BufferedWriter : public BandWriter {
+public:
+    BufferedWriter(const std::string& path, const JpegProfile& profile)
+        : path_(path), profile_(profile), dpi_(0), rowsWritten_(0) {}
+
+    bool begin(int width, int height, int dpi) override {
+        image_.create(height, width, CV_8UC3);
+        dpi_ = dpi;
+        rowsWritten_ = 0;
+        return true;
+    }
+
+    bool writeRows(const cv::Mat& band) override {
+        if (band.cols != image_.cols || rowsWritten_ + band.rows > image_.rows) {
+            std::cerr << "Band does not fit the output image" << std::endl;
+            return false;
+        }
+        cv::Mat dst = image_.rowRange(rowsWritten_, rowsWritten_ + band.rows);
+        band.copyTo(dst);
+        rowsWritten_ += band.rows;
+        return true;
+    }
+
+    bool finish() override {
+        std::vector<int> params = {
+            cv::IMWRITE_JPEG_QUALITY, profile_.quality,
+            cv::IMWRITE_JPEG_SAMPLING_FACTOR, openCvSamplingFactor(profile_.subsampling),
+            cv::IMWRITE_TIFF_RESUNIT, 2,
+            cv::IMWRITE_TIFF_XDPI, dpi_,
+            cv::IMWRITE_TIFF_YDPI, dpi_
+        };
+        bool ok = rowsWritten_ == image_.rows && cv::imwrite(path_, image_, params);
+        image_.release();
+        return ok;
+    }
+
+    bool streaming() const override { return false; }
+
+private:
+    std::string path_;
+    JpegProfile profile_;
+    int dpi_;
+    int rowsWritten_;
+    cv::Mat image_;
+};
+
+// ============== TIFF ==============
+
+// Baseline little-endian TIFF, uncompressed RGB in ~64 KB strips. Pixel data
+// follows the header directly; the IFD is appended once every row is known.
+class TiffStripWriter : public BandWriter {
+public:
+    explicit TiffStripWriter(const std::string& path)
+        : path_(path), width_(0), height_(0), dpi_(0), rowsPerStrip_(0), rowsWritten_(0),
+          finished_(false) {}
+
+    ~TiffStripWriter() override {
+        if (file_.is_open() && !finished_) {
+            file_.close();
+            std::remove(path_.c_str());
+        }
+    }
+
+    bool begin(int width, int height, int dpi) override {
+        uint64_t dataBytes = static_cast<uint64_t>(width) * height * 3;
+        if (dataBytes > 0xF0000000ULL) {
+            std::cerr << "Print too large for a baseline TIFF: " << width << "x" << height << std::endl;
+            return false;
+        }
+
+        file_.open(path_, std::ios::binary | std::ios::trunc);
+        if (!file_.is_open()) {
+            std::cerr << "Failed to create TIFF: " << path_ << std::endl;
+            return false;
+        }
+
+        width_ = width;
+        height_ = height;
+        dpi_ = dpi;
+        rowsWritten_ = 0;
+        rowsPerStrip_ = std::max(1, 65536 / (width * 3));
+        row_.resize(static_cast<size_t>(width) * 3);
+
+        // "II", 42, IFD offset patched in finish()
+        const uint8_t header[8] = {'I', 'I', 42, 0, 0, 0, 0, 0};
+        file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        return file_.good();
+    }
+
+    bool writeRows(const cv::Mat& band) override {
+        if (band.cols != width_ || rowsWritten_ + band.rows > height_) {
+            std::cerr << "Band does not fit the output image" << std::endl;
+            return false;
+        }
+        for (int y = 0; y < band.rows; y++) {
+            bgrToRgb(band.ptr<uint8_t>(y), row_.data(), width_);
+            file_.write(reinterpret_cast<const char*>(row_.data()), row_.size());
+        }
+        rowsWritten_ += band.rows;
+        return file_.good();
+    }
+
+    bool finish() override {
+        if (rowsWritten_ != height_) {
+            std::cerr << "TIFF incomplete: " << rowsWritten_ << " of " << height_ << " rows" << std::endl;
+            return false;
+        }
+
+        uint32_t rowBytes = static_cast<uint32_t>(width_) * 3;
+        uint32_t strips = (height_ + rowsPerStrip_ - 1) / rowsPerStrip_;
+
+        // IFD goes after the pixels, on a word boundary
+        uint32_t ifdOffset = 8 + rowBytes * static_cast<uint32_t>(height_);
+        if (ifdOffset & 1) {
+            file_.put(0);
+            ifdOffset++;
+        }
+
+        const uint16_t entryCount = 13;
+        uint32_t extraOffset = ifdOffset + 2 + entryCount * 12 + 4;
+
+        const uint16_t SHORT = 3, LONG = 4, RATIONAL = 5;
+
+        // Values that don't fit in an entry are stored after the IFD
+        std::vector<uint8_t> ifd;
+        std::vector<uint8_t> extra;
+        auto put16 = [](std::vector<uint8_t>& out, uint16_t v) {
+            out.push_back(static_cast<uint8_t>(v));
+            out.push_back(static_cast<uint8_t>(v >> 8));
+        };
+        auto put32 = [&](std::vector<uint8_t>& out, uint32_t v) {
+            put16(out, static_cast<uint16_t>(v));
+            put16(out, static_cast<uint16_t>(v >> 16));
+        };
+        auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+            put16(ifd, tag);
+            put16(ifd, type);
+            put32(ifd, count);
+            if (type == SHORT && count == 1) {
+                put16(ifd, static_cast<uint16_t>(value));
+                put16(ifd, 0);
+            } else {
+                put32(ifd, value);
+            }
+        };
+        auto extraAt = [&]() { return extraOffset + static_cast<uint32_t>(extra.size()); };
+
+        put16(ifd, entryCount);
+        entry(256, LONG, 1, width_);                     // ImageWidth
+        entry(257, LONG, 1, height_);                    // ImageLength
+
+        entry(258, SHORT, 3, extraAt());                 // BitsPerSample 8,8,8
+        put16(extra, 8); put16(extra, 8); put16(extra, 8);
+
+        entry(259, SHORT, 1, 1);                         // Compression: none
+        entry(262, SHORT, 1, 2);                         // Photometric: RGB
+
+        if (strips == 1) {
+            entry(273, LONG, 1, 8);                      // StripOffsets
+        } else {
+            entry(273, LONG, strips, extraAt());
+            for (uint32_t i = 0; i < strips; i++) {
+                put32(extra, 8 + i * rowsPerStrip_ * rowBytes);
+            }
+        }
+
+        entry(277, SHORT, 1, 3);                         // SamplesPerPixel
+        entry(278, LONG, 1, rowsPerStrip_);              // RowsPerStrip
+
+        if (strips == 1) {
+            entry(279, LONG, 1, rowBytes * height_);     // StripByteCounts
+        } else {
+            entry(279, LONG, strips, extraAt());
+            for (uint32_t i = 0; i < strips; i++) {
+                uint32_t rows = std::min<uint32_t>(rowsPerStrip_, height_ - i * rowsPerStrip_);
+                put32(extra, rows * rowBytes);
+            }
+        }
+
+        entry(282, RATIONAL, 1, extraAt());              // XResolution
+        put32(extra, dpi_); put32(extra, 1);
+        entry(283, RATIONAL, 1, extraAt());              // YResolution
+        put32(extra, dpi_); put32(extra, 1);
+
+        entry(284, SHORT, 1, 1);                         // PlanarConfiguration: chunky
+        entry(296, SHORT, 1, 2);                         // ResolutionUnit: inch
+        put32(ifd, 0);                                   // No further IFDs
+
+        file_.write(reinterpret_cast<const char*>(ifd.data()), ifd.size());
+        file_.write(reinterpret_cast<const char*>(extra.data()), extra.size());
+
+        std::vector<uint8_t> offset;
+        put32(offset, ifdOffset);
+        file_.seekp(4);
+        file_.write(reinterpret_cast<const char*>(offset.data()), offset.size());
+
+        file_.close();
+        finished_ = !file_.fail();
+        return finished_;
+    }
+
+    bool streaming() const override { return true; }
+
+private:
+    std::string path_;
+    std::ofstream file_;
+    int width_;
+    int height_;
+    int dpi_;
+    int rowsPerStrip_;
+    int rowsWritten_;
+    bool finished_;
+    std::vector<uint8_t> row_;
+};
+
+// ============== JPEG ==============
+
+#ifdef PHOTOBOOTH_HAVE_LIBJPEG
+
+struct JpegErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf jump;
+};
+
+// libjpeg's default error_exit terminates the process
+void exitWithJump(j_common_ptr cinfo) {
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    std::cerr << "JPEG encode failed: " << message << std::endl;
+    longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump, 1);
+}
+
+// Scanlines go straight to libjpeg. Every libjpeg call is guarded by a
+// setjmp in the same function, and no locals with destructors live there.
+class JpegStreamWriter : public BandWriter {
+public:
+    JpegStreamWriter(const std::string& path, const JpegProfile& profile)
+        : path_(path), profile_(profile), file_(nullptr), created_(false) {
+        std::memset(&cinfo_, 0, sizeof(cinfo_));
+        cinfo_.err = jpeg_std_error(&error_.base);
+        error_.base.error_exit = exitWithJump;
+    }
+
+    ~JpegStreamWriter() override {
+        if (file_) {
+            discard();
+        }
+    }
+
+    bool begin(int width, int height, int dpi) override {
+        file_ = std::fopen(path_.c_str(), "wb");
+        if (!file_) {
+            std::cerr << "Failed to create JPEG: " << path_ << std::endl;
+            return false;
+        }
+
+        if (setjmp(error_.jump)) {
+            discard();
+            return false;
+        }
+
+        jpeg_create_compress(&cinfo_);
+        created_ = true;
+        jpeg_stdio_dest(&cinfo_, file_);
+
+        cinfo_.image_width = static_cast<JDIMENSION>(width);
+        cinfo_.image_height = static_cast<JDIMENSION>(height);
+        cinfo_.input_components = 3;
+#ifdef JCS_EXTENSIONS
+        cinfo_.in_color_space = JCS_EXT_BGR;
+#else
+        cinfo_.in_color_space = JCS_RGB;
+        row_.resize(static_cast<size_t>(width) * 3);
+#endif
+        jpeg_set_defaults(&cinfo_);
+        jpeg_set_quality(&cinfo_, profile_.quality, TRUE);
+        if (profile_.fastDct) {
+            cinfo_.dct_method = JDCT_IFAST;
+        }
+
+        // Same chroma sampling as in-memory print encodes; libjpeg's
+        // default is 4:2:0. Luma carries the factors, chroma stays 1x1.
+        int hSamp = profile_.subsampling == ChromaSubsampling::S444 ? 1 : 2;
+        int vSamp = profile_.subsampling == ChromaSubsampling::S420 ? 2 : 1;
+        cinfo_.comp_info[0].h_samp_factor = hSamp;
+        cinfo_.comp_info[0].v_samp_factor = vSamp;
+        for (int i = 1; i < cinfo_.num_components; i++) {
+            cinfo_.comp_info[i].h_samp_factor = 1;
+            cinfo_.comp_info[i].v_samp_factor = 1;
+        }
+
+        cinfo_.density_unit = 1;    // Dots per inch
+        cinfo_.X_density = static_cast<UINT16>(std::min(dpi, 65535));
+        cinfo_.Y_density = cinfo_.X_density;
+
+        jpeg_start_compress(&cinfo_, TRUE);
+        return true;
+    }
+
+    bool writeRows(const cv::Mat& band) override {
+        if (!file_ || band.cols != static_cast<int>(cinfo_.image_width)) {
+            std::cerr << "Band does not fit the output image" << std::endl;
+            return false;
+        }
+
+        if (setjmp(error_.jump)) {
+            discard();
+            return false;
+        }
+
+        for (int y = 0; y < band.rows; y++) {
+#ifdef JCS_EXTENSIONS
+            JSAMPROW row = const_cast<JSAMPROW>(band.ptr<uint8_t>(y));
+#else
+            bgrToRgb(band.ptr<uint8_t>(y), row_.data(), band.cols);
+            JSAMPROW row = row_.data();
+#endif
+            jpeg_write_scanlines(&cinfo_, &row, 1);
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (!file_) {
+            return false;
+        }
+        if (cinfo_.next_scanline != cinfo_.image_height) {
+            std::cerr << "JPEG incomplete: " << cinfo_.next_scanline << " of "
+                      << cinfo_.image_height << " rows" << std::endl;
+            return false;
+        }
+
+        if (setjmp(error_.jump)) {
+            discard();
+            return false;
+        }
+
+        jpeg_finish_compress(&cinfo_);
+        jpeg_destroy_compress(&cinfo_);
+        created_ = false;
+
+        bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        return ok;
+    }
+
+    bool streaming() const override { return true; }
+
+private:
+    std::string path_;
+    JpegProfile profile_;
+    FILE* file_;
+    bool created_;
+    jpeg_compress_struct cinfo_;
+    JpegErrorManager error_;
+    std::vector<uint8_t> row_;
+
+    // Tear down after an error or an unfinished encode, removing the partial file
+    void discard() {
+        if (created_) {
+            jpeg_destroy_compress(&cinfo_);
+            created_ = false;
+        }
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+            std::remove(path_.c_str());
+        }
+    }
+};
+
+#endif // PHOTOBOOTH_HAVE_LIBJPEG
+
+} // namespace
+
+std::unique_ptr<BandWriter> BandWriter::create(const std::string& outputPath, int jpegQuality) {
+    std::string ext = lowerExtension(outputPath);
+
+    // Print files and in-memory print encodes share one profile
+    JpegProfile profile = JpegCodec::getInstance().profile(JpegUse::Print);
+    if (jpegQuality > 0) {
+        profile.quality = jpegQuality;
+    }
+
+    if (ext == ".tif" || ext == ".tiff") {
+        return std::make_unique<TiffStripWriter>(outputPath);
+    }
+#ifdef PHOTOBOOTH_HAVE_LIBJPEG
+    if (ext == ".jpg" || ext == ".jpeg") {
+        return std::make_unique<JpegStreamWriter>(outputPath, profile);
+    }
+#endif
+    return std::make_unique<BufferedWriter>(outputPath, profile);
+}
+
+} // namespace photobooth
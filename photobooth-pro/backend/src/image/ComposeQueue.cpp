@@ -0,0 +1,103 @@
+#include "image/ComposeQueue.h"
+#include "image/CompositeRenderer.h"
+#include "core/WorkerPool.h"
+#include <chrono>
+#include <iostream>
+
+namespace photobooth {
+
+ComposeQueue& ComposeQueue::getInstance() {
+    static ComposeQueue instance;
+    return instance;
+}
+
+ComposeQueue::ComposeQueue()
+    : running_(false)
+    , stopping_(false)
+    , nextId_(1)
+{
+    // Jobs render on the pool, so it has to outlive this queue's destructor
+    WorkerPool::getInstance();
+    thread_ = std::thread(&ComposeQueue::workerLoop, this);
+}
+
+ComposeQueue::~ComposeQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::string ComposeQueue::enqueue(ComposeJob job, Callback onDone) {
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = "compose-" + std::to_string(nextId_++);
+        job.id = id;
+        jobs_.push_back({std::move(job), std::move(onDone)});
+    }
+    cond_.notify_one();
+    return id;
+}
+
+size_t ComposeQueue::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + (running_ ? 1 : 0);
+}
+
+void ComposeQueue::workerLoop() {
+    while (true) {
+        Pending pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            // Finish queued prints before exiting; guests are waiting on them
+            if (jobs_.empty()) {
+                return;
+            }
+            pending = std::move(jobs_.front());
+            jobs_.pop_front();
+            running_ = true;
+        }
+
+        const ComposeJob& job = pending.job;
+        auto start = std::chrono::steady_clock::now();
+
+        bool success;
+        if (job.fitted.empty()) {
+            ImageCompositor compositor;
+            success = compositor.composeForPrint(job.layoutPath, job.photos, job.config,
+                                                 job.outputPath, job.options);
+        } else {
+            // Slots were fitted while the session was shooting; only the
+            // overlay and the encode are left
+            success = renderToFile(job.layoutPath, job.config, job.fitted.size(),
+                [&job](size_t index, const SlotInfo&) { return job.fitted[index]; },
+                job.outputPath, job.options);
+        }
+
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        if (success) {
+            std::cout << "Compose " << job.id << " done in " << elapsedMs << " ms: "
+                      << job.outputPath << std::endl;
+        } else {
+            std::cerr << "Compose " << job.id << " failed: " << job.outputPath << std::endl;
+        }
+
+        if (pending.onDone) {
+            pending.onDone(job, success, elapsedMs);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+}
+
+} // namespace photobooth
@@ -0,0 +1,203 @@
+#include "image/ComposeSession.h"
+#include "image/LayoutAssetCache.h"
+#include "image/PhotoDecodeCache.h"
+#include "core/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace photobooth {
+
+std::shared_ptr<ComposeSession> ComposeSession::create(const std::string& layoutPath,
+                                                       const LayoutConfig& config,
+                                                       const std::string& outputPath,
+                                                       const PrintOptions& options,
+                                                       ComposeQueue::Callback onDone) {
+    return std::shared_ptr<ComposeSession>(
+        new ComposeSession(layoutPath, config, outputPath, options, std::move(onDone)));
+}
+
+ComposeSession::ComposeSession(const std::string& layoutPath, const LayoutConfig& config,
+                               const std::string& outputPath, const PrintOptions& options,
+                               ComposeQueue::Callback onDone)
+    : layoutPath_(layoutPath)
+    , config_(config)
+    , outputPath_(outputPath)
+    , options_(options)
+    , onDone_(std::move(onDone))
+    , submitted_(false)
+    , cancelled_(false)
+    , lastActivity_(std::chrono::steady_clock::now())
+{
+    static std::atomic<uint64_t> nextId(1);
+    id_ = "session-" + std::to_string(nextId++);
+
+    layout_ = LayoutAssetCache::getInstance().get(layoutPath);
+
+    // Same scaling as the banded renderer, so fitted photos match its slots
+    double scale = 1.0;
+    if (options.dpi > 0 && options.layoutDpi > 0) {
+        scale = static_cast<double>(options.dpi) / options.layoutDpi;
+    }
+    for (const auto& slot : config.slots) {
+        slots_.push_back(scaleSlot(slot, scale));
+    }
+
+    photos_.resize(slots_.size());
+    fitted_.resize(slots_.size());
+    ready_.resize(slots_.size(), false);
+    failed_.resize(slots_.size(), false);
+    generations_.resize(slots_.size(), 0);
+}
+
+int ComposeSession::addPhoto(const std::string& photoPath, int slotIndex) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (submitted_ || cancelled_) {
+            return -1;
+        }
+        lastActivity_ = std::chrono::steady_clock::now();
+
+        if (slotIndex < 0) {
+            auto it = std::find_if(photos_.begin(), photos_.end(),
+                                   [](const std::string& photo) { return photo.empty(); });
+            if (it == photos_.end()) {
+                return -1;
+            }
+            slotIndex = static_cast<int>(it - photos_.begin());
+        } else if (slotIndex >= static_cast<int>(slots_.size())) {
+            return -1;
+        }
+
+        photos_[slotIndex] = photoPath;
+        ready_[slotIndex] = false;
+        failed_[slotIndex] = false;
+        generation = ++generations_[slotIndex];
+    }
+
+    // The task keeps the session alive until the slot is fitted
+    auto self = shared_from_this();
+    size_t index = static_cast<size_t>(slotIndex);
+    WorkerPool::getInstance().submit([self, index, photoPath, generation]() {
+        self->fitSlot(index, photoPath, generation);
+    });
+    return slotIndex;
+}
+
+void ComposeSession::fitSlot(size_t index, const std::string& photoPath, uint64_t generation) {
+    const SlotInfo& slot = slots_[index];
+    bool sized = slot.width > 0 && slot.height > 0;
+    cv::Mat fitted;
+    if (sized) {
+        fitted = PhotoDecodeCache::getInstance().getFitted(photoPath, slot.width, slot.height,
+                                                           slot.rotation);
+    }
+
+    ComposeJob failure;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (submitted_ || cancelled_ || generation != generations_[index]) {
+            // Replaced by a retake meanwhile, or abandoned
+            return;
+        }
+
+        if (sized && fitted.empty()) {
+            // Not rendered as a blank slot; the guest can retake it
+            std::cerr << "Compose session " << id_ << ": failed to load " << photoPath
+                      << " for slot " << index << std::endl;
+            failed_[index] = true;
+        } else {
+            fitted_[index] = fitted;
+            ready_[index] = true;
+        }
+
+        for (size_t i = 0; i < slots_.size(); i++) {
+            if (!ready_[i] && !failed_[i]) {
+                return; // Still waiting for a photo
+            }
+            if (failed_[i]) {
+                failure.failedSlots.push_back(static_cast<int>(i));
+            }
+        }
+
+        if (failure.failedSlots.empty()) {
+            submitLocked();
+            return;
+        }
+
+        failure.sessionId = id_;
+        failure.layoutPath = layoutPath_;
+        failure.photos = photos_;
+        failure.config = config_;
+        failure.outputPath = outputPath_;
+        failure.options = options_;
+    }
+
+    // Every slot has settled but some can't be printed
+    if (onDone_) {
+        onDone_(failure, false, 0);
+    }
+}
+
+void ComposeSession::submitLocked() {
+    submitted_ = true;
+
+    ComposeJob job;
+    job.sessionId = id_;
+    job.layoutPath = layoutPath_;
+    job.photos = photos_;
+    job.config = config_;
+    job.outputPath = outputPath_;
+    job.options = options_;
+    job.fitted = fitted_;
+
+    jobId_ = ComposeQueue::getInstance().enqueue(std::move(job), onDone_);
+    std::cout << "Compose session " << id_ << " complete, queued as " << jobId_ << std::endl;
+
+    // The queued job holds its own references to the fitted photos
+    fitted_.clear();
+}
+
+size_t ComposeSession::photoCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::count_if(photos_.begin(), photos_.end(),
+                         [](const std::string& photo) { return !photo.empty(); });
+}
+
+bool ComposeSession::submitted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return submitted_;
+}
+
+std::vector<int> ComposeSession::failedSlots() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> failed;
+    for (size_t i = 0; i < failed_.size(); i++) {
+        if (failed_[i]) {
+            failed.push_back(static_cast<int>(i));
+        }
+    }
+    return failed;
+}
+
+void ComposeSession::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (submitted_) {
+        return; // ComposeQueue owns the photos now
+    }
+    cancelled_ = true;
+    fitted_.clear();
+}
+
+std::chrono::steady_clock::time_point ComposeSession::lastActivity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastActivity_;
+}
+
+std::string ComposeSession::jobId() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobId_;
+}
+
+} // namespace photobooth
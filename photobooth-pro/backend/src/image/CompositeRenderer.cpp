@@ -0,0 +1,225 @@
+#include "image/CompositeRenderer.h"
+#include "image/AlphaBlend.h"
+#include "image/BandWriter.h"
+#include "image/LayoutAssetCache.h"
+#include "image/RenditionPyramid.h"
+#include "core/WorkerPool.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <iostream>
+
+namespace photobooth {
+
+namespace {
+
+// Rows per overlay band; small enough to spread a strip over all workers
+constexpr int BLEND_BAND_ROWS = 128;
+
+// Output rows [rowBegin, rowEnd) of the premultiplied layout resampled by
+// scale. Only the layout rows under those output rows are read.
+void scaleOverlayRows(const cv::Mat& overlay, double scale, int width,
+                      int rowBegin, int rowEnd, cv::Mat& out) {
+    double inv = 1.0 / scale;
+
+    // Bilinear taps of the first and last output row, plus a row of margin
+    int srcTop = static_cast<int>(std::floor((rowBegin + 0.5) * inv - 0.5)) - 1;
+    int srcBottom = static_cast<int>(std::floor((rowEnd - 0.5) * inv - 0.5)) + 3;
+    srcBottom = std::min(std::max(srcBottom, 1), overlay.rows);
+    srcTop = std::min(std::max(srcTop, 0), srcBottom - 1);
+
+    // Maps output pixels to source pixels (pixel centers aligned, like cv::resize)
+    cv::Matx23d map(inv, 0, 0.5 * inv - 0.5,
+                    0, inv, (rowBegin + 0.5) * inv - 0.5 - srcTop);
+    cv::warpAffine(overlay.rowRange(srcTop, srcBottom), out, map,
+                   cv::Size(width, rowEnd - rowBegin),
+                   cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+}
+
+} // namespace
+
+cv::Mat renderComposite(
+    const LayoutAsset& layout,
+    const LayoutConfig& config,
+    size_t photoCount,
+    const FitPhoto& fitPhoto) {
+
+    WorkerPool& pool = WorkerPool::getInstance();
+
+    // Decode, resize and crop every slot in parallel
+    size_t slotCount = std::min(config.slots.size(), photoCount);
+    std::vector<cv::Mat> fitted(slotCount);
+    pool.parallelFor(slotCount, [&](size_t i) {
+        fitted[i] = fitPhoto(i, config.slots[i]);
+    });
+
+    // Compose on BGRA so the layout blends a whole pixel at a time
+    cv::Mat canvas(layout.height, layout.width, CV_8UC4, cv::Scalar(255, 255, 255, 255));
+
+    // Placement is cheap; keep it in slot order so overlapping slots
+    // stack the same way as before
+    cv::Rect bounds(0, 0, canvas.cols, canvas.rows);
+    for (size_t i = 0; i < slotCount; i++) {
+        if (fitted[i].empty()) continue;
+
+        const SlotInfo& slot = config.slots[i];
+        cv::Rect destRect = cv::Rect(slot.x, slot.y, fitted[i].cols, fitted[i].rows) & bounds;
+        if (destRect.empty()) continue;
+
+        cv::Mat source = fitted[i](cv::Rect(destRect.x - slot.x, destRect.y - slot.y,
+                                            destRect.width, destRect.height));
+        cv::Mat slotRoi = canvas(destRect);
+        cv::cvtColor(source, slotRoi, cv::COLOR_BGR2BGRA);
+    }
+
+    // Overlay the layout PNG on top and convert to BGR, one band per task
+    cv::Mat result(canvas.rows, canvas.cols, CV_8UC3);
+    size_t bands = (canvas.rows + BLEND_BAND_ROWS - 1) / BLEND_BAND_ROWS;
+    pool.parallelFor(bands, [&](size_t band) {
+        int rowBegin = static_cast<int>(band) * BLEND_BAND_ROWS;
+        int rowEnd = std::min(canvas.rows, rowBegin + BLEND_BAND_ROWS);
+
+        if (!layout.overlay.empty()) {
+            blend::blendSpanRows(layout.overlay, layout.spans, canvas, rowBegin, rowEnd);
+        }
+
+        cv::Mat resultBand = result.rowRange(rowBegin, rowEnd);
+        cv::cvtColor(canvas.rowRange(rowBegin, rowEnd), resultBand, cv::COLOR_BGRA2BGR);
+    });
+
+    return result;
+}
+
+bool renderBands(
+    const LayoutAsset& layout,
+    const LayoutConfig& config,
+    size_t photoCount,
+    const FitPhoto& fitPhoto,
+    const PrintOptions& options,
+    BandWriter& writer) {
+
+    WorkerPool& pool = WorkerPool::getInstance();
+
+    double scale = 1.0;
+    if (options.dpi > 0 && options.layoutDpi > 0) {
+        scale = static_cast<double>(options.dpi) / options.layoutDpi;
+    }
+    int width = std::max(1, static_cast<int>(std::lround(layout.width * scale)));
+    int height = std::max(1, static_cast<int>(std::lround(layout.height * scale)));
+    bool nativeSize = width == layout.width && height == layout.height;
+
+    // Decode, resize and crop every slot at print size in parallel
+    size_t slotCount = std::min(config.slots.size(), photoCount);
+    std::vector<SlotInfo> slots(slotCount);
+    std::vector<cv::Mat> fitted(slotCount);
+    pool.parallelFor(slotCount, [&](size_t i) {
+        slots[i] = scaleSlot(config.slots[i], scale);
+        if (slots[i].width > 0 && slots[i].height > 0) {
+            fitted[i] = fitPhoto(i, slots[i]);
+        }
+    });
+
+    if (!writer.begin(width, height, options.dpi)) {
+        return false;
+    }
+
+    int bandRows = std::max(1, std::min(options.bandRows, height));
+    cv::Mat canvas(bandRows, width, CV_8UC4);
+
+    // Share/thumbnail copies are downscaled from the same bands
+    RenditionPyramid renditions(options.renditions, width, height, bandRows);
+    cv::Mat encodeBuffers[2] = {cv::Mat(bandRows, width, CV_8UC3),
+                                cv::Mat(bandRows, width, CV_8UC3)};
+
+    // Each band is split across the pool; the previous band is encoded
+    // meanwhile, so the encoder overlaps rendering
+    size_t workers = std::max<size_t>(1, pool.threadCount());
+    std::future<bool> pending;
+    bool ok = true;
+
+    for (int bandTop = 0, index = 0; bandTop < height; bandTop += bandRows, index++) {
+        int rows = std::min(bandRows, height - bandTop);
+        cv::Mat band = canvas.rowRange(0, rows);
+        cv::Mat& encoded = encodeBuffers[index % 2];
+
+        int partRows = static_cast<int>((rows + workers - 1) / workers);
+        size_t parts = (rows + partRows - 1) / partRows;
+        pool.parallelFor(parts, [&](size_t partIndex) {
+            int begin = static_cast<int>(partIndex) * partRows;
+            int end = std::min(rows, begin + partRows);
+            int top = bandTop + begin;
+
+            cv::Mat part = band.rowRange(begin, end);
+            part.setTo(cv::Scalar(255, 255, 255, 255));
+
+            // Photos in slot order, so overlapping slots stack as before
+            cv::Rect partRect(0, top, width, end - begin);
+            for (size_t i = 0; i < slotCount; i++) {
+                if (fitted[i].empty()) continue;
+
+                const SlotInfo& slot = slots[i];
+                cv::Rect destRect = cv::Rect(slot.x, slot.y, fitted[i].cols, fitted[i].rows) & partRect;
+                if (destRect.empty()) continue;
+
+                cv::Mat source = fitted[i](cv::Rect(destRect.x - slot.x, destRect.y - slot.y,
+                                                    destRect.width, destRect.height));
+                cv::Mat slotRoi = part(cv::Rect(destRect.x, destRect.y - top,
+                                                destRect.width, destRect.height));
+                cv::cvtColor(source, slotRoi, cv::COLOR_BGR2BGRA);
+            }
+
+            // Layout on top: span index at native size, resampled rows otherwise
+            if (!layout.overlay.empty()) {
+                if (nativeSize) {
+                    blend::blendSpanBand(layout.overlay, layout.spans, part, top);
+                } else {
+                    cv::Mat overlayRows;
+                    scaleOverlayRows(layout.overlay, scale, width, top, top + part.rows, overlayRows);
+                    for (int y = 0; y < part.rows; y++) {
+                        blend::blendRow(overlayRows.ptr<uint8_t>(y), part.ptr<uint8_t>(y), width);
+                    }
+                }
+            }
+
+            cv::Mat encodedPart = encoded.rowRange(begin, end);
+            cv::cvtColor(part, encodedPart, cv::COLOR_BGRA2BGR);
+        });
+
+        if (pending.valid() && !pending.get()) {
+            ok = false;
+            break;
+        }
+        cv::Mat ready = encoded.rowRange(0, rows);
+        pending = pool.submit([&writer, &renditions, ready]() {
+            renditions.addRows(ready);
+            return writer.writeRows(ready);
+        });
+    }
+
+    if (pending.valid() && !pending.get()) {
+        ok = false;
+    }
+    ok = ok && writer.finish();
+    return ok && renditions.finish();
+}
+
+bool renderToFile(
+    const std::string& layoutPath,
+    const LayoutConfig& config,
+    size_t photoCount,
+    const FitPhoto& fitPhoto,
+    const std::string& outputPath,
+    const PrintOptions& options) {
+
+    // Decoded and premultiplied once per layout version
+    auto layout = LayoutAssetCache::getInstance().get(layoutPath);
+    if (!layout) {
+        return false;
+    }
+
+    auto writer = BandWriter::create(outputPath, options.jpegQuality);
+    return renderBands(*layout, config, photoCount, fitPhoto, options, *writer);
+}
+
+} // namespace photobooth
@@ -0,0 +1,405 @@
+#include "image/JpegCodec.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef PHOTOBOOTH_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace photobooth {
+
+namespace {
+
+// Scratch buffers grown past this by a print-size encode are released
+// afterwards, so pool threads don't each pin tens of megabytes
+constexpr size_t SCRATCH_KEEP_BYTES = 8 * 1024 * 1024;
+
+bool validScale(int scaleDenom) {
+    return scaleDenom == 1 || scaleDenom == 2 || scaleDenom == 4 || scaleDenom == 8;
+}
+
+// Undo the EXIF orientation the same way cv::imread does
+cv::Mat applyOrientation(const cv::Mat& image, int orientation) {
+    cv::Mat oriented;
+    switch (orientation) {
+    case 2: cv::flip(image, oriented, 1); break;
+    case 3: cv::flip(image, oriented, -1); break;
+    case 4: cv::flip(image, oriented, 0); break;
+    case 5: cv::transpose(image, oriented); break;
+    case 6: cv::rotate(image, oriented, cv::ROTATE_90_CLOCKWISE); break;
+    case 7:
+        cv::transpose(image, oriented);
+        cv::flip(oriented, oriented, -1);
+        break;
+    case 8: cv::rotate(image, oriented, cv::ROTATE_90_COUNTERCLOCKWISE); break;
+    default: return image;
+    }
+    return oriented;
+}
+
+#ifdef PHOTOBOOTH_HAVE_TURBOJPEG
+
+// TurboJPEG handles aren't thread-safe; each thread gets its own
+struct ThreadCodec {
+    tjhandle compressor = nullptr;
+    tjhandle decompressor = nullptr;
+    std::vector<uint8_t> scratch;
+
+    ~ThreadCodec() {
+        if (compressor) tjDestroy(compressor);
+        if (decompressor) tjDestroy(decompressor);
+    }
+};
+
+ThreadCodec& threadCodec() {
+    thread_local ThreadCodec codec;
+    return codec;
+}
+
+std::vector<uint8_t>& threadScratch() {
+    return threadCodec().scratch;
+}
+
+int turboSubsampling(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S444: return TJSAMP_444;
+    case ChromaSubsampling::S422: return TJSAMP_422;
+    case ChromaSubsampling::S420: return TJSAMP_420;
+    }
+    return TJSAMP_420;
+}
+
+bool encodeOnce(const cv::Mat& image, const JpegProfile& profile, int quality,
+                const uint8_t*& data, size_t& size) {
+    ThreadCodec& codec = threadCodec();
+    if (!codec.compressor) {
+        codec.compressor = tjInitCompress();
+        if (!codec.compressor) {
+            std::cerr << "TurboJPEG: failed to create compressor" << std::endl;
+            return false;
+        }
+    }
+
+    int pixelFormat;
+    int subsampling = turboSubsampling(profile.subsampling);
+    switch (image.channels()) {
+    case 1:
+        pixelFormat = TJPF_GRAY;
+        subsampling = TJSAMP_GRAY;
+        break;
+    case 3: pixelFormat = TJPF_BGR; break;
+    case 4: pixelFormat = TJPF_BGRX; break;
+    default: return false;
+    }
+
+    // Worst-case size, so the encoder never reallocates the scratch buffer
+    unsigned long bound = tjBufSize(image.cols, image.rows, subsampling);
+    if (codec.scratch.size() < bound) {
+        codec.scratch.resize(bound);
+    }
+
+    unsigned char* buffer = codec.scratch.data();
+    unsigned long jpegSize = codec.scratch.size();
+    int flags = TJFLAG_NOREALLOC | (profile.fastDct ? TJFLAG_FASTDCT : TJFLAG_ACCURATEDCT);
+
+    if (tjCompress2(codec.compressor, image.data, image.cols, static_cast<int>(image.step),
+                    image.rows, pixelFormat, &buffer, &jpegSize, subsampling, quality,
+                    flags) != 0) {
+        std::cerr << "TurboJPEG encode failed: " << tjGetErrorStr2(codec.compressor)
+                  << std::endl;
+        return false;
+    }
+
+    data = buffer;
+    size = jpegSize;
+    return true;
+}
+
+#else
+
+std::vector<uint8_t>& threadScratch() {
+    thread_local std::vector<uint8_t> scratch;
+    return scratch;
+}
+
+int samplingFactor(ChromaSubsampling subsampling) {
+    switch (subsampling) {
+    case ChromaSubsampling::S444: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_444;
+    case ChromaSubsampling::S422: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_422;
+    case ChromaSubsampling::S420: return cv::IMWRITE_JPEG_SAMPLING_FACTOR_420;
+    }
+    return cv::IMWRITE_JPEG_SAMPLING_FACTOR_420;
+}
+
+bool encodeOnce(const cv::Mat& image, const JpegProfile& profile, int quality,
+                const uint8_t*& data, size_t& size) {
+    // imencode resizes the scratch vector in place, keeping its capacity
+    std::vector<uint8_t>& scratch = threadScratch();
+    std::vector<int> params = {
+        cv::IMWRITE_JPEG_QUALITY, quality,
+        cv::IMWRITE_JPEG_SAMPLING_FACTOR, samplingFactor(profile.subsampling)
+    };
+    if (!cv::imencode(".jpg", image, scratch, params)) {
+        return false;
+    }
+
+    data = scratch.data();
+    size = scratch.size();
+    return true;
+}
+
+#endif
+
+void trimScratch() {
+    std::vector<uint8_t>& scratch = threadScratch();
+    if (scratch.capacity() > SCRATCH_KEEP_BYTES) {
+        std::vector<uint8_t>().swap(scratch);
+    }
+}
+
+} // namespace
+
+JpegCodec& JpegCodec::getInstance() {
+    static JpegCodec instance;
+    return instance;
+}
+
+JpegCodec::JpegCodec() {
+    JpegProfile liveView;
+    liveView.quality = 70;
+    liveView.subsampling = ChromaSubsampling::S420;
+    liveView.fastDct = true;
+
+    JpegProfile preview;
+    preview.quality = 80;
+    preview.subsampling = ChromaSubsampling::S420;
+
+    JpegProfile print;
+    print.quality = 95;
+    print.subsampling = ChromaSubsampling::S444;
+
+    // Small enough for email attachments and QR downloads over venue Wi-Fi
+    JpegProfile share;
+    share.quality = 90;
+    share.subsampling = ChromaSubsampling::S420;
+    share.maxBytes = 2 * 1024 * 1024;
+    share.minQuality = 60;
+
+    profiles_[static_cast<size_t>(JpegUse::LiveView)] = liveView;
+    profiles_[static_cast<size_t>(JpegUse::Preview)] = preview;
+    profiles_[static_cast<size_t>(JpegUse::Print)] = print;
+    profiles_[static_cast<size_t>(JpegUse::Share)] = share;
+}
+
+JpegProfile JpegCodec::profile(JpegUse use) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return profiles_[static_cast<size_t>(use)];
+}
+
+void JpegCodec::setProfile(JpegUse use, const JpegProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    profiles_[static_cast<size_t>(use)] = profile;
+}
+
+bool JpegCodec::encodeScratch(const cv::Mat& image, const JpegProfile& profile,
+                              const uint8_t*& data, size_t& size) {
+    if (image.empty() || image.depth() != CV_8U) {
+        return false;
+    }
+
+    int quality = std::max(1, std::min(100, profile.quality));
+    if (!encodeOnce(image, profile, quality, data, size)) {
+        return false;
+    }
+    if (profile.maxBytes == 0 || size <= profile.maxBytes) {
+        return true;
+    }
+
+    // Highest quality that still fits, down to minQuality
+    int low = std::max(1, std::min(profile.minQuality, quality));
+    int high = quality - 1;
+    int best = low;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (!encodeOnce(image, profile, mid, data, size)) {
+            return false;
+        }
+        if (size <= profile.maxBytes) {
+            best = mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    // The scratch holds the last attempt, which may not be the best one
+    return encodeOnce(image, profile, best, data, size);
+}
+
+bool JpegCodec::encode(const cv::Mat& image, JpegUse use, std::vector<uint8_t>& out) {
+    return encode(image, profile(use), out);
+}
+
+bool JpegCodec::encode(const cv::Mat& image, const JpegProfile& profile,
+                       std::vector<uint8_t>& out) {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (!encodeScratch(image, profile, data, size)) {
+        out.clear();
+        return false;
+    }
+
+    out.assign(data, data + size);
+    trimScratch();
+    return true;
+}
+
+bool JpegCodec::encodeToFile(const cv::Mat& image, JpegUse use, const std::string& path) {
+    return encodeToFile(image, profile(use), path);
+}
+
+bool JpegCodec::encodeToFile(const cv::Mat& image, const JpegProfile& profile,
+                             const std::string& path) {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (!encodeScratch(image, profile, data, size)) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    bool ok = file.is_open() &&
+              file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    trimScratch();
+    if (!ok) {
+        std::cerr << "Failed to write JPEG: " << path << std::endl;
+    }
+    return ok;
+}
+
+cv::Mat JpegCodec::decode(const uint8_t* data, size_t size, int scaleDenom) {
+    if (!data || size == 0) {
+        return cv::Mat();
+    }
+    if (!validScale(scaleDenom)) {
+        scaleDenom = 1;
+    }
+
+#ifdef PHOTOBOOTH_HAVE_TURBOJPEG
+    ThreadCodec& codec = threadCodec();
+    if (!codec.decompressor) {
+        codec.decompressor = tjInitDecompress();
+    }
+
+    int width = 0, height = 0, subsampling = 0, colorspace = 0;
+    if (codec.decompressor &&
+        tjDecompressHeader3(codec.decompressor, data, static_cast<unsigned long>(size),
+                            &width, &height, &subsampling, &colorspace) == 0) {
+        // Same rounding as TJSCALED, so TurboJPEG picks exactly 1/scaleDenom
+        int scaledWidth = (width + scaleDenom - 1) / scaleDenom;
+        int scaledHeight = (height + scaleDenom - 1) / scaleDenom;
+        cv::Mat image(scaledHeight, scaledWidth, CV_8UC3);
+
+        int result = tjDecompress2(codec.decompressor, data, static_cast<unsigned long>(size),
+                                   image.data, scaledWidth, static_cast<int>(image.step),
+                                   scaledHeight, TJPF_BGR, 0);
+        // Warnings (e.g. a truncated file) still leave a usable image
+        if (result == 0 || tjGetErrorCode(codec.decompressor) == TJERR_WARNING) {
+            return applyOrientation(image, readExifOrientation(data, size));
+        }
+        std::cerr << "TurboJPEG decode failed: " << tjGetErrorStr2(codec.decompressor)
+                  << std::endl;
+        return cv::Mat();
+    }
+#endif
+
+    int flag = cv::IMREAD_COLOR;
+    switch (scaleDenom) {
+    case 2: flag = cv::IMREAD_REDUCED_COLOR_2; break;
+    case 4: flag = cv::IMREAD_REDUCED_COLOR_4; break;
+    case 8: flag = cv::IMREAD_REDUCED_COLOR_8; break;
+    default: break;
+    }
+
+    cv::Mat buffer(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data));
+    return cv::imdecode(buffer, flag);
+}
+
+cv::Mat JpegCodec::decode(const std::vector<uint8_t>& data, int scaleDenom) {
+    return decode(data.data(), data.size(), scaleDenom);
+}
+
+cv::Mat JpegCodec::decodeFile(const std::string& path, int scaleDenom) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return cv::Mat();
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    return decode(data, scaleDenom);
+}
+
+int JpegCodec::readExifOrientation(const uint8_t* data, size_t size) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return 1;
+    }
+
+    // Walk the markers before the image data looking for APP1 "Exif"
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xDA || marker == 0xD9) {
+            break;
+        }
+        size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > size) {
+            break;
+        }
+
+        const uint8_t* segment = data + pos + 4;
+        size_t segmentSize = length - 2;
+        if (marker == 0xE1 && segmentSize >= 14 &&
+            std::equal(segment, segment + 6, "Exif\0\0")) {
+            const uint8_t* tiff = segment + 6;
+            size_t tiffSize = segmentSize - 6;
+            bool little = tiff[0] == 'I' && tiff[1] == 'I';
+            if (!little && !(tiff[0] == 'M' && tiff[1] == 'M')) {
+                return 1;
+            }
+
+            auto read16 = [&](size_t at) -> uint32_t {
+                return little ? (tiff[at] | (tiff[at + 1] << 8))
+                              : ((tiff[at] << 8) | tiff[at + 1]);
+            };
+            auto read32 = [&](size_t at) -> uint32_t {
+                return little ? (read16(at) | (read16(at + 2) << 16))
+                              : ((read16(at) << 16) | read16(at + 2));
+            };
+
+            // IFD0 entries are 12 bytes: tag, type, count, value
+            size_t ifd = read32(4);
+            if (ifd + 2 > tiffSize) {
+                return 1;
+            }
+            uint32_t entries = read16(ifd);
+            for (uint32_t i = 0; i < entries; ++i) {
+                size_t entry = ifd + 2 + i * 12;
+                if (entry + 12 > tiffSize) {
+                    break;
+                }
+                if (read16(entry) == 0x0112) {
+                    uint32_t orientation = read16(entry + 8);
+                    return orientation >= 1 && orientation <= 8 ? static_cast<int>(orientation) : 1;
+                }
+            }
+            return 1;
+        }
+        pos += 2 + length;
+    }
+    return 1;
+}
+
+} // namespace photobooth
@@ -0,0 +1,158 @@
+#include "image/LayoutAnalysisCache.h"
+#include "storage/FileManager.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace photobooth {
+
+namespace {
+
+// 64-bit FNV-1a; collisions are also guarded by the byte size in the key
+uint64_t contentHash(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+LayoutAnalysisCache& LayoutAnalysisCache::getInstance() {
+    static LayoutAnalysisCache instance;
+    return instance;
+}
+
+LayoutAnalysisCache::LayoutAnalysisCache() {
+    FileManager fm;
+    directory_ = fm.getBaseDirectory() + "/cache/layout_analysis";
+}
+
+void LayoutAnalysisCache::setDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    entries_.clear();
+}
+
+std::string LayoutAnalysisCache::makeKey(const uint8_t* data, size_t size,
+                                         const LayoutAnalyzer& analyzer) {
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << contentHash(data, size)
+        << std::dec << "_" << size
+        << "_a" << analyzer.getMinSlotArea()
+        << "_t" << static_cast<int>(analyzer.getAlphaThreshold())
+        << "_m" << analyzer.getMergeDistance();
+    return key.str();
+}
+
+std::string LayoutAnalysisCache::entryPath(const std::string& key) const {
+    return directory_ + "/" + key + ".json";
+}
+
+bool LayoutAnalysisCache::lookup(const std::string& key, std::vector<SlotInfo>& slots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        slots = it->second;
+        return true;
+    }
+
+    std::ifstream file(entryPath(key));
+    if (!file.is_open()) {
+        return false;
+    }
+
+    try {
+        json entry = json::parse(file);
+        std::vector<SlotInfo> loaded;
+        for (const auto& slot : entry.at("slots")) {
+            SlotInfo si;
+            si.id = slot.at("id");
+            si.x = slot.at("x");
+            si.y = slot.at("y");
+            si.width = slot.at("width");
+            si.height = slot.at("height");
+            loaded.push_back(si);
+        }
+        entries_[key] = loaded;
+        slots = loaded;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring bad layout analysis cache entry " << key
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void LayoutAnalysisCache::store(const std::string& key, const std::vector<SlotInfo>& slots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[key] = slots;
+
+    json entry;
+    entry["slots"] = json::array();
+    for (const auto& slot : slots) {
+        entry["slots"].push_back({
+            {"id", slot.id},
+            {"x", slot.x},
+            {"y", slot.y},
+            {"width", slot.width},
+            {"height", slot.height}
+        });
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+
+    // Write then rename, so a crash never leaves a truncated entry behind
+    std::string path = entryPath(key);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write layout analysis cache: " << tempPath << std::endl;
+            return;
+        }
+        file << entry.dump();
+    }
+    std::remove(path.c_str());
+    std::rename(tempPath.c_str(), path.c_str());
+}
+
+std::vector<SlotInfo> LayoutAnalysisCache::analyze(const std::vector<uint8_t>& pngData,
+                                                   LayoutAnalyzer& analyzer) {
+    std::string key = makeKey(pngData.data(), pngData.size(), analyzer);
+
+    std::vector<SlotInfo> slots;
+    if (lookup(key, slots)) {
+        return slots;
+    }
+
+    slots = analyzer.analyzePNG(pngData);
+    store(key, slots);
+    return slots;
+}
+
+std::vector<SlotInfo> LayoutAnalysisCache::analyze(const std::string& pngPath,
+                                                   LayoutAnalyzer& analyzer) {
+    std::ifstream file(pngPath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to load PNG: " << pngPath << std::endl;
+        return {};
+    }
+
+    std::vector<uint8_t> pngData((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+    return analyze(pngData, analyzer);
+}
+
+} // namespace photobooth
@@ -1,7 +1,11 @@
 #include "image/LayoutAnalyzer.h"
+#include "image/CompositeRenderer.h"
+#include "image/JpegCodec.h"
+#include "image/LayoutAssetCache.h"
+#include "image/PhotoDecodeCache.h"
 #include <opencv2/opencv.hpp>
 #include <algorithm>
-#include <queue>
+#include <cmath>
 #include <iostream>
 
 namespace photobooth {
@@ -31,57 +35,24 @@ bool LayoutAnalyzer::getImageDimensions(const std::string& pngPath, int& width,
 std::vector<SlotInfo> LayoutAnalyzer::analyzePNG(const std::string& pngPath) {
     std::vector<SlotInfo> slots;
 
-    // Load PNG with alpha channel
-    cv::Mat img = cv::imread(pngPath, cv::IMREAD_UNCHANGED);
-    if (img.empty()) {
+    // Stream the PNG and label transparent regions row by row
+    TransparencyScan scan = scanTransparency(pngPath, alphaThreshold_);
+    if (!scan.loaded) {
         std::cerr << "Failed to load PNG: " << pngPath << std::endl;
         return slots;
     }
 
     // Check if image has alpha channel
-    if (img.channels() != 4) {
+    if (!scan.hasAlpha) {
         std::cerr << "PNG does not have alpha channel: " << pngPath << std::endl;
         return slots;
     }
 
-    int width = img.cols;
-    int height = img.rows;
-
-    // Extract alpha channel
-    std::vector<cv::Mat> channels;
-    cv::split(img, channels);
-    cv::Mat alpha = channels[3];
-
-    // Find transparent regions
-    std::vector<BoundingBox> regions = findTransparentRegions(
-        alpha.data, width, height);
-
-    // Merge overlapping boxes
-    regions = mergeOverlappingBoxes(regions);
-
-    // Sort by position (top to bottom, left to right)
-    std::sort(regions.begin(), regions.end(), [](const BoundingBox& a, const BoundingBox& b) {
-        if (abs(a.y - b.y) < 50) {
-            return a.x < b.x;
-        }
-        return a.y < b.y;
-    });
-
-    // Convert to SlotInfo
-    int id = 1;
-    for (const auto& box : regions) {
-        if (box.area >= minSlotArea_) {
-            SlotInfo slot;
-            slot.id = id++;
-            slot.x = box.x;
-            slot.y = box.y;
-            slot.width = box.width;
-            slot.height = box.height;
-            slots.push_back(slot);
+    slots = slotsFromRegions(scan.regions);
 
-            std::cout << "Slot " << slot.id << ": x=" << slot.x << " y=" << slot.y
-                      << " w=" << slot.width << " h=" << slot.height << std::endl;
-        }
+    for (const auto& slot : slots) {
+        std::cout << "Slot " << slot.id << ": x=" << slot.x << " y=" << slot.y
+                  << " w=" << slot.width << " h=" << slot.height << std::endl;
     }
 
     std::cout << "Found " << slots.size() << " slots in layout" << std::endl;
@@ -91,36 +62,53 @@ std::vector<SlotInfo> LayoutAnalyzer::analyzePNG(const std::string& pngPath) {
 std::vector<SlotInfo> LayoutAnalyzer::analyzePNG(const std::vector<uint8_t>& pngData) {
     std::vector<SlotInfo> slots;
 
-    // Decode PNG from memory
-    cv::Mat img = cv::imdecode(pngData, cv::IMREAD_UNCHANGED);
-    if (img.empty()) {
+    TransparencyScan scan = scanTransparency(pngData.data(), pngData.size(), alphaThreshold_);
+    if (!scan.loaded) {
         std::cerr << "Failed to decode PNG from memory" << std::endl;
         return slots;
     }
 
-    if (img.channels() != 4) {
+    if (!scan.hasAlpha) {
         std::cerr << "PNG does not have alpha channel" << std::endl;
         return slots;
     }
 
-    int width = img.cols;
-    int height = img.rows;
+    return slotsFromRegions(scan.regions);
+}
 
-    std::vector<cv::Mat> channels;
-    cv::split(img, channels);
-    cv::Mat alpha = channels[3];
+std::vector<SlotInfo> LayoutAnalyzer::analyzeAlpha(const uint8_t* alpha, int width, int height) {
+    RegionLabeler labeler(alphaThreshold_);
+    for (int y = 0; y < height; y++) {
+        labeler.addRow(alpha + static_cast<size_t>(y) * width, width);
+    }
+    return slotsFromRegions(labeler.finish());
+}
 
-    std::vector<BoundingBox> regions = findTransparentRegions(
-        alpha.data, width, height);
-    regions = mergeOverlappingBoxes(regions);
+std::vector<SlotInfo> LayoutAnalyzer::slotsFromRegions(const std::vector<BoundingBox>& regions) {
+    std::vector<SlotInfo> slots;
 
-    std::sort(regions.begin(), regions.end(), [](const BoundingBox& a, const BoundingBox& b) {
-        if (abs(a.y - b.y) < 50) return a.x < b.x;
+    // Drop specks before merging
+    std::vector<BoundingBox> boxes;
+    for (const auto& box : regions) {
+        if (box.area >= minSlotArea_) {
+            boxes.push_back(box);
+        }
+    }
+
+    // Merge overlapping boxes
+    boxes = mergeOverlappingBoxes(boxes);
+
+    // Sort by position (top to bottom, left to right)
+    std::sort(boxes.begin(), boxes.end(), [](const BoundingBox& a, const BoundingBox& b) {
+        if (abs(a.y - b.y) < 50) {
+            return a.x < b.x;
+        }
         return a.y < b.y;
     });
 
+    // Convert to SlotInfo
     int id = 1;
-    for (const auto& box : regions) {
+    for (const auto& box : boxes) {
         if (box.area >= minSlotArea_) {
             SlotInfo slot;
             slot.id = id++;
@@ -135,149 +123,59 @@ std::vector<SlotInfo> LayoutAnalyzer::analyzePNG(const std::vector<uint8_t>& png
     return slots;
 }
 
-LayoutConfig LayoutAnalyzer::analyzeLayout(const std::string& pngPath, const std::string& layoutName) {
-    LayoutConfig config;
-    config.layoutName = layoutName;
-    config.layoutPath = pngPath;
-    config.slots = analyzePNG(pngPath);
-    config.slotsCount = static_cast<int>(config.slots.size());
-    return config;
-}
+SpanIndex LayoutAnalyzer::buildSpanIndex(const uint8_t* alpha, int width, int height) {
+    SpanIndex index;
+    index.width = width;
+    index.height = height;
+    index.rowStart.reserve(height + 1);
 
-std::vector<BoundingBox> LayoutAnalyzer::findTransparentRegions(
-    const uint8_t* alphaChannel, int width, int height) {
-
-    std::vector<BoundingBox> boxes;
-    std::vector<uint8_t> visited(width * height, 0);
+    auto classify = [this](uint8_t a) {
+        if (a <= alphaThreshold_) return SpanKind::Transparent;
+        if (a == 255) return SpanKind::Opaque;
+        return SpanKind::Partial;
+    };
 
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int idx = y * width + x;
-
-            // Skip if already visited or not transparent
-            if (visited[idx] || alphaChannel[idx] > alphaThreshold_) {
-                continue;
-            }
-
-            // Found a transparent pixel - flood fill to find bounds
-            int minX = x, maxX = x, minY = y, maxY = y;
-            floodFillMask(alphaChannel, visited.data(), width, height,
-                         x, y, minX, maxX, minY, maxY);
-
-            int boxWidth = maxX - minX + 1;
-            int boxHeight = maxY - minY + 1;
-            int area = boxWidth * boxHeight;
-
-            if (area >= minSlotArea_) {
-                BoundingBox box;
-                box.x = minX;
-                box.y = minY;
-                box.width = boxWidth;
-                box.height = boxHeight;
-                box.area = area;
-                boxes.push_back(box);
+        index.rowStart.push_back(static_cast<uint32_t>(index.spans.size()));
+
+        const uint8_t* row = alpha + static_cast<size_t>(y) * width;
+        int x = 0;
+        while (x < width) {
+            SpanKind kind = classify(row[x]);
+            int start = x;
+            while (x < width && classify(row[x]) == kind) {
+                x++;
             }
+            index.spans.push_back({start, x - start, kind});
         }
     }
+    index.rowStart.push_back(static_cast<uint32_t>(index.spans.size()));
 
-    return boxes;
+    return index;
 }
 
-void LayoutAnalyzer::floodFillMask(
-    const uint8_t* alpha, uint8_t* visited,
-    int width, int height,
-    int startX, int startY,
-    int& minX, int& maxX, int& minY, int& maxY) {
-
-    std::queue<std::pair<int, int>> queue;
-    queue.push({startX, startY});
-
-    const int dx[] = {-1, 0, 1, 0};
-    const int dy[] = {0, -1, 0, 1};
-
-    while (!queue.empty()) {
-        auto [x, y] = queue.front();
-        queue.pop();
-
-        if (x < 0 || x >= width || y < 0 || y >= height) continue;
-
-        int idx = y * width + x;
-        if (visited[idx] || alpha[idx] > alphaThreshold_) continue;
-
-        visited[idx] = 1;
-
-        minX = std::min(minX, x);
-        maxX = std::max(maxX, x);
-        minY = std::min(minY, y);
-        maxY = std::max(maxY, y);
-
-        for (int i = 0; i < 4; i++) {
-            queue.push({x + dx[i], y + dy[i]});
-        }
-    }
+LayoutConfig LayoutAnalyzer::analyzeLayout(const std::string& pngPath, const std::string& layoutName) {
+    LayoutConfig config;
+    config.layoutName = layoutName;
+    config.layoutPath = pngPath;
+    config.slots = analyzePNG(pngPath);
+    config.slotsCount = static_cast<int>(config.slots.size());
+    return config;
 }
 
 std::vector<BoundingBox> LayoutAnalyzer::mergeOverlappingBoxes(
     const std::vector<BoundingBox>& boxes) {
 
-    if (boxes.empty()) return boxes;
-
-    std::vector<BoundingBox> result = boxes;
-    bool merged = true;
-
-    while (merged) {
-        merged = false;
-        std::vector<BoundingBox> newResult;
-        std::vector<bool> used(result.size(), false);
-
-        for (size_t i = 0; i < result.size(); i++) {
-            if (used[i]) continue;
-
-            BoundingBox current = result[i];
-
-            for (size_t j = i + 1; j < result.size(); j++) {
-                if (used[j]) continue;
-
-                const BoundingBox& other = result[j];
-
-                // Check if boxes overlap or are close
-                int expandedX1 = current.x - mergeDistance_;
-                int expandedY1 = current.y - mergeDistance_;
-                int expandedX2 = current.x + current.width + mergeDistance_;
-                int expandedY2 = current.y + current.height + mergeDistance_;
-
-                int otherX2 = other.x + other.width;
-                int otherY2 = other.y + other.height;
-
-                bool overlaps =
-                    expandedX1 < otherX2 && expandedX2 > other.x &&
-                    expandedY1 < otherY2 && expandedY2 > other.y;
-
-                if (overlaps) {
-                    // Merge boxes
-                    int newX = std::min(current.x, other.x);
-                    int newY = std::min(current.y, other.y);
-                    int newX2 = std::max(current.x + current.width, otherX2);
-                    int newY2 = std::max(current.y + current.height, otherY2);
-
-                    current.x = newX;
-                    current.y = newY;
-                    current.width = newX2 - newX;
-                    current.height = newY2 - newY;
-                    current.area = current.width * current.height;
-
-                    used[j] = true;
-                    merged = true;
-                }
-            }
-
-            newResult.push_back(current);
-        }
-
-        result = newResult;
-    }
+    return mergeNearbyBoxes(boxes, mergeDistance_);
+}
 
-    return result;
+SlotInfo scaleSlot(const SlotInfo& slot, double scale) {
+    SlotInfo scaled = slot;
+    scaled.x = static_cast<int>(std::lround(slot.x * scale));
+    scaled.y = static_cast<int>(std::lround(slot.y * scale));
+    scaled.width = static_cast<int>(std::lround((slot.x + slot.width) * scale)) - scaled.x;
+    scaled.height = static_cast<int>(std::lround((slot.y + slot.height) * scale)) - scaled.y;
+    return scaled;
 }
 
 // ============== ImageCompositor ==============
@@ -301,75 +199,67 @@ bool ImageCompositor::compose(
     const LayoutConfig& config,
     std::vector<uint8_t>& output) {
 
-    // Load layout
-    cv::Mat layout = cv::imread(layoutPath, cv::IMREAD_UNCHANGED);
-    if (layout.empty()) {
-        std::cerr << "Failed to load layout: " << layoutPath << std::endl;
+    // Decoded and premultiplied once per layout version
+    auto layout = LayoutAssetCache::getInstance().get(layoutPath);
+    if (!layout) {
         return false;
     }
 
-    // Create output image (BGR without alpha for final JPEG)
-    cv::Mat result(layout.rows, layout.cols, CV_8UC3, cv::Scalar(255, 255, 255));
-
-    // Place photos in slots
-    size_t photoIndex = 0;
-    for (const auto& slot : config.slots) {
-        if (photoIndex >= photoData.size()) break;
-
-        // Decode photo
-        cv::Mat photo = cv::imdecode(photoData[photoIndex], cv::IMREAD_COLOR);
-        if (photo.empty()) {
-            photoIndex++;
-            continue;
-        }
-
-        // Resize photo to fit slot (center crop)
-        cv::Mat fitted = cv::Mat(slot.height, slot.width, CV_8UC3);
-        double scaleX = static_cast<double>(slot.width) / photo.cols;
-        double scaleY = static_cast<double>(slot.height) / photo.rows;
-        double scale = std::max(scaleX, scaleY);
+    // Decode at reduced scale and fit to slot (center crop, slot rotation)
+    cv::Mat result = renderComposite(*layout, config, photoData.size(),
+        [&](size_t index, const SlotInfo& slot) {
+            return PhotoDecodeCache::decodeFitted(photoData[index], slot.width, slot.height,
+                                                  slot.rotation);
+        });
 
-        int newWidth = static_cast<int>(photo.cols * scale);
-        int newHeight = static_cast<int>(photo.rows * scale);
-
-        cv::Mat resized;
-        cv::resize(photo, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR);
+    return JpegCodec::getInstance().encode(result, JpegUse::Print, output);
+}
 
-        // Center crop
-        int cropX = (newWidth - slot.width) / 2;
-        int cropY = (newHeight - slot.height) / 2;
-        cv::Rect cropRect(cropX, cropY, slot.width, slot.height);
-        fitted = resized(cropRect).clone();
+bool ImageCompositor::composeForPrint(
+    const std::string& layoutPath,
+    const std::vector<std::string>& photos,
+    const LayoutConfig& config,
+    const std::string& outputPath,
+    const PrintOptions& options) {
+
+    // Decoded at reduced scale, fitted and cached per slot size
+    return renderToFile(layoutPath, config, photos.size(),
+        [&](size_t index, const SlotInfo& slot) {
+            return PhotoDecodeCache::getInstance().getFitted(photos[index], slot.width,
+                                                                     slot.height, slot.rotation);
+        },
+        outputPath, options);
+}
 
-        // Place in result
-        cv::Rect slotRect(slot.x, slot.y, slot.width, slot.height);
-        fitted.copyTo(result(slotRect));
+bool ImageCompositor::composePreview(
+    const std::string& layoutPath,
+    const std::vector<std::string>& photos,
+    const LayoutConfig& config,
+    int maxWidth, int maxHeight,
+    std::vector<uint8_t>& output,
+    int quality) {
 
-        photoIndex++;
+    // Downscaled once per layout version and preview size
+    auto layout = LayoutAssetCache::getInstance().getScaled(layoutPath, maxWidth, maxHeight);
+    if (!layout) {
+        return false;
     }
 
-    // Overlay layout (only non-transparent pixels)
-    if (layout.channels() == 4) {
-        for (int y = 0; y < layout.rows; y++) {
-            for (int x = 0; x < layout.cols; x++) {
-                cv::Vec4b pixel = layout.at<cv::Vec4b>(y, x);
-                uint8_t alpha = pixel[3];
-                if (alpha > 10) {
-                    cv::Vec3b& dst = result.at<cv::Vec3b>(y, x);
-                    float a = alpha / 255.0f;
-                    dst[0] = static_cast<uint8_t>(pixel[0] * a + dst[0] * (1 - a));
-                    dst[1] = static_cast<uint8_t>(pixel[1] * a + dst[1] * (1 - a));
-                    dst[2] = static_cast<uint8_t>(pixel[2] * a + dst[2] * (1 - a));
-                }
-            }
-        }
+    LayoutConfig previewConfig = config;
+    for (auto& slot : previewConfig.slots) {
+        slot = scaleSlot(slot, layout->scale);
     }
 
-    // Encode to JPEG
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-    cv::imencode(".jpg", result, output, params);
+    // Fitted from the small preview decodes, which are warmed at capture time
+    cv::Mat result = renderComposite(*layout, previewConfig, photos.size(),
+        [&](size_t index, const SlotInfo& slot) {
+            cv::Mat source = PhotoDecodeCache::getInstance().getPreviewSource(photos[index]);
+            return PhotoDecodeCache::fitToSlot(source, slot.width, slot.height, slot.rotation);
+        });
 
-    return true;
+    JpegProfile profile = JpegCodec::getInstance().profile(JpegUse::Preview);
+    profile.quality = quality;
+    return JpegCodec::getInstance().encode(result, profile, output);
 }
 
 bool ImageCompositor::composeWithOpenCV(
@@ -378,114 +268,20 @@ bool ImageCompositor::composeWithOpenCV(
     const LayoutConfig& config,
     const std::string& outputPath) {
 
-    // Load layout with alpha
-    cv::Mat layout = cv::imread(layoutPath, cv::IMREAD_UNCHANGED);
-    if (layout.empty()) {
-        std::cerr << "Failed to load layout: " << layoutPath << std::endl;
-        return false;
-    }
-
-    // Create output image
-    cv::Mat result(layout.rows, layout.cols, CV_8UC3, cv::Scalar(255, 255, 255));
-
-    // Place photos in slots
-    size_t photoIndex = 0;
-    for (const auto& slot : config.slots) {
-        if (photoIndex >= photos.size()) break;
-
-        cv::Mat photo = cv::imread(photos[photoIndex], cv::IMREAD_COLOR);
-        if (photo.empty()) {
-            std::cerr << "Failed to load photo: " << photos[photoIndex] << std::endl;
-            photoIndex++;
-            continue;
-        }
-
-        // Calculate scale to cover slot (maintaining aspect ratio)
-        double scaleX = static_cast<double>(slot.width) / photo.cols;
-        double scaleY = static_cast<double>(slot.height) / photo.rows;
-        double scale = std::max(scaleX, scaleY);
-
-        int newWidth = static_cast<int>(photo.cols * scale);
-        int newHeight = static_cast<int>(photo.rows * scale);
-
-        cv::Mat resized;
-        cv::resize(photo, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR);
-
-        // Center crop to slot size
-        int cropX = (newWidth - slot.width) / 2;
-        int cropY = (newHeight - slot.height) / 2;
-        cropX = std::max(0, cropX);
-        cropY = std::max(0, cropY);
-
-        cv::Rect cropRect(cropX, cropY,
-                         std::min(slot.width, resized.cols - cropX),
-                         std::min(slot.height, resized.rows - cropY));
-        cv::Mat cropped = resized(cropRect);
-
-        // Copy to result at slot position
-        cv::Rect destRect(slot.x, slot.y, cropped.cols, cropped.rows);
-        cropped.copyTo(result(destRect));
-
-        photoIndex++;
-    }
-
-    // Overlay the layout PNG on top (preserving transparency)
-    if (layout.channels() == 4) {
-        std::vector<cv::Mat> channels;
-        cv::split(layout, channels);
-        cv::Mat alpha = channels[3];
-
-        // Convert layout to BGR for blending
-        cv::Mat layoutBGR;
-        cv::cvtColor(layout, layoutBGR, cv::COLOR_BGRA2BGR);
-
-        // Alpha blend
-        for (int y = 0; y < layout.rows && y < result.rows; y++) {
-            for (int x = 0; x < layout.cols && x < result.cols; x++) {
-                uint8_t a = alpha.at<uint8_t>(y, x);
-                if (a > 10) {
-                    float af = a / 255.0f;
-                    cv::Vec3b& dst = result.at<cv::Vec3b>(y, x);
-                    cv::Vec3b src = layoutBGR.at<cv::Vec3b>(y, x);
-                    dst[0] = static_cast<uint8_t>(src[0] * af + dst[0] * (1 - af));
-                    dst[1] = static_cast<uint8_t>(src[1] * af + dst[1] * (1 - af));
-                    dst[2] = static_cast<uint8_t>(src[2] * af + dst[2] * (1 - af));
-                }
-            }
-        }
-    }
-
-    // Save result
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-    return cv::imwrite(outputPath, result, params);
+    // Same pixels as the in-memory compose, but streamed to the file in bands
+    // instead of building the whole canvas
+    return composeForPrint(layoutPath, photos, config, outputPath, PrintOptions());
 }
 
 std::vector<uint8_t> ImageCompositor::fitImageToSlot(
     const std::vector<uint8_t>& imageData,
     int slotWidth, int slotHeight) {
 
-    cv::Mat img = cv::imdecode(imageData, cv::IMREAD_COLOR);
-    if (img.empty()) return {};
-
-    double scaleX = static_cast<double>(slotWidth) / img.cols;
-    double scaleY = static_cast<double>(slotHeight) / img.rows;
-    double scale = std::max(scaleX, scaleY);
-
-    int newWidth = static_cast<int>(img.cols * scale);
-    int newHeight = static_cast<int>(img.rows * scale);
-
-    cv::Mat resized;
-    cv::resize(img, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR);
-
-    int cropX = (newWidth - slotWidth) / 2;
-    int cropY = (newHeight - slotHeight) / 2;
-    cv::Rect cropRect(cropX, cropY, slotWidth, slotHeight);
-    cv::Mat cropped = resized(cropRect);
+    cv::Mat cropped = PhotoDecodeCache::decodeFitted(imageData, slotWidth, slotHeight);
+    if (cropped.empty()) return {};
 
     std::vector<uint8_t> output;
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-    cv::imencode(".jpg", cropped, output, params);
-
+    JpegCodec::getInstance().encode(cropped, JpegUse::Print, output);
     return output;
 }
 
@@ -493,7 +289,7 @@ std::vector<uint8_t> ImageCompositor::resizeImage(
     const std::vector<uint8_t>& imageData,
     int maxWidth, int maxHeight) {
 
-    cv::Mat img = cv::imdecode(imageData, cv::IMREAD_COLOR);
+    cv::Mat img = JpegCodec::getInstance().decode(imageData);
     if (img.empty()) return {};
 
     double scaleX = static_cast<double>(maxWidth) / img.cols;
@@ -511,9 +307,7 @@ std::vector<uint8_t> ImageCompositor::resizeImage(
     cv::resize(img, resized, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR);
 
     std::vector<uint8_t> output;
-    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 95};
-    cv::imencode(".jpg", resized, output, params);
-
+    JpegCodec::getInstance().encode(resized, JpegUse::Print, output);
     return output;
 }
 
@@ -0,0 +1,251 @@
+#include "image/LayoutAssetCache.h"
+#include "image/AlphaBlend.h"
+#include "image/LayoutAnalysisCache.h"
+#include <opencv2/opencv.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace photobooth {
+
+namespace {
+
+size_t assetBytes(const LayoutAsset& asset) {
+    return asset.overlay.total() * asset.overlay.elemSize() +
+           asset.alpha.total() * asset.alpha.elemSize() +
+           asset.spans.rowStart.size() * sizeof(uint32_t) +
+           asset.spans.spans.size() * sizeof(AlphaSpan);
+}
+
+} // namespace
+
+LayoutAssetCache& LayoutAssetCache::getInstance() {
+    static LayoutAssetCache instance;
+    return instance;
+}
+
+LayoutAssetCache::LayoutAssetCache()
+    : memoryUsage_(0)
+    , memoryLimit_(DEFAULT_MEMORY_LIMIT)
+{
+}
+
+bool LayoutAssetCache::statFile(const std::string& path, FileStamp& stamp) {
+    struct stat buffer;
+    if (stat(path.c_str(), &buffer) != 0) {
+        return false;
+    }
+    stamp.mtime = buffer.st_mtime;
+    stamp.size = static_cast<uint64_t>(buffer.st_size);
+    return true;
+}
+
+std::shared_ptr<LayoutAsset> LayoutAssetCache::load(const std::string& path) {
+    // Read the bytes once: they are both decoded and hashed for the analysis cache
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> pngData((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+
+    cv::Mat layout;
+    if (!pngData.empty()) {
+        layout = cv::imdecode(pngData, cv::IMREAD_UNCHANGED);
+    }
+    if (layout.empty()) {
+        std::cerr << "Failed to load layout: " << path << std::endl;
+        return nullptr;
+    }
+
+    auto asset = std::make_shared<LayoutAsset>();
+    asset->path = path;
+    asset->width = layout.cols;
+    asset->height = layout.rows;
+
+    if (layout.channels() == 4) {
+        cv::extractChannel(layout, asset->alpha, 3);
+        asset->overlay = blend::premultiply(layout);
+
+        LayoutAnalyzer analyzer;
+        auto& analysisCache = LayoutAnalysisCache::getInstance();
+        std::string key = LayoutAnalysisCache::makeKey(pngData.data(), pngData.size(), analyzer);
+        if (!analysisCache.lookup(key, asset->slots)) {
+            asset->slots = analyzer.analyzeAlpha(asset->alpha.data, asset->width, asset->height);
+            analysisCache.store(key, asset->slots);
+        }
+        asset->spans = analyzer.buildSpanIndex(asset->alpha.data, asset->width, asset->height);
+    }
+
+    asset->bytes = assetBytes(*asset);
+    return asset;
+}
+
+std::shared_ptr<LayoutAsset> LayoutAssetCache::downscale(const LayoutAsset& source, double scale) {
+    auto asset = std::make_shared<LayoutAsset>();
+    asset->path = source.path;
+    asset->scale = scale;
+    asset->width = std::max(1, static_cast<int>(std::lround(source.width * scale)));
+    asset->height = std::max(1, static_cast<int>(std::lround(source.height * scale)));
+
+    for (const auto& slot : source.slots) {
+        asset->slots.push_back(scaleSlot(slot, scale));
+    }
+
+    if (!source.overlay.empty()) {
+        // Area-averaging premultiplied pixels keeps edges free of dark fringes;
+        // the alpha plane is taken from the result so spans match the overlay
+        cv::resize(source.overlay, asset->overlay, cv::Size(asset->width, asset->height),
+                   0, 0, cv::INTER_AREA);
+        cv::extractChannel(asset->overlay, asset->alpha, 3);
+
+        LayoutAnalyzer analyzer;
+        asset->spans = analyzer.buildSpanIndex(asset->alpha.data, asset->width, asset->height);
+    }
+
+    asset->bytes = assetBytes(*asset);
+    return asset;
+}
+
+std::shared_ptr<const LayoutAsset> LayoutAssetCache::get(const std::string& layoutPath) {
+    FileStamp stamp;
+    if (!statFile(layoutPath, stamp)) {
+        std::cerr << "Layout not found: " << layoutPath << std::endl;
+        invalidate(layoutPath);
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(layoutPath);
+        if (it != entries_.end()) {
+            if (it->second.stamp == stamp) {
+                lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+                return it->second.asset;
+            }
+            // Layout was replaced on disk
+            eraseLocked(it);
+        }
+    }
+
+    // Decode outside the lock so other layouts stay available meanwhile
+    std::shared_ptr<const LayoutAsset> asset = load(layoutPath);
+    if (!asset) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(layoutPath);
+    if (it != entries_.end()) {
+        // Another caller loaded it first
+        if (it->second.stamp == stamp) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+            return it->second.asset;
+        }
+        eraseLocked(it);
+    }
+
+    lru_.push_front(layoutPath);
+    Entry& entry = entries_[layoutPath];
+    entry.stamp = stamp;
+    entry.asset = asset;
+    entry.bytes = asset->bytes;
+    entry.lruPos = lru_.begin();
+    memoryUsage_ += entry.bytes;
+
+    evictLocked();
+    return asset;
+}
+
+std::shared_ptr<const LayoutAsset> LayoutAssetCache::getScaled(const std::string& layoutPath,
+                                                                int maxWidth, int maxHeight) {
+    auto full = get(layoutPath);
+    if (!full || maxWidth <= 0 || maxHeight <= 0) {
+        return full;
+    }
+
+    double factor = std::min(static_cast<double>(maxWidth) / full->width,
+                             static_cast<double>(maxHeight) / full->height);
+    if (factor >= 1.0) {
+        return full;
+    }
+
+    std::pair<int, int> size(maxWidth, maxHeight);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(layoutPath);
+        if (it != entries_.end() && it->second.asset == full) {
+            auto scaledIt = it->second.scaled.find(size);
+            if (scaledIt != it->second.scaled.end()) {
+                return scaledIt->second;
+            }
+        }
+    }
+
+    std::shared_ptr<const LayoutAsset> scaled = downscale(*full, factor);
+
+    // Only attach it if the full asset is still the cached version
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(layoutPath);
+    if (it != entries_.end() && it->second.asset == full) {
+        auto inserted = it->second.scaled.emplace(size, scaled);
+        if (!inserted.second) {
+            return inserted.first->second;
+        }
+        it->second.bytes += scaled->bytes;
+        memoryUsage_ += scaled->bytes;
+        evictLocked();
+    }
+    return scaled;
+}
+
+void LayoutAssetCache::warm(const std::vector<std::string>& layoutPaths) {
+    for (const auto& path : layoutPaths) {
+        if (get(path)) {
+            std::cout << "Layout cached: " << path << std::endl;
+        }
+    }
+}
+
+void LayoutAssetCache::invalidate(const std::string& layoutPath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(layoutPath);
+    if (it != entries_.end()) {
+        eraseLocked(it);
+    }
+}
+
+void LayoutAssetCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    memoryUsage_ = 0;
+}
+
+void LayoutAssetCache::setMemoryLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memoryLimit_ = bytes;
+    evictLocked();
+}
+
+size_t LayoutAssetCache::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memoryUsage_;
+}
+
+void LayoutAssetCache::eraseLocked(std::map<std::string, Entry>::iterator it) {
+    memoryUsage_ -= it->second.bytes;
+    lru_.erase(it->second.lruPos);
+    entries_.erase(it);
+}
+
+void LayoutAssetCache::evictLocked() {
+    // Keep the most recent entry even if it alone exceeds the cap;
+    // in-flight composes hold their own reference either way
+    while (memoryUsage_ > memoryLimit_ && lru_.size() > 1) {
+        eraseLocked(entries_.find(lru_.back()));
+    }
+}
+
+} // namespace photobooth
@@ -0,0 +1,254 @@
+#include "image/PhotoDecodeCache.h"
+#include "image/JpegCodec.h"
+#include <opencv2/opencv.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <streambuf>
+#include <tuple>
+
+namespace photobooth {
+
+namespace {
+
+// Big-endian 16-bit field
+int readU16(std::istream& in) {
+    int high = in.get();
+    int low = in.get();
+    return (high << 8) | low;
+}
+
+// Read-only istream over a byte buffer
+struct MemoryBuffer : std::streambuf {
+    MemoryBuffer(const uint8_t* data, size_t size) {
+        char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(data));
+        setg(begin, begin, begin + size);
+    }
+};
+
+// Upright size a photo needs to cover width x height once turned by rotation
+cv::Size rotatedCover(int width, int height, int rotation) {
+    if (rotation % 180 == 0) {
+        return cv::Size(width, height);
+    }
+    if (rotation % 90 == 0) {
+        return cv::Size(height, width);
+    }
+    double radians = rotation * CV_PI / 180.0;
+    double c = std::abs(std::cos(radians));
+    double s = std::abs(std::sin(radians));
+    return cv::Size(static_cast<int>(std::ceil(width * c + height * s)),
+                    static_cast<int>(std::ceil(width * s + height * c)));
+}
+
+// Decode at the smallest JPEG scale that still covers width x height
+cv::Mat decodeReduced(const std::vector<uint8_t>& data, int width, int height) {
+    int scaleDenom = 1;
+    MemoryBuffer buffer(data.data(), data.size());
+    std::istream in(&buffer);
+    int srcWidth = 0, srcHeight = 0;
+    if (PhotoDecodeCache::readJpegSize(in, srcWidth, srcHeight)) {
+        scaleDenom = PhotoDecodeCache::reducedScale(srcWidth, srcHeight, width, height);
+    }
+
+    return JpegCodec::getInstance().decode(data, scaleDenom);
+}
+
+cv::Mat decodeReduced(const std::string& path, int width, int height) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return cv::Mat();
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    return decodeReduced(data, width, height);
+}
+
+} // namespace
+
+bool PhotoDecodeCache::Key::operator<(const Key& other) const {
+    return std::tie(path, mtime, size, width, height, rotation, fitted) <
+           std::tie(other.path, other.mtime, other.size, other.width, other.height,
+                    other.rotation, other.fitted);
+}
+
+PhotoDecodeCache& PhotoDecodeCache::getInstance() {
+    static PhotoDecodeCache instance;
+    return instance;
+}
+
+PhotoDecodeCache::PhotoDecodeCache()
+    : memoryUsage_(0)
+    , memoryLimit_(DEFAULT_MEMORY_LIMIT)
+{
+}
+
+bool PhotoDecodeCache::readJpegSize(std::istream& in, int& width, int& height) {
+    if (in.get() != 0xFF || in.get() != 0xD8) {
+        return false;
+    }
+
+    while (in) {
+        // Markers may be preceded by any number of 0xFF fill bytes
+        int marker = in.get();
+        if (marker != 0xFF) return false;
+        while (marker == 0xFF) marker = in.get();
+        if (marker == EOF) return false;
+
+        // Standalone markers carry no length
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+        // Start of scan before any frame header
+        if (marker == 0xDA || marker == 0xD9) return false;
+
+        int length = readU16(in);
+        if (!in || length < 2) return false;
+
+        bool isFrameHeader = marker >= 0xC0 && marker <= 0xCF &&
+                             marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrameHeader) {
+            in.get(); // Sample precision
+            height = readU16(in);
+            width = readU16(in);
+            return in && width > 0 && height > 0;
+        }
+
+        in.ignore(length - 2);
+    }
+    return false;
+}
+
+int PhotoDecodeCache::reducedScale(int srcWidth, int srcHeight, int width, int height) {
+    // EXIF orientation isn't known from the frame header, so require the
+    // reduced image to cover the slot either way round
+    int shortSide = std::min(srcWidth, srcHeight);
+    int longSlot = std::max(width, height);
+
+    if ((shortSide + 7) / 8 >= longSlot) return 8;
+    if ((shortSide + 3) / 4 >= longSlot) return 4;
+    if ((shortSide + 1) / 2 >= longSlot) return 2;
+    return 1;
+}
+
+cv::Mat PhotoDecodeCache::fitToSlot(const cv::Mat& photo, int width, int height, int rotation) {
+    if (photo.empty() || width <= 0 || height <= 0) {
+        return cv::Mat();
+    }
+
+    rotation %= 360;
+    if (rotation < 0) {
+        rotation += 360;
+    }
+
+    // Scale to cover the slot (maintaining aspect ratio)
+    cv::Size cover = rotatedCover(width, height, rotation);
+    double scaleX = static_cast<double>(cover.width) / photo.cols;
+    double scaleY = static_cast<double>(cover.height) / photo.rows;
+    double scale = std::max(scaleX, scaleY);
+
+    cv::Mat fitted;
+    if (rotation == 0) {
+        // Center crop in source pixels, then resize just that window
+        int cropWidth = std::min(photo.cols, std::max(1, static_cast<int>(std::lround(width / scale))));
+        int cropHeight = std::min(photo.rows, std::max(1, static_cast<int>(std::lround(height / scale))));
+        cv::Rect crop((photo.cols - cropWidth) / 2, (photo.rows - cropHeight) / 2,
+                      cropWidth, cropHeight);
+        cv::resize(photo(crop), fitted, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+        return fitted;
+    }
+
+    // Map the photo center onto the slot center, scaled and turned about it.
+    // warpAffine only samples the source under the slot.
+    cv::Point2f photoCenter(photo.cols * 0.5f - 0.5f, photo.rows * 0.5f - 0.5f);
+    cv::Mat transform = cv::getRotationMatrix2D(photoCenter, rotation, scale);
+    transform.at<double>(0, 2) += (width * 0.5 - 0.5) - photoCenter.x;
+    transform.at<double>(1, 2) += (height * 0.5 - 0.5) - photoCenter.y;
+
+    cv::warpAffine(photo, fitted, transform, cv::Size(width, height),
+                   cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    return fitted;
+}
+
+cv::Mat PhotoDecodeCache::decodeFitted(const std::vector<uint8_t>& data, int width, int height,
+                                       int rotation) {
+    cv::Size cover = rotatedCover(width, height, rotation);
+    return fitToSlot(decodeReduced(data, cover.width, cover.height), width, height, rotation);
+}
+
+cv::Mat PhotoDecodeCache::getFitted(const std::string& photoPath, int width, int height,
+                                    int rotation) {
+    return getCached(photoPath, width, height, rotation, true);
+}
+
+cv::Mat PhotoDecodeCache::getPreviewSource(const std::string& photoPath) {
+    return getCached(photoPath, PREVIEW_SOURCE_SIZE, PREVIEW_SOURCE_SIZE, 0, false);
+}
+
+cv::Mat PhotoDecodeCache::getCached(const std::string& photoPath, int width, int height,
+                                    int rotation, bool fit) {
+    struct stat buffer;
+    if (stat(photoPath.c_str(), &buffer) != 0) {
+        std::cerr << "Failed to load photo: " << photoPath << std::endl;
+        return cv::Mat();
+    }
+
+    Key key{photoPath, buffer.st_mtime, static_cast<uint64_t>(buffer.st_size),
+            width, height, rotation, fit};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+            return it->second.image;
+        }
+    }
+
+    cv::Size cover = fit ? rotatedCover(width, height, rotation) : cv::Size(width, height);
+    cv::Mat image = decodeReduced(photoPath, cover.width, cover.height);
+    if (fit) {
+        image = fitToSlot(image, width, height, rotation);
+    }
+    if (image.empty()) {
+        std::cerr << "Failed to load photo: " << photoPath << std::endl;
+        return image;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(key) == 0) {
+        lru_.push_front(key);
+        Entry& entry = entries_[key];
+        entry.image = image;
+        entry.bytes = image.total() * image.elemSize();
+        entry.lruPos = lru_.begin();
+        memoryUsage_ += entry.bytes;
+        evictLocked();
+    }
+    return image;
+}
+
+void PhotoDecodeCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    memoryUsage_ = 0;
+}
+
+void PhotoDecodeCache::setMemoryLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memoryLimit_ = bytes;
+    evictLocked();
+}
+
+void PhotoDecodeCache::evictLocked() {
+    while (memoryUsage_ > memoryLimit_ && !lru_.empty()) {
+        auto it = entries_.find(lru_.back());
+        memoryUsage_ -= it->second.bytes;
+        entries_.erase(it);
+        lru_.pop_back();
+    }
+}
+
+} // namespace photobooth
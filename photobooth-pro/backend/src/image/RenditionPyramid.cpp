@@ -0,0 +1,159 @@
+#include "image/RenditionPyramid.h"
+#include "image/JpegCodec.h"
+#include "core/WorkerPool.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+
+namespace photobooth {
+
+namespace {
+
+constexpr int DEFAULT_WEBP_QUALITY = 80;
+
+std::string lowerExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return "";
+    }
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+} // namespace
+
+RenditionPyramid::RenditionPyramid(const std::vector<Rendition>& renditions,
+                                   int width, int height, int bandRows)
+    : renditions_(renditions)
+    , height_(height)
+    , factor_(1)
+    , rowsAdded_(0)
+{
+    if (renditions_.empty() || width <= 0 || height <= 0) {
+        renditions_.clear();
+        return;
+    }
+
+    int largestWidth = 0, largestHeight = 0;
+    for (const auto& rendition : renditions_) {
+        double scale = 1.0;
+        if (rendition.maxWidth > 0) {
+            scale = std::min(scale, static_cast<double>(rendition.maxWidth) / width);
+        }
+        if (rendition.maxHeight > 0) {
+            scale = std::min(scale, static_cast<double>(rendition.maxHeight) / height);
+        }
+        cv::Size size(std::max(1, static_cast<int>(std::lround(width * scale))),
+                      std::max(1, static_cast<int>(std::lround(height * scale))));
+        sizes_.push_back(size);
+        largestWidth = std::max(largestWidth, size.width);
+        largestHeight = std::max(largestHeight, size.height);
+    }
+
+    // Largest power of two that keeps the base above every rendition and
+    // divides the band height, so bands land on whole base rows
+    int limit = bandRows & -bandRows;
+    while (factor_ * 2 <= limit &&
+           width / (factor_ * 2) >= largestWidth &&
+           height / (factor_ * 2) >= largestHeight) {
+        factor_ *= 2;
+    }
+
+    base_.create((height + factor_ - 1) / factor_, (width + factor_ - 1) / factor_, CV_8UC3);
+}
+
+void RenditionPyramid::addRows(const cv::Mat& band) {
+    if (renditions_.empty() || rowsAdded_ >= height_) {
+        return;
+    }
+
+    int baseTop = rowsAdded_ / factor_;
+    int baseRows = std::min((band.rows + factor_ - 1) / factor_, base_.rows - baseTop);
+    rowsAdded_ += band.rows;
+    if (baseRows <= 0) {
+        return;
+    }
+
+    cv::Mat dst = base_.rowRange(baseTop, baseTop + baseRows);
+    if (factor_ == 1) {
+        band.copyTo(dst);
+    } else {
+        // Same size and type as dst, so resize writes straight into the base
+        cv::resize(band, dst, dst.size(), 0, 0, cv::INTER_AREA);
+    }
+}
+
+bool RenditionPyramid::finish() {
+    if (renditions_.empty()) {
+        return true;
+    }
+
+    // Halve while some rendition still fits in the next level
+    std::vector<cv::Mat> levels = {base_};
+    while (true) {
+        cv::Size next(levels.back().cols / 2, levels.back().rows / 2);
+        bool needed = std::any_of(sizes_.begin(), sizes_.end(), [&](const cv::Size& size) {
+            return size.width <= next.width && size.height <= next.height;
+        });
+        if (!needed) {
+            break;
+        }
+        cv::Mat half;
+        cv::resize(levels.back(), half, next, 0, 0, cv::INTER_AREA);
+        levels.push_back(half);
+    }
+
+    std::vector<char> written(renditions_.size(), 0);
+    WorkerPool::getInstance().parallelFor(renditions_.size(), [&](size_t i) {
+        const cv::Size& size = sizes_[i];
+
+        // Smallest level that still covers the rendition
+        const cv::Mat* source = &levels.front();
+        for (const auto& level : levels) {
+            if (level.cols >= size.width && level.rows >= size.height) {
+                source = &level;
+            }
+        }
+
+        cv::Mat image = *source;
+        if (image.size() != size) {
+            cv::resize(*source, image, size, 0, 0, cv::INTER_AREA);
+        }
+        written[i] = write(image, renditions_[i]);
+    });
+
+    base_.release();
+    return std::all_of(written.begin(), written.end(), [](char ok) { return ok != 0; });
+}
+
+bool RenditionPyramid::write(const cv::Mat& image, const Rendition& rendition) {
+    std::string ext = lowerExtension(rendition.path);
+
+    bool ok;
+    if (ext == ".jpg" || ext == ".jpeg") {
+        JpegProfile profile = JpegCodec::getInstance().profile(JpegUse::Share);
+        if (rendition.quality > 0) {
+            // An explicit quality replaces the share size cap
+            profile.quality = rendition.quality;
+            profile.maxBytes = 0;
+        }
+        ok = JpegCodec::getInstance().encodeToFile(image, profile, rendition.path);
+    } else if (ext == ".webp") {
+        int quality = rendition.quality > 0 ? rendition.quality : DEFAULT_WEBP_QUALITY;
+        std::vector<int> params = {cv::IMWRITE_WEBP_QUALITY, quality};
+        ok = cv::imwrite(rendition.path, image, params);
+    } else {
+        ok = cv::imwrite(rendition.path, image);
+    }
+
+    if (!ok) {
+        std::cerr << "Failed to write rendition: " << rendition.path << std::endl;
+    }
+    return ok;
+}
+
+} // namespace photobooth
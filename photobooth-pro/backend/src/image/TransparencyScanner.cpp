@@ -0,0 +1,357 @@
+#include "image/TransparencyScanner.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef PHOTOBOOTH_HAVE_LIBPNG
+#include <png.h>
+#endif
+
+namespace photobooth {
+
+namespace {
+
+// Union-find over labels. Roots are always the smallest label, so
+// components come out in raster order of their first pixel.
+int findRoot(std::vector<int>& parent, int label) {
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+void unite(std::vector<int>& parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b) return;
+    if (a < b) parent[b] = a;
+    else parent[a] = b;
+}
+
+void extendBox(BoundingBox& box, int x0, int x1, int y0, int y1) {
+    int boxX1 = std::max(box.x + box.width, x1);
+    int boxY1 = std::max(box.y + box.height, y1);
+    box.x = std::min(box.x, x0);
+    box.y = std::min(box.y, y0);
+    box.width = boxX1 - box.x;
+    box.height = boxY1 - box.y;
+}
+
+// Fold each label's bounds into its root
+std::vector<BoundingBox> resolveBoxes(std::vector<int>& parent,
+                                      const std::vector<BoundingBox>& labelBoxes) {
+    std::vector<int> rootIndex(parent.size(), -1);
+    std::vector<BoundingBox> result;
+    for (size_t label = 0; label < parent.size(); label++) {
+        int root = findRoot(parent, static_cast<int>(label));
+        const BoundingBox& box = labelBoxes[label];
+        if (rootIndex[root] < 0) {
+            rootIndex[root] = static_cast<int>(result.size());
+            result.push_back(box);
+        } else {
+            extendBox(result[rootIndex[root]], box.x, box.x + box.width,
+                      box.y, box.y + box.height);
+        }
+    }
+
+    for (auto& box : result) {
+        box.area = box.width * box.height;
+    }
+    return result;
+}
+
+// Whole-image fallback: decode with OpenCV and label the alpha in place
+TransparencyScan scanDecoded(cv::Mat img, uint8_t alphaThreshold) {
+    TransparencyScan scan;
+    if (img.empty()) {
+        return scan;
+    }
+
+    scan.loaded = true;
+    scan.width = img.cols;
+    scan.height = img.rows;
+    if (img.channels() != 4) {
+        return scan;
+    }
+
+    if (img.depth() != CV_8U) {
+        img.convertTo(img, CV_8U, 1.0 / 257.0);
+    }
+
+    scan.hasAlpha = true;
+    RegionLabeler labeler(alphaThreshold);
+    for (int y = 0; y < img.rows; y++) {
+        labeler.addRow(img.ptr<uint8_t>(y) + 3, img.cols, 4);
+    }
+    scan.regions = labeler.finish();
+    return scan;
+}
+
+#ifdef PHOTOBOOTH_HAVE_LIBPNG
+
+enum class StreamResult {
+    Done,
+    Unsupported,    // Interlaced: rows only complete on the last pass
+    Error
+};
+
+struct MemorySource {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+};
+
+void readFromMemory(png_structp png, png_bytep out, png_size_t length) {
+    auto* source = static_cast<MemorySource*>(png_get_io_ptr(png));
+    if (source->size - source->offset < length) {
+        png_error(png, "Read past end of PNG data");
+    }
+    std::memcpy(out, source->data + source->offset, length);
+    source->offset += length;
+}
+
+void warnSilently(png_structp, png_const_charp) {}
+
+// Everything with a destructor lives in the caller, since libpng reports
+// errors with longjmp
+StreamResult streamRows(png_structp png, png_infop info, std::vector<uint8_t>& row,
+                        RegionLabeler& labeler, TransparencyScan& scan) {
+    if (setjmp(png_jmpbuf(png))) {
+        return StreamResult::Error;
+    }
+
+    png_read_info(png, info);
+
+    png_uint_32 width = png_get_image_width(png, info);
+    png_uint_32 height = png_get_image_height(png, info);
+    int colorType = png_get_color_type(png, info);
+    int bitDepth = png_get_bit_depth(png, info);
+    bool hasTrns = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+
+    scan.loaded = true;
+    scan.width = static_cast<int>(width);
+    scan.height = static_cast<int>(height);
+    scan.hasAlpha = (colorType & PNG_COLOR_MASK_ALPHA) != 0 || hasTrns;
+    if (!scan.hasAlpha) {
+        return StreamResult::Done;
+    }
+
+    if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) {
+        return StreamResult::Unsupported;
+    }
+
+    // Normalize every format to 8-bit RGBA
+    if (colorType == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+    if (hasTrns) png_set_tRNS_to_alpha(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) png_set_expand_gray_1_2_4_to_8(png);
+    if (bitDepth == 16) png_set_strip_16(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        png_set_gray_to_rgb(png);
+    }
+    png_read_update_info(png, info);
+
+    if (png_get_rowbytes(png, info) != static_cast<size_t>(width) * 4) {
+        return StreamResult::Unsupported;
+    }
+
+    row.resize(static_cast<size_t>(width) * 4);
+    for (png_uint_32 y = 0; y < height; y++) {
+        png_read_row(png, row.data(), nullptr);
+        labeler.addRow(row.data() + 3, static_cast<int>(width), 4);
+    }
+    return StreamResult::Done;
+}
+
+// source is either a FILE* (memory == nullptr) or a memory buffer
+StreamResult streamPng(FILE* file, MemorySource* memory, uint8_t alphaThreshold,
+                       TransparencyScan& scan) {
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                             warnSilently);
+    if (!png) {
+        return StreamResult::Error;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        return StreamResult::Error;
+    }
+
+    if (memory) {
+        png_set_read_fn(png, memory, readFromMemory);
+    } else {
+        png_init_io(png, file);
+    }
+
+    std::vector<uint8_t> row;
+    RegionLabeler labeler(alphaThreshold);
+    StreamResult result = streamRows(png, info, row, labeler, scan);
+    png_destroy_read_struct(&png, &info, nullptr);
+
+    if (result == StreamResult::Done && scan.hasAlpha) {
+        scan.regions = labeler.finish();
+    }
+    return result;
+}
+
+bool isPng(const uint8_t* data, size_t size) {
+    return size >= 8 && png_sig_cmp(data, 0, 8) == 0;
+}
+
+#endif // PHOTOBOOTH_HAVE_LIBPNG
+
+} // namespace
+
+// ============== RegionLabeler ==============
+
+RegionLabeler::RegionLabeler(uint8_t alphaThreshold)
+    : alphaThreshold_(alphaThreshold)
+    , row_(0)
+{
+}
+
+void RegionLabeler::addRow(const uint8_t* alpha, int width, int step) {
+    int y = row_++;
+    current_.clear();
+
+    size_t above = 0;
+    int x = 0;
+    while (x < width) {
+        if (alpha[x * step] > alphaThreshold_) {
+            x++;
+            continue;
+        }
+
+        Run run;
+        run.x0 = x;
+        while (x < width && alpha[x * step] <= alphaThreshold_) x++;
+        run.x1 = x;
+        run.label = -1;
+
+        // Runs above that end before this one can't touch later runs either
+        while (above < previous_.size() && previous_[above].x1 <= run.x0) above++;
+
+        for (size_t i = above; i < previous_.size() && previous_[i].x0 < run.x1; i++) {
+            if (run.label < 0) {
+                run.label = previous_[i].label;
+            } else {
+                unite(parent_, run.label, previous_[i].label);
+            }
+        }
+
+        if (run.label < 0) {
+            run.label = static_cast<int>(parent_.size());
+            parent_.push_back(run.label);
+            labelBoxes_.push_back({run.x0, y, run.x1 - run.x0, 1, 0});
+        } else {
+            extendBox(labelBoxes_[run.label], run.x0, run.x1, y, y + 1);
+        }
+
+        current_.push_back(run);
+    }
+
+    std::swap(previous_, current_);
+}
+
+std::vector<BoundingBox> RegionLabeler::finish() {
+    std::vector<BoundingBox> boxes = resolveBoxes(parent_, labelBoxes_);
+
+    row_ = 0;
+    parent_.clear();
+    labelBoxes_.clear();
+    previous_.clear();
+    current_.clear();
+    return boxes;
+}
+
+// ============== Box merge ==============
+
+std::vector<BoundingBox> mergeNearbyBoxes(const std::vector<BoundingBox>& boxes, int distance) {
+    std::vector<BoundingBox> result = boxes;
+    bool merged = !result.empty();
+
+    // Each pass is a sweep along x: a box is only compared with the boxes
+    // that start within its reach
+    while (merged) {
+        std::sort(result.begin(), result.end(), [](const BoundingBox& a, const BoundingBox& b) {
+            return a.x < b.x;
+        });
+
+        std::vector<int> parent(result.size());
+        for (size_t i = 0; i < parent.size(); i++) {
+            parent[i] = static_cast<int>(i);
+        }
+
+        merged = false;
+        for (size_t i = 0; i < result.size(); i++) {
+            const BoundingBox& current = result[i];
+            int reachX = current.x + current.width + distance;
+
+            // Sorted by x: once a box starts beyond reach, so do the rest
+            for (size_t j = i + 1; j < result.size() && result[j].x < reachX; j++) {
+                const BoundingBox& other = result[j];
+                bool overlapsY =
+                    current.y - distance < other.y + other.height &&
+                    current.y + current.height + distance > other.y;
+
+                if (overlapsY) {
+                    unite(parent, static_cast<int>(i), static_cast<int>(j));
+                    merged = true;
+                }
+            }
+        }
+
+        if (merged) {
+            result = resolveBoxes(parent, result);
+        }
+    }
+
+    return result;
+}
+
+// ============== PNG scanning ==============
+
+TransparencyScan scanTransparency(const std::string& pngPath, uint8_t alphaThreshold) {
+#ifdef PHOTOBOOTH_HAVE_LIBPNG
+    FILE* file = std::fopen(pngPath.c_str(), "rb");
+    if (!file) {
+        return TransparencyScan();
+    }
+
+    uint8_t signature[8];
+    bool png = std::fread(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+               isPng(signature, sizeof(signature));
+    if (png) {
+        std::rewind(file);
+        TransparencyScan scan;
+        StreamResult result = streamPng(file, nullptr, alphaThreshold, scan);
+        std::fclose(file);
+        if (result == StreamResult::Done) {
+            return scan;
+        }
+    } else {
+        std::fclose(file);
+    }
+#endif
+
+    return scanDecoded(cv::imread(pngPath, cv::IMREAD_UNCHANGED), alphaThreshold);
+}
+
+TransparencyScan scanTransparency(const uint8_t* pngData, size_t size, uint8_t alphaThreshold) {
+#ifdef PHOTOBOOTH_HAVE_LIBPNG
+    if (isPng(pngData, size)) {
+        MemorySource source{pngData, size, 0};
+        TransparencyScan scan;
+        if (streamPng(nullptr, &source, alphaThreshold, scan) == StreamResult::Done) {
+            return scan;
+        }
+    }
+#endif
+
+    cv::Mat buffer(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(pngData));
+    return scanDecoded(cv::imdecode(buffer, cv::IMREAD_UNCHANGED), alphaThreshold);
+}
+
+} // namespace photobooth
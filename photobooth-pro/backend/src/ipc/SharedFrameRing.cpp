@@ -0,0 +1,239 @@
+#include "ipc/SharedFrameRing.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace photobooth {
+namespace ipc {
+
+namespace {
+constexpr uint32_t RING_MAGIC = 0x474E4952; // "RING"
+
+size_t alignUp(size_t value) { return (value + 63) & ~size_t(63); }
+} // namespace
+
+SharedFrameRing::~SharedFrameRing() { close(); }
+
+size_t SharedFrameRing::totalSize(uint32_t slotCount, uint32_t slotSize) {
+  return alignUp(sizeof(RingHeader)) +
+         size_t(slotCount) * alignUp(sizeof(SlotHeader) + slotSize);
+}
+
+SharedFrameRing::SlotHeader *SharedFrameRing::slot(uint32_t index) const {
+  uint8_t *base = reinterpret_cast<uint8_t *>(header_);
+  size_t stride = alignUp(sizeof(SlotHeader) + header_->slotSize);
+  return reinterpret_cast<SlotHeader *>(base + alignUp(sizeof(RingHeader)) +
+                                        size_t(index) * stride);
+}
+
+uint8_t *SharedFrameRing::slotData(uint32_t index) const {
+  return reinterpret_cast<uint8_t *>(slot(index)) + sizeof(SlotHeader);
+}
+
+bool SharedFrameRing::map(size_t size, bool create) {
+#ifdef _WIN32
+  std::string mappingName = "Local\\" + name_;
+  if (create) {
+    mapping_ = CreateFileMappingA(
+        INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        static_cast<DWORD>(uint64_t(size) >> 32),
+        static_cast<DWORD>(size & 0xFFFFFFFF), mappingName.c_str());
+  } else {
+    mapping_ = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+  }
+  if (!mapping_)
+    return false;
+
+  void *view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (!view) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+    return false;
+  }
+#else
+  std::string shmName = "/" + name_;
+  if (create) {
+    fd_ = shm_open(shmName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd_ >= 0 && ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      ::close(fd_);
+      shm_unlink(shmName.c_str());
+      fd_ = -1;
+    }
+  } else {
+    fd_ = shm_open(shmName.c_str(), O_RDWR, 0600);
+  }
+  if (fd_ < 0)
+    return false;
+
+  if (size == 0) {
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      ::close(fd_);
+      fd_ = -1;
+      return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+  }
+
+  void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (view == MAP_FAILED) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+#endif
+
+  header_ = static_cast<RingHeader *>(view);
+  mappingSize_ = size;
+  return true;
+}
+
+bool SharedFrameRing::create(const std::string &name, uint32_t slotCount,
+                             uint32_t slotSize) {
+  close();
+  if (slotCount == 0 || slotSize == 0)
+    return false;
+
+  name_ = name;
+  owner_ = true;
+  if (!map(totalSize(slotCount, slotSize), true)) {
+    std::cerr << "Failed to create shared frame ring: " << name << std::endl;
+    close();
+    return false;
+  }
+
+  header_->magic = RING_MAGIC;
+  header_->slotCount = slotCount;
+  header_->slotSize = slotSize;
+  header_->reserved = 0;
+  header_->writeSequence.store(0, std::memory_order_release);
+  for (uint32_t i = 0; i < slotCount; i++) {
+    SlotHeader *s = slot(i);
+    s->guard.store(0, std::memory_order_relaxed);
+    s->sequence = 0;
+    s->length = 0;
+    s->bodyID = 0;
+  }
+  return true;
+}
+
+bool SharedFrameRing::open(const std::string &name) {
+  close();
+  name_ = name;
+  owner_ = false;
+
+  // Size 0 maps whatever the owner created
+  if (!map(0, false)) {
+    std::cerr << "Failed to open shared frame ring: " << name << std::endl;
+    close();
+    return false;
+  }
+
+  if (header_->magic != RING_MAGIC) {
+    std::cerr << "Shared frame ring has bad magic: " << name << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void SharedFrameRing::close() {
+#ifdef _WIN32
+  if (header_)
+    UnmapViewOfFile(header_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  mapping_ = nullptr;
+#else
+  if (header_)
+    munmap(header_, mappingSize_);
+  if (fd_ >= 0) {
+    ::close(fd_);
+    if (owner_)
+      shm_unlink(("/" + name_).c_str());
+  }
+  fd_ = -1;
+#endif
+  header_ = nullptr;
+  mappingSize_ = 0;
+  owner_ = false;
+}
+
+uint64_t SharedFrameRing::write(const uint8_t *data, uint32_t size,
+                                uint32_t bodyID) {
+  if (!header_ || size > header_->slotSize)
+    return 0;
+
+  uint64_t sequence =
+      header_->writeSequence.load(std::memory_order_relaxed) + 1;
+  uint32_t index = static_cast<uint32_t>(sequence % header_->slotCount);
+  SlotHeader *s = slot(index);
+
+  uint64_t guard = s->guard.load(std::memory_order_relaxed);
+  s->guard.store(guard + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(slotData(index), data, size);
+  s->length = size;
+  s->bodyID = bodyID;
+  s->sequence = sequence;
+
+  s->guard.store(guard + 2, std::memory_order_release);
+  header_->writeSequence.store(sequence, std::memory_order_release);
+  return sequence;
+}
+
+uint64_t SharedFrameRing::latestSequence() const {
+  if (!header_)
+    return 0;
+  return header_->writeSequence.load(std::memory_order_acquire);
+}
+
+bool SharedFrameRing::readLatest(std::vector<uint8_t> &data, uint32_t &bodyID,
+                                 uint64_t &sequence,
+                                 uint64_t afterSequence) const {
+  if (!header_)
+    return false;
+
+  // The producer can lap us while we copy; retry a few times from the newest
+  for (int attempt = 0; attempt < 4; attempt++) {
+    uint64_t latest = header_->writeSequence.load(std::memory_order_acquire);
+    if (latest == 0 || latest <= afterSequence)
+      return false;
+
+    uint32_t index = static_cast<uint32_t>(latest % header_->slotCount);
+    SlotHeader *s = slot(index);
+
+    uint64_t before = s->guard.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;
+
+    uint32_t length = s->length;
+    uint64_t slotSequence = s->sequence;
+    uint32_t slotBody = s->bodyID;
+    if (length > header_->slotSize)
+      continue;
+    data.resize(length);
+    std::memcpy(data.data(), slotData(index), length);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->guard.load(std::memory_order_relaxed) != before)
+      continue;
+
+    bodyID = slotBody;
+    sequence = slotSequence;
+    return true;
+  }
+  return false;
+}
+
+} // namespace ipc
+} // namespace photobooth
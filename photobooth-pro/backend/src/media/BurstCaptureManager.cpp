@@ -2,9 +2,10 @@
 #include "media/GifCreator.h"
 #include <chrono>
 #include <filesystem>
-#include <iomanip>
+#include <future>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <stdexcept>
 #include <thread>
 
 
@@ -70,37 +71,25 @@ void BurstCaptureManager::burstCaptureLoop() {
   result.success = false;
 
   try {
-    // Create save directory
+    // Create save directory for the GIF output
     fs::create_directories(currentOptions_.saveDirectory);
 
-    // Generate timestamp for this burst session
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         now.time_since_epoch())
-                         .count();
-
-    std::string sessionDir =
-        currentOptions_.saveDirectory + "/burst_" + std::to_string(timestamp);
-    fs::create_directories(sessionDir);
-
     std::cout << "BurstCapture: Starting burst capture - "
               << currentOptions_.frameCount << " frames at "
               << currentOptions_.frameInterval << "ms interval" << std::endl;
 
-    // Capture frames
+    // Capture frames; the JPEG bytes stay in memory for the GIF encoder
+    // instead of being copied into a session folder and read back
     for (int i = 0; i < currentOptions_.frameCount && !shouldStop_; i++) {
-      // Generate frame filename
-      std::ostringstream oss;
-      oss << sessionDir << "/frame_" << std::setfill('0') << std::setw(4) << i
-          << ".jpg";
-      std::string framePath = oss.str();
-
       // Capture frame
       std::cout << "BurstCapture: Capturing frame " << (i + 1) << "/"
                 << currentOptions_.frameCount << std::endl;
 
-      if (captureFrame(framePath)) {
+      std::string framePath;
+      std::vector<uint8_t> frameData;
+      if (captureFrame(framePath, frameData)) {
         result.framePaths.push_back(framePath);
+        result.frameData.push_back(std::move(frameData));
         result.capturedFrames++;
 
         // Progress callback
@@ -145,57 +134,57 @@ void BurstCaptureManager::burstCaptureLoop() {
   }
 }
 
-bool BurstCaptureManager::captureFrame(const std::string &outputPath) {
+bool BurstCaptureManager::captureFrame(std::string &framePath,
+                                       std::vector<uint8_t> &frameData) {
   if (!camera_ || !camera_->isConnected()) {
     return false;
   }
 
-  bool captureSuccess = false;
-  std::string capturedPath;
+  // Shared with the callback, which may still fire after a timeout
+  auto captured = std::make_shared<std::promise<CaptureResult>>();
+  auto done = captured->get_future();
+  auto reported = std::make_shared<std::atomic<bool>>(false);
 
-  // Set up capture callback
-  auto captureCallback = [&](const CaptureResult &result) {
-    if (result.success && !result.filePath.empty()) {
-      capturedPath = result.filePath;
-      captureSuccess = true;
+  auto captureCallback = [captured, reported](const CaptureResult &result) {
+    if (!reported->exchange(true)) {
+      captured->set_value(result);
     }
   };
 
   // Trigger capture
-  camera_->capture(CaptureMode::Photo, captureCallback);
+  camera_->capture(CaptureMode::Single, captureCallback);
 
   // Wait for capture to complete (with timeout)
-  auto start = std::chrono::steady_clock::now();
   const int timeoutSeconds = 10;
-
-  while (!captureSuccess && std::chrono::duration_cast<std::chrono::seconds>(
-                                std::chrono::steady_clock::now() - start)
-                                    .count() < timeoutSeconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  }
-
-  if (!captureSuccess) {
+  if (done.wait_for(std::chrono::seconds(timeoutSeconds)) !=
+      std::future_status::ready) {
     std::cerr << "BurstCapture: Capture timeout" << std::endl;
     return false;
   }
 
-  // Move/copy file to desired location if different
-  if (capturedPath != outputPath) {
-    try {
-      fs::copy_file(capturedPath, outputPath,
-                    fs::copy_options::overwrite_existing);
-      // Optionally delete original
-      // fs::remove(capturedPath);
-    } catch (const std::exception &e) {
-      std::cerr << "BurstCapture: Failed to copy file: " << e.what()
-                << std::endl;
-      return false;
-    }
+  CaptureResult result = done.get();
+  if (!result.success ||
+      (result.filePath.empty() && result.imageData.empty())) {
+    return false;
   }
 
+  framePath = result.filePath;
+  frameData = std::move(result.imageData);
   return true;
 }
 
+void BurstCaptureManager::addBurstFrames(const BurstResult &burstResult,
+                                         FrameSequence &sequence) {
+  for (size_t i = 0; i < burstResult.framePaths.size(); i++) {
+    if (i < burstResult.frameData.size() &&
+        !burstResult.frameData[i].empty()) {
+      sequence.addEncoded(burstResult.frameData[i]);
+    } else {
+      sequence.addFile(burstResult.framePaths[i]);
+    }
+  }
+}
+
 std::string BurstCaptureManager::createGifFromBurst(
     const BurstResult &burstResult, const GifCreator::GifOptions &gifOptions) {
   if (!burstResult.success || burstResult.framePaths.empty()) {
@@ -213,10 +202,13 @@ std::string BurstCaptureManager::createGifFromBurst(
   std::string outputPath = currentOptions_.saveDirectory + "/gif_" +
                            std::to_string(timestamp) + ".gif";
 
-  // Create GIF
+  // Create GIF; frames are decoded and scaled in parallel from memory
+  FrameSequence frames(gifOptions.width, gifOptions.height);
+  addBurstFrames(burstResult, frames);
+
   GifCreator creator;
   std::string gifPath =
-      creator.createGif(burstResult.framePaths, outputPath, gifOptions);
+      creator.createGif(frames, {}, outputPath, gifOptions, nullptr);
 
   if (gifPath.empty()) {
     std::cerr << "BurstCapture: Failed to create GIF" << std::endl;
@@ -237,8 +229,8 @@ std::string BurstCaptureManager::createBoomerangFromBurst(
   }
 
   // Create boomerang sequence
-  std::vector<std::string> boomerangSequence =
-      createBoomerangSequence(burstResult.framePaths,
+  std::vector<size_t> boomerangSequence =
+      createBoomerangSequence(burstResult.framePaths.size(),
                               true // smooth reverse
       );
 
@@ -251,7 +243,11 @@ std::string BurstCaptureManager::createBoomerangFromBurst(
   std::string outputPath = currentOptions_.saveDirectory + "/boomerang_" +
                            std::to_string(timestamp) + ".gif";
 
-  // Create GIF with boomerang sequence
+  // Create GIF with boomerang sequence; the reversed frames repeat indices,
+  // so each frame is decoded and compressed only once
+  FrameSequence frames(gifOptions.width, gifOptions.height);
+  addBurstFrames(burstResult, frames);
+
   GifCreator creator;
 
   // Use faster frame delay for boomerang effect
@@ -259,8 +255,9 @@ std::string BurstCaptureManager::createBoomerangFromBurst(
   boomerangOptions.frameDelay =
       std::min(boomerangOptions.frameDelay, 8); // Max 80ms
 
-  std::string gifPath =
-      creator.createGif(boomerangSequence, outputPath, boomerangOptions);
+  std::string gifPath = creator.createGif(frames, boomerangSequence,
+                                          outputPath, boomerangOptions,
+                                          nullptr);
 
   if (gifPath.empty()) {
     std::cerr << "BurstCapture: Failed to create Boomerang" << std::endl;
@@ -272,34 +269,18 @@ std::string BurstCaptureManager::createBoomerangFromBurst(
   return gifPath;
 }
 
-std::vector<std::string> BurstCaptureManager::createBoomerangSequence(
-    const std::vector<std::string> &frames, bool smoothReverse) {
-  std::vector<std::string> sequence;
-
-  if (frames.empty()) {
-    return sequence;
-  }
-
-  // Forward sequence
-  for (const auto &frame : frames) {
-    sequence.push_back(frame);
+std::vector<size_t>
+BurstCaptureManager::createBoomerangSequence(size_t frameCount,
+                                             bool smoothReverse) {
+  if (frameCount == 0) {
+    return {};
   }
 
-  // Reverse sequence
-  if (smoothReverse && frames.size() > 2) {
-    // Skip first and last frame to avoid stutter
-    for (int i = frames.size() - 2; i > 0; i--) {
-      sequence.push_back(frames[i]);
-    }
-  } else {
-    // Include all frames in reverse
-    for (int i = frames.size() - 1; i >= 0; i--) {
-      sequence.push_back(frames[i]);
-    }
-  }
+  std::vector<size_t> sequence =
+      GifCreator::boomerangOrder(frameCount, smoothReverse);
 
   std::cout << "BurstCapture: Created boomerang sequence with "
-            << sequence.size() << " frames (from " << frames.size()
+            << sequence.size() << " frames (from " << frameCount
             << " original frames)" << std::endl;
 
   return sequence;
@@ -0,0 +1,65 @@
+#include "media/FrameSequence.h"
+#include "core/WorkerPool.h"
+#include "image/PhotoDecodeCache.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace photobooth {
+
+FrameSequence::FrameSequence(int width, int height)
+    : width_(width), height_(height) {}
+
+FrameSequence::~FrameSequence() {
+  // Pool tasks must not outlive the sequence
+  for (auto &frame : pending_) {
+    if (frame.valid()) {
+      frame.wait();
+    }
+  }
+}
+
+void FrameSequence::addEncoded(std::vector<uint8_t> data) {
+  int width = width_, height = height_;
+  pending_.push_back(WorkerPool::getInstance().submit(
+      [data = std::move(data), width, height]() {
+        cv::Mat frame = PhotoDecodeCache::decodeFitted(data, width, height);
+        if (frame.empty()) {
+          std::cerr << "FrameSequence: failed to decode frame" << std::endl;
+        }
+        return frame;
+      }));
+}
+
+void FrameSequence::addFile(const std::string &path) {
+  int width = width_, height = height_;
+  pending_.push_back(
+      WorkerPool::getInstance().submit([path, width, height]() {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+        if (data.empty()) {
+          std::cerr << "Failed to read image: " << path << std::endl;
+          return cv::Mat();
+        }
+        return PhotoDecodeCache::decodeFitted(data, width, height);
+      }));
+}
+
+void FrameSequence::addFrame(const cv::Mat &frame) {
+  int width = width_, height = height_;
+  pending_.push_back(
+      WorkerPool::getInstance().submit([frame, width, height]() {
+        return PhotoDecodeCache::fitToSlot(frame, width, height);
+      }));
+}
+
+std::vector<cv::Mat> FrameSequence::frames() {
+  // Frames already collected stay valid; only new ones are waited for
+  for (size_t i = done_.size(); i < pending_.size(); i++) {
+    done_.push_back(pending_[i].get());
+  }
+  return done_;
+}
+
+} // namespace photobooth
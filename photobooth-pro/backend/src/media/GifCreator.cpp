@@ -1,18 +1,8 @@
 #include "media/GifCreator.h"
-#include <array>
-#include <chrono>
-#include <cstdlib>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
-#include <opencv2/opencv.hpp>
-#include <sstream>
-
-
-#ifdef _WIN32
-#include <windows.h>
-#define popen _popen
-#define pclose _pclose
-#endif
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
@@ -25,254 +15,126 @@ GifCreator::~GifCreator() {}
 std::string GifCreator::createGif(const std::vector<std::string> &imagePaths,
                                   const std::string &outputPath,
                                   const GifOptions &options) {
+  return createGif(imagePaths, outputPath, options, nullptr);
+}
+
+std::string GifCreator::createGif(const std::vector<std::string> &imagePaths,
+                                  const std::string &outputPath,
+                                  const GifOptions &options,
+                                  const GifEncoder::Sink &sink) {
   if (imagePaths.empty()) {
     std::cerr << "GifCreator: No images provided" << std::endl;
     return "";
   }
 
-  // Tạo thư mục output nếu chưa tồn tại
-  fs::path outPath(outputPath);
-  if (outPath.has_parent_path()) {
-    fs::create_directories(outPath.parent_path());
+  // Ảnh lặp lại (vd: nửa chạy ngược của boomerang) chỉ decode và nén một
+  // lần; order giữ thứ tự phát
+  FrameSequence sequence(options.width, options.height);
+  std::vector<size_t> order;
+  std::unordered_map<std::string, size_t> indexOf;
+  for (const auto &path : imagePaths) {
+    auto inserted = indexOf.emplace(path, sequence.size());
+    if (inserted.second) {
+      sequence.addFile(path);
+    }
+    order.push_back(inserted.first->second);
   }
 
-  // Tạo thư mục tạm cho ảnh đã resize
-  std::string tempDir = createTempDirectory();
-
-  // Resize tất cả ảnh về cùng kích thước
-  std::vector<std::string> resizedPaths =
-      resizeImages(imagePaths, tempDir, options.width, options.height);
+  return createGif(sequence, order, outputPath, options, sink);
+}
 
-  if (resizedPaths.empty()) {
-    std::cerr << "GifCreator: Failed to resize images" << std::endl;
-    cleanupTempDirectory(tempDir);
+std::string GifCreator::createGif(FrameSequence &sequence,
+                                  const std::vector<size_t> &order,
+                                  const std::string &outputPath,
+                                  const GifOptions &options,
+                                  const GifEncoder::Sink &sink) {
+  if (sequence.size() == 0) {
+    std::cerr << "GifCreator: No images provided" << std::endl;
     return "";
   }
 
-  bool success = false;
-
-  // Thử ImageMagick trước
-  if (isImageMagickAvailable()) {
-    std::cout << "Using ImageMagick to create GIF..." << std::endl;
-    success = createGifWithImageMagick(resizedPaths, outputPath, options);
-  }
-  // Fallback sang gifsicle
-  else if (isGifsicleAvailable()) {
-    std::cout << "Using gifsicle to create GIF..." << std::endl;
-    success = createGifWithGifsicle(resizedPaths, outputPath, options);
-  } else {
-    std::cerr << "GifCreator: Neither ImageMagick nor gifsicle found!"
-              << std::endl;
-    std::cerr << "Please install ImageMagick: choco install imagemagick"
-              << std::endl;
-  }
-
-  // Cleanup
-  cleanupTempDirectory(tempDir);
-
-  if (success && fs::exists(outputPath)) {
-    std::cout << "GIF created successfully: " << outputPath << std::endl;
-    return outputPath;
+  // Tạo thư mục output nếu chưa tồn tại
+  fs::path outPath(outputPath);
+  if (outPath.has_parent_path()) {
+    fs::create_directories(outPath.parent_path());
   }
 
-  return "";
-}
+  std::vector<cv::Mat> frames = sequence.frames();
 
-bool GifCreator::isImageMagickAvailable() {
-  std::string output;
-  int result = executeCommand("magick -version", output);
-  return result == 0;
-}
-
-bool GifCreator::isGifsicleAvailable() {
-  std::string output;
-  int result = executeCommand("gifsicle --version", output);
-  return result == 0;
-}
-
-std::vector<std::string>
-GifCreator::resizeImages(const std::vector<std::string> &imagePaths,
-                         const std::string &tempDir, int width, int height) {
-  std::vector<std::string> resizedPaths;
-
-  for (size_t i = 0; i < imagePaths.size(); i++) {
-    const auto &path = imagePaths[i];
-
-    // Đọc ảnh
-    cv::Mat img = cv::imread(path);
-    if (img.empty()) {
-      std::cerr << "Failed to read image: " << path << std::endl;
-      continue;
-    }
-
-    // Resize
-    cv::Mat resized;
-    cv::resize(img, resized, cv::Size(width, height));
-
-    // Lưu vào thư mục tạm
-    std::ostringstream oss;
-    oss << tempDir << "/frame_" << std::setfill('0') << std::setw(4) << i
-        << ".jpg";
-    std::string resizedPath = oss.str();
-
-    if (cv::imwrite(resizedPath, resized)) {
-      resizedPaths.push_back(resizedPath);
-    } else {
-      std::cerr << "Failed to write resized image: " << resizedPath
-                << std::endl;
+  // Bỏ các frame lỗi, đánh lại index cho order
+  std::vector<cv::Mat> loaded;
+  std::vector<size_t> remap(frames.size(), SIZE_MAX);
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (!frames[i].empty()) {
+      remap[i] = loaded.size();
+      loaded.push_back(std::move(frames[i]));
     }
   }
-
-  return resizedPaths;
-}
-
-bool GifCreator::createGifWithImageMagick(
-    const std::vector<std::string> &imagePaths, const std::string &outputPath,
-    const GifOptions &options) {
-  std::string command =
-      buildImageMagickCommand(imagePaths, outputPath, options);
-  std::string output;
-
-  std::cout << "Executing: " << command << std::endl;
-  int result = executeCommand(command, output);
-
-  if (result != 0) {
-    std::cerr << "ImageMagick failed: " << output << std::endl;
-    return false;
-  }
-
-  return fs::exists(outputPath);
-}
-
-bool GifCreator::createGifWithGifsicle(
-    const std::vector<std::string> &imagePaths, const std::string &outputPath,
-    const GifOptions &options) {
-  // gifsicle yêu cầu input là GIF, nên phải convert PNG->GIF trước
-  // Đây là implementation đơn giản, có thể cải thiện
-
-  std::vector<std::string> gifPaths;
-
-  // Convert mỗi JPEG sang GIF riêng lẻ
-  for (size_t i = 0; i < imagePaths.size(); i++) {
-    std::string tempGif = imagePaths[i] + ".gif";
-    std::ostringstream cmd;
-    cmd << "magick \"" << imagePaths[i] << "\" \"" << tempGif << "\"";
-
-    std::string output;
-    if (executeCommand(cmd.str(), output) == 0) {
-      gifPaths.push_back(tempGif);
+  std::vector<size_t> playOrder;
+  if (order.empty()) {
+    for (size_t index : remap) {
+      if (index != SIZE_MAX) {
+        playOrder.push_back(index);
+      }
+    }
+  } else {
+    for (size_t index : order) {
+      if (index < remap.size() && remap[index] != SIZE_MAX) {
+        playOrder.push_back(remap[index]);
+      }
     }
   }
 
-  if (gifPaths.empty()) {
-    return false;
-  }
-
-  // Merge các GIF lại
-  std::ostringstream cmd;
-  cmd << "gifsicle --delay=" << options.frameDelay
-      << " --loop=" << options.loopCount;
-
-  if (options.optimize) {
-    cmd << " --optimize=3";
-  }
-
-  for (const auto &gif : gifPaths) {
-    cmd << " \"" << gif << "\"";
+  if (loaded.empty() || playOrder.empty()) {
+    std::cerr << "GifCreator: Failed to read images" << std::endl;
+    return "";
   }
 
-  cmd << " > \"" << outputPath << "\"";
+  GifEncoder::Options encoderOptions;
+  encoderOptions.frameDelay = options.frameDelay;
+  encoderOptions.loopCount = options.loopCount;
+  encoderOptions.paletteSize = options.paletteSize;
+  encoderOptions.dither = options.dither;
+  encoderOptions.optimize = options.optimize;
 
-  std::string output;
-  int result = executeCommand(cmd.str(), output);
-
-  // Cleanup temp GIFs
-  for (const auto &gif : gifPaths) {
-    fs::remove(gif);
+  if (!GifEncoder::encodeToFile(loaded, playOrder, outputPath, encoderOptions,
+                                sink)) {
+    std::cerr << "GifCreator: Failed to encode GIF" << std::endl;
+    return "";
   }
 
-  return result == 0 && fs::exists(outputPath);
+  std::cout << "GIF created successfully: " << outputPath << std::endl;
+  return outputPath;
 }
 
-std::string
-GifCreator::buildImageMagickCommand(const std::vector<std::string> &imagePaths,
-                                    const std::string &outputPath,
-                                    const GifOptions &options) {
-  std::ostringstream cmd;
-
-  // ImageMagick 7 uses 'magick' command
-  cmd << "magick";
-
-  // Delay between frames (in 1/100 seconds)
-  cmd << " -delay " << options.frameDelay;
-
-  // Loop count (0 = infinite)
-  cmd << " -loop " << options.loopCount;
-
-  // Add all input images
-  for (const auto &path : imagePaths) {
-    cmd << " \"" << path << "\"";
-  }
-
-  // Optimization
-  if (options.optimize) {
-    cmd << " -layers Optimize";
+std::vector<std::string>
+GifCreator::boomerangSequence(const std::vector<std::string> &frames,
+                              bool smoothReverse) {
+  std::vector<std::string> sequence;
+  for (size_t index : boomerangOrder(frames.size(), smoothReverse)) {
+    sequence.push_back(frames[index]);
   }
-
-  // Output file
-  cmd << " \"" << outputPath << "\"";
-
-  return cmd.str();
+  return sequence;
 }
 
-int GifCreator::executeCommand(const std::string &command,
-                               std::string &output) {
-  output.clear();
-
-  FILE *pipe = popen(command.c_str(), "r");
-  if (!pipe) {
-    return -1;
-  }
-
-  std::array<char, 128> buffer;
-  while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-    output += buffer.data();
+std::vector<size_t> GifCreator::boomerangOrder(size_t count,
+                                               bool smoothReverse) {
+  std::vector<size_t> order;
+  for (size_t i = 0; i < count; i++) {
+    order.push_back(i);
   }
 
-  int result = pclose(pipe);
-
-#ifdef _WIN32
-  // Windows pclose returns exit code directly
-  return result;
-#else
-  // Unix pclose returns status that needs WEXITSTATUS
-  return WEXITSTATUS(result);
-#endif
-}
-
-std::string GifCreator::createTempDirectory() {
-  auto now = std::chrono::system_clock::now();
-  auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                       now.time_since_epoch())
-                       .count();
-
-  std::ostringstream oss;
-  oss << fs::temp_directory_path().string() << "/photobooth_gif_" << timestamp;
-
-  std::string tempDir = oss.str();
-  fs::create_directories(tempDir);
-
-  return tempDir;
-}
-
-void GifCreator::cleanupTempDirectory(const std::string &dir) {
-  try {
-    if (fs::exists(dir)) {
-      fs::remove_all(dir);
+  if (smoothReverse && count > 2) {
+    // Bỏ frame đầu và cuối để tránh giật
+    for (size_t i = count - 2; i > 0; i--) {
+      order.push_back(i);
+    }
+  } else {
+    for (size_t i = count; i > 0; i--) {
+      order.push_back(i - 1);
     }
-  } catch (const std::exception &e) {
-    std::cerr << "Failed to cleanup temp directory: " << e.what() << std::endl;
   }
+  return order;
 }
 
 } // namespace photobooth
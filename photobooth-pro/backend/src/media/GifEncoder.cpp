@@ -0,0 +1,763 @@
+#include "media/GifEncoder.h"
+#include "core/WorkerPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+
+namespace photobooth {
+
+namespace {
+
+constexpr int HISTOGRAM_BITS = 5;
+constexpr int HISTOGRAM_SIZE = 1 << (3 * HISTOGRAM_BITS); // 32768 bins
+constexpr size_t MAX_PALETTE_SAMPLES = 1 << 20;
+
+constexpr int LZW_MAX_BITS = 12;
+constexpr int LZW_MAX_CODE = 1 << LZW_MAX_BITS; // 4096
+constexpr int LZW_HASH_SIZE = 5003;            // Prime, ~80% occupancy
+
+// Ordered dither spread, roughly one palette step of a 256-color table
+constexpr int DITHER_SPREAD = 24;
+
+// 8x8 Bayer matrix
+constexpr uint8_t BAYER8[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21}};
+
+inline int histogramKey(int b, int g, int r) {
+  return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+}
+
+// Bin counts and channel sums, so each palette entry is a true mean
+struct Histogram {
+  std::vector<uint32_t> count;
+  std::vector<uint64_t> sumR, sumG, sumB;
+
+  Histogram()
+      : count(HISTOGRAM_SIZE, 0), sumR(HISTOGRAM_SIZE, 0),
+        sumG(HISTOGRAM_SIZE, 0), sumB(HISTOGRAM_SIZE, 0) {}
+};
+
+// Axis-aligned box of histogram bins, inclusive 5-bit bounds per channel
+struct ColorBox {
+  int lo[3];
+  int hi[3];
+  uint64_t count;
+};
+
+inline int binIndex(int r, int g, int b) { return (r << 10) | (g << 5) | b; }
+
+// Shrink a box to the bins that actually hold pixels and recount it
+void shrinkBox(const Histogram &hist, ColorBox &box) {
+  int lo[3] = {31, 31, 31};
+  int hi[3] = {0, 0, 0};
+  uint64_t count = 0;
+  for (int r = box.lo[0]; r <= box.hi[0]; r++) {
+    for (int g = box.lo[1]; g <= box.hi[1]; g++) {
+      for (int b = box.lo[2]; b <= box.hi[2]; b++) {
+        uint32_t c = hist.count[binIndex(r, g, b)];
+        if (c == 0)
+          continue;
+        count += c;
+        lo[0] = std::min(lo[0], r);
+        hi[0] = std::max(hi[0], r);
+        lo[1] = std::min(lo[1], g);
+        hi[1] = std::max(hi[1], g);
+        lo[2] = std::min(lo[2], b);
+        hi[2] = std::max(hi[2], b);
+      }
+    }
+  }
+  box.count = count;
+  if (count > 0) {
+    std::copy(lo, lo + 3, box.lo);
+    std::copy(hi, hi + 3, box.hi);
+  }
+}
+
+// Split at the pixel median of the longest side; false if it can't split
+bool splitBox(const Histogram &hist, ColorBox &box, ColorBox &other) {
+  int axis = 0;
+  for (int i = 1; i < 3; i++) {
+    if (box.hi[i] - box.lo[i] > box.hi[axis] - box.lo[axis])
+      axis = i;
+  }
+  if (box.hi[axis] == box.lo[axis])
+    return false;
+
+  // Pixel count of each slice along the axis
+  std::vector<uint64_t> slices(32, 0);
+  for (int r = box.lo[0]; r <= box.hi[0]; r++) {
+    for (int g = box.lo[1]; g <= box.hi[1]; g++) {
+      for (int b = box.lo[2]; b <= box.hi[2]; b++) {
+        int coord[3] = {r, g, b};
+        slices[coord[axis]] += hist.count[binIndex(r, g, b)];
+      }
+    }
+  }
+
+  uint64_t half = box.count / 2;
+  uint64_t seen = 0;
+  int cut = box.lo[axis];
+  for (int v = box.lo[axis]; v < box.hi[axis]; v++) {
+    seen += slices[v];
+    cut = v;
+    if (seen >= half)
+      break;
+  }
+
+  other = box;
+  box.hi[axis] = cut;
+  other.lo[axis] = cut + 1;
+  shrinkBox(hist, box);
+  shrinkBox(hist, other);
+  return box.count > 0 && other.count > 0;
+}
+
+std::array<uint8_t, 3> boxColor(const Histogram &hist, const ColorBox &box) {
+  uint64_t count = 0, r = 0, g = 0, b = 0;
+  for (int x = box.lo[0]; x <= box.hi[0]; x++) {
+    for (int y = box.lo[1]; y <= box.hi[1]; y++) {
+      for (int z = box.lo[2]; z <= box.hi[2]; z++) {
+        int i = binIndex(x, y, z);
+        count += hist.count[i];
+        r += hist.sumR[i];
+        g += hist.sumG[i];
+        b += hist.sumB[i];
+      }
+    }
+  }
+  if (count == 0)
+    return {0, 0, 0};
+  return {static_cast<uint8_t>((r + count / 2) / count),
+          static_cast<uint8_t>((g + count / 2) / count),
+          static_cast<uint8_t>((b + count / 2) / count)};
+}
+
+// Nearest palette entry for every 15-bit color, computed once per GIF
+std::vector<uint8_t>
+buildLookup(const std::vector<std::array<uint8_t, 3>> &colors) {
+  std::vector<uint8_t> lookup(HISTOGRAM_SIZE, 0);
+  constexpr size_t CHUNK = 1024;
+  WorkerPool::getInstance().parallelFor(
+      HISTOGRAM_SIZE / CHUNK, [&](size_t chunk) {
+        for (size_t key = chunk * CHUNK; key < (chunk + 1) * CHUNK; key++) {
+          int r = static_cast<int>((key >> 10) & 31) * 8 + 4;
+          int g = static_cast<int>((key >> 5) & 31) * 8 + 4;
+          int b = static_cast<int>(key & 31) * 8 + 4;
+
+          int best = 0;
+          int bestDist = std::numeric_limits<int>::max();
+          for (size_t i = 0; i < colors.size(); i++) {
+            int dr = r - colors[i][0];
+            int dg = g - colors[i][1];
+            int db = b - colors[i][2];
+            int dist = dr * dr * 3 + dg * dg * 4 + db * db * 2;
+            if (dist < bestDist) {
+              bestDist = dist;
+              best = static_cast<int>(i);
+            }
+          }
+          lookup[key] = static_cast<uint8_t>(best);
+        }
+      });
+  return lookup;
+}
+
+// Packs variable-width LZW codes LSB-first into 255-byte sub-blocks
+class CodeWriter {
+public:
+  explicit CodeWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+  void write(int code, int bits) {
+    buffer_ |= static_cast<uint32_t>(code) << bitCount_;
+    bitCount_ += bits;
+    while (bitCount_ >= 8) {
+      pushByte(static_cast<uint8_t>(buffer_ & 0xFF));
+      buffer_ >>= 8;
+      bitCount_ -= 8;
+    }
+  }
+
+  void finish() {
+    if (bitCount_ > 0) {
+      pushByte(static_cast<uint8_t>(buffer_ & 0xFF));
+      buffer_ = 0;
+      bitCount_ = 0;
+    }
+    flushBlock();
+    out_.push_back(0); // Block terminator
+  }
+
+private:
+  std::vector<uint8_t> &out_;
+  uint32_t buffer_ = 0;
+  int bitCount_ = 0;
+  uint8_t block_[255];
+  int blockSize_ = 0;
+
+  void pushByte(uint8_t byte) {
+    block_[blockSize_++] = byte;
+    if (blockSize_ == 255)
+      flushBlock();
+  }
+
+  void flushBlock() {
+    if (blockSize_ == 0)
+      return;
+    out_.push_back(static_cast<uint8_t>(blockSize_));
+    out_.insert(out_.end(), block_, block_ + blockSize_);
+    blockSize_ = 0;
+  }
+};
+
+void writeU16(std::vector<uint8_t> &out, int value) {
+  out.push_back(static_cast<uint8_t>(value & 0xFF));
+  out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+}
+
+} // namespace
+
+GifEncoder::Palette GifEncoder::buildPalette(const std::vector<cv::Mat> &frames,
+                                             int paletteSize) {
+  paletteSize = std::max(2, std::min(256, paletteSize));
+
+  // Sample evenly across all frames, at most ~1M pixels in total
+  size_t totalPixels = 0;
+  for (const auto &frame : frames)
+    totalPixels += frame.total();
+  int stride = 1;
+  while (totalPixels / (static_cast<size_t>(stride) * stride) >
+         MAX_PALETTE_SAMPLES)
+    stride++;
+
+  Histogram hist;
+  for (const auto &frame : frames) {
+    for (int y = 0; y < frame.rows; y += stride) {
+      const uint8_t *row = frame.ptr<uint8_t>(y);
+      for (int x = 0; x < frame.cols; x += stride) {
+        int b = row[x * 3], g = row[x * 3 + 1], r = row[x * 3 + 2];
+        int key = histogramKey(b, g, r);
+        hist.count[key]++;
+        hist.sumR[key] += r;
+        hist.sumG[key] += g;
+        hist.sumB[key] += b;
+      }
+    }
+  }
+
+  ColorBox all = {{0, 0, 0}, {31, 31, 31}, 0};
+  shrinkBox(hist, all);
+  std::vector<ColorBox> boxes;
+  if (all.count > 0)
+    boxes.push_back(all);
+
+  // Split the box with the most pixels times its longest side
+  while (static_cast<int>(boxes.size()) < paletteSize) {
+    int pick = -1;
+    uint64_t bestScore = 0;
+    for (size_t i = 0; i < boxes.size(); i++) {
+      const ColorBox &box = boxes[i];
+      int side = std::max({box.hi[0] - box.lo[0], box.hi[1] - box.lo[1],
+                           box.hi[2] - box.lo[2]});
+      uint64_t score = box.count * static_cast<uint64_t>(side);
+      if (side > 0 && score > bestScore) {
+        bestScore = score;
+        pick = static_cast<int>(i);
+      }
+    }
+    if (pick < 0)
+      break;
+
+    ColorBox other;
+    if (!splitBox(hist, boxes[pick], other))
+      break;
+    boxes.push_back(other);
+  }
+
+  Palette palette;
+  for (const auto &box : boxes)
+    palette.colors.push_back(boxColor(hist, box));
+  if (palette.colors.empty())
+    palette.colors.push_back({0, 0, 0});
+
+  palette.lookup = buildLookup(palette.colors);
+  return palette;
+}
+
+void GifEncoder::indexFrame(const cv::Mat &frame, const Palette &palette,
+                            Dither dither, std::vector<uint8_t> &indices) {
+  int width = frame.cols;
+  int height = frame.rows;
+  indices.resize(static_cast<size_t>(width) * height);
+  const uint8_t *lookup = palette.lookup.data();
+
+  if (dither == Dither::FloydSteinberg) {
+    // Error rows for the current and next line, 3 channels, 1px margin
+    std::vector<int> current((width + 2) * 3, 0), next((width + 2) * 3, 0);
+    for (int y = 0; y < height; y++) {
+      const uint8_t *src = frame.ptr<uint8_t>(y);
+      uint8_t *dst = indices.data() + static_cast<size_t>(y) * width;
+      std::fill(next.begin(), next.end(), 0);
+
+      for (int x = 0; x < width; x++) {
+        int *err = &current[(x + 1) * 3];
+        int b = std::min(255, std::max(0, src[x * 3] + err[0] / 16));
+        int g = std::min(255, std::max(0, src[x * 3 + 1] + err[1] / 16));
+        int r = std::min(255, std::max(0, src[x * 3 + 2] + err[2] / 16));
+
+        uint8_t index = lookup[histogramKey(b, g, r)];
+        dst[x] = index;
+
+        const auto &chosen = palette.colors[index];
+        int diff[3] = {b - chosen[2], g - chosen[1], r - chosen[0]};
+        for (int c = 0; c < 3; c++) {
+          current[(x + 2) * 3 + c] += diff[c] * 7;
+          next[x * 3 + c] += diff[c] * 3;
+          next[(x + 1) * 3 + c] += diff[c] * 5;
+          next[(x + 2) * 3 + c] += diff[c];
+        }
+      }
+      std::swap(current, next);
+    }
+    return;
+  }
+
+  // Bias per Bayer cell, centered on zero
+  int bias[8][8] = {};
+  if (dither == Dither::Ordered) {
+    for (int y = 0; y < 8; y++)
+      for (int x = 0; x < 8; x++)
+        bias[y][x] = ((2 * BAYER8[y][x] - 63) * DITHER_SPREAD) / 128;
+  }
+
+  // Keys are computed in a branch-free pass the compiler vectorizes;
+  // the palette lookup itself is a gather
+  std::vector<uint16_t> keys(width);
+  for (int y = 0; y < height; y++) {
+    const uint8_t *src = frame.ptr<uint8_t>(y);
+    const int *biasRow = bias[y & 7];
+    uint16_t *key = keys.data();
+
+    for (int x = 0; x < width; x++) {
+      int d = biasRow[x & 7];
+      int b = std::min(255, std::max(0, src[x * 3] + d));
+      int g = std::min(255, std::max(0, src[x * 3 + 1] + d));
+      int r = std::min(255, std::max(0, src[x * 3 + 2] + d));
+      key[x] = static_cast<uint16_t>(((r >> 3) << 10) | ((g >> 3) << 5) |
+                                     (b >> 3));
+    }
+
+    uint8_t *dst = indices.data() + static_cast<size_t>(y) * width;
+    for (int x = 0; x < width; x++)
+      dst[x] = lookup[key[x]];
+  }
+}
+
+GifEncoder::Region GifEncoder::deltaFrame(const cv::Mat &frame,
+                                          const uint8_t *indices, int tolerance,
+                                          uint8_t transparentIndex,
+                                          std::vector<uint8_t> &reference,
+                                          std::vector<uint8_t> &out) {
+  int width = frame.cols;
+  int height = frame.rows;
+
+  // Mark changed pixels and find their bounding box
+  std::vector<uint8_t> changed(static_cast<size_t>(width) * height);
+  int left = width, right = -1, top = height, bottom = -1;
+  for (int y = 0; y < height; y++) {
+    const uint8_t *src = frame.ptr<uint8_t>(y);
+    const uint8_t *ref = reference.data() + static_cast<size_t>(y) * width * 3;
+    uint8_t *mask = changed.data() + static_cast<size_t>(y) * width;
+
+    // Branch-free so the compiler can vectorize it
+    int any = 0;
+    for (int x = 0; x < width; x++) {
+      int db = std::abs(src[x * 3] - ref[x * 3]);
+      int dg = std::abs(src[x * 3 + 1] - ref[x * 3 + 1]);
+      int dr = std::abs(src[x * 3 + 2] - ref[x * 3 + 2]);
+      mask[x] = std::max(db, std::max(dg, dr)) > tolerance;
+      any |= mask[x];
+    }
+    if (!any)
+      continue;
+
+    int first = 0;
+    while (!mask[first])
+      first++;
+    int last = width - 1;
+    while (!mask[last])
+      last--;
+    left = std::min(left, first);
+    right = std::max(right, last);
+    top = std::min(top, y);
+    bottom = y;
+  }
+
+  if (bottom < 0) {
+    // Nothing changed; GIF still needs an image, so draw one clear pixel
+    out.assign(1, transparentIndex);
+    return {0, 0, 1, 1};
+  }
+
+  Region region = {left, top, right - left + 1, bottom - top + 1};
+  out.resize(static_cast<size_t>(region.width) * region.height);
+  uint8_t *dst = out.data();
+  for (int y = top; y <= bottom; y++) {
+    size_t offset = static_cast<size_t>(y) * width + left;
+    const uint8_t *mask = changed.data() + offset;
+    const uint8_t *index = indices + offset;
+    const uint8_t *src = frame.ptr<uint8_t>(y) + left * 3;
+    uint8_t *ref = reference.data() + offset * 3;
+
+    for (int x = 0; x < region.width; x++) {
+      if (mask[x]) {
+        dst[x] = index[x];
+        ref[x * 3] = src[x * 3];
+        ref[x * 3 + 1] = src[x * 3 + 1];
+        ref[x * 3 + 2] = src[x * 3 + 2];
+      } else {
+        dst[x] = transparentIndex;
+      }
+    }
+    dst += region.width;
+  }
+  return region;
+}
+
+void GifEncoder::lzwEncode(const uint8_t *indices, size_t count,
+                           int minCodeSize, std::vector<uint8_t> &out) {
+  out.push_back(static_cast<uint8_t>(minCodeSize));
+
+  const int clearCode = 1 << minCodeSize;
+  const int endCode = clearCode + 1;
+
+  // Dictionary: (prefix code << 8 | next index) -> code, open addressing
+  std::vector<int32_t> hashKeys(LZW_HASH_SIZE, -1);
+  std::vector<int16_t> hashCodes(LZW_HASH_SIZE, 0);
+
+  CodeWriter writer(out);
+  int codeSize = minCodeSize + 1;
+  int maxCode = (1 << codeSize) - 1;
+  int nextCode = endCode + 1;
+
+  auto resetTable = [&]() {
+    std::fill(hashKeys.begin(), hashKeys.end(), -1);
+    codeSize = minCodeSize + 1;
+    maxCode = (1 << codeSize) - 1;
+    nextCode = endCode + 1;
+  };
+
+  // Width grows once the next code to be assigned no longer fits
+  auto emit = [&](int code) {
+    writer.write(code, codeSize);
+    if (nextCode > maxCode && codeSize < LZW_MAX_BITS) {
+      codeSize++;
+      maxCode = codeSize == LZW_MAX_BITS ? LZW_MAX_CODE : (1 << codeSize) - 1;
+    }
+  };
+
+  writer.write(clearCode, codeSize);
+  if (count == 0) {
+    writer.write(endCode, codeSize);
+    writer.finish();
+    return;
+  }
+
+  int prefix = indices[0];
+  for (size_t i = 1; i < count; i++) {
+    int c = indices[i];
+    int32_t key = (prefix << 8) | c;
+
+    int slot = static_cast<int>((static_cast<uint32_t>(c) << 4 ^
+                                 static_cast<uint32_t>(prefix)) %
+                                LZW_HASH_SIZE);
+    int step = slot == 0 ? 1 : LZW_HASH_SIZE - slot;
+    bool found = false;
+    while (hashKeys[slot] >= 0) {
+      if (hashKeys[slot] == key) {
+        prefix = hashCodes[slot];
+        found = true;
+        break;
+      }
+      slot -= step;
+      if (slot < 0)
+        slot += LZW_HASH_SIZE;
+    }
+    if (found)
+      continue;
+
+    emit(prefix);
+    if (nextCode < LZW_MAX_CODE) {
+      hashKeys[slot] = key;
+      hashCodes[slot] = static_cast<int16_t>(nextCode++);
+    } else {
+      // Table full: start over rather than keep growing past 12 bits
+      writer.write(clearCode, codeSize);
+      resetTable();
+    }
+    prefix = c;
+  }
+
+  emit(prefix);
+  writer.write(endCode, codeSize);
+  writer.finish();
+}
+
+bool GifEncoder::encode(const std::vector<cv::Mat> &frames,
+                        const Options &options, std::vector<uint8_t> &out) {
+  return encode(frames, playOrder(frames.size()), options, out);
+}
+
+bool GifEncoder::encode(const std::vector<cv::Mat> &frames,
+                        const std::vector<size_t> &order,
+                        const Options &options, std::vector<uint8_t> &out) {
+  out.clear();
+  return encode(frames, order, options,
+                [&out](const uint8_t *data, size_t size) {
+                  out.insert(out.end(), data, data + size);
+                });
+}
+
+bool GifEncoder::encode(const std::vector<cv::Mat> &frames,
+                        const std::vector<size_t> &order,
+                        const Options &options, const Sink &sink) {
+  if (frames.empty() || order.empty())
+    return false;
+  for (size_t index : order) {
+    if (index >= frames.size())
+      return false;
+  }
+
+  int width = frames[0].cols;
+  int height = frames[0].rows;
+  for (const auto &frame : frames) {
+    if (frame.type() != CV_8UC3 || frame.cols != width ||
+        frame.rows != height) {
+      std::cerr << "GifEncoder: frames must be BGR and the same size"
+                << std::endl;
+      return false;
+    }
+  }
+  if (width > 0xFFFF || height > 0xFFFF || width == 0 || height == 0)
+    return false;
+
+  // With deltas one palette entry is kept back for transparent pixels
+  bool delta = options.optimize && order.size() > 1;
+  int paletteSize = std::max(2, std::min(256, options.paletteSize));
+  Palette palette =
+      buildPalette(frames, delta ? std::max(2, paletteSize - 1) : paletteSize);
+  int transparentIndex = static_cast<int>(palette.colors.size());
+  int tableSize = transparentIndex + (delta ? 1 : 0);
+
+  // Table size is a power of two; LZW needs at least 2 bits
+  int paletteBits = 2;
+  while ((1 << paletteBits) < tableSize)
+    paletteBits++;
+
+  // Header, logical screen with the global color table and the
+  // NETSCAPE2.0 loop extension go out before any frame is encoded
+  std::vector<uint8_t> head;
+  const char header[] = "GIF89a";
+  head.insert(head.end(), header, header + 6);
+  writeU16(head, width);
+  writeU16(head, height);
+  head.push_back(static_cast<uint8_t>(0x80 | (7 << 4) | (paletteBits - 1)));
+  head.push_back(0); // Background color index
+  head.push_back(0); // Pixel aspect ratio
+
+  for (int i = 0; i < (1 << paletteBits); i++) {
+    if (i < static_cast<int>(palette.colors.size())) {
+      head.insert(head.end(), palette.colors[i].begin(),
+                  palette.colors[i].end());
+    } else {
+      head.insert(head.end(), {0, 0, 0});
+    }
+  }
+
+  const char netscape[] = "NETSCAPE2.0";
+  head.insert(head.end(), {0x21, 0xFF, 0x0B});
+  head.insert(head.end(), netscape, netscape + 11);
+  head.insert(head.end(), {0x03, 0x01});
+  writeU16(head, options.loopCount);
+  head.push_back(0);
+  sink(head.data(), head.size());
+
+  struct ImageBlock {
+    size_t frame;
+    bool transparent;
+    Region region;
+    std::vector<uint8_t> pixels; // Delta blocks only
+    std::vector<uint8_t> data;
+  };
+  // Reserved up front: pool tasks hold references into it
+  std::vector<ImageBlock> blocks;
+  blocks.reserve(order.size());
+  std::vector<std::future<void>> compressed;
+  std::vector<size_t> sequence;
+  std::vector<std::vector<uint8_t>> indices(frames.size());
+  WorkerPool &pool = WorkerPool::getInstance();
+
+  // Hands frames to the sink in play order. Without wait it stops at the
+  // first frame that isn't compressed yet, so output can start while later
+  // deltas are still being worked out.
+  size_t written = 0;
+  std::vector<uint8_t> frameHead;
+  auto flush = [&](bool wait) {
+    while (written < sequence.size()) {
+      std::future<void> &task = compressed[sequence[written]];
+      if (!wait && task.wait_for(std::chrono::seconds(0)) !=
+                       std::future_status::ready)
+        return;
+      task.wait();
+      const ImageBlock &block = blocks[sequence[written++]];
+
+      // Graphic control extension: leave the frame in place for the next
+      // delta, frame delay, transparent index for delta frames
+      frameHead.assign({0x21, 0xF9, 0x04});
+      frameHead.push_back(
+          static_cast<uint8_t>(0x04 | (block.transparent ? 0x01 : 0x00)));
+      writeU16(frameHead, options.frameDelay);
+      frameHead.push_back(
+          static_cast<uint8_t>(block.transparent ? transparentIndex : 0));
+      frameHead.push_back(0);
+
+      // Image descriptor, global table
+      frameHead.push_back(0x2C);
+      writeU16(frameHead, block.region.left);
+      writeU16(frameHead, block.region.top);
+      writeU16(frameHead, block.region.width);
+      writeU16(frameHead, block.region.height);
+      frameHead.push_back(0);
+
+      sink(frameHead.data(), frameHead.size());
+      sink(block.data.data(), block.data.size());
+    }
+  };
+
+  if (delta) {
+    // Index each distinct frame once, in parallel
+    std::vector<std::future<void>> indexed;
+    for (size_t i = 0; i < frames.size(); i++) {
+      indexed.push_back(pool.submit([&, i]() {
+        indexFrame(frames[i], palette, options.dither, indices[i]);
+      }));
+    }
+
+    // Deltas depend on everything shown before them, so they are found in
+    // play order here; each block is compressed on the pool as soon as it
+    // is known. Every loop starts from the full first frame.
+    std::vector<uint8_t> reference(static_cast<size_t>(width) * height * 3);
+    for (size_t k = 0; k < order.size(); k++) {
+      const cv::Mat &frame = frames[order[k]];
+      indexed[order[k]].wait();
+
+      blocks.push_back({order[k], k > 0, {0, 0, width, height}, {}, {}});
+      ImageBlock &block = blocks.back();
+      if (k == 0) {
+        for (int y = 0; y < height; y++) {
+          const uint8_t *src = frame.ptr<uint8_t>(y);
+          std::copy(src, src + width * 3,
+                    reference.begin() + static_cast<size_t>(y) * width * 3);
+        }
+      } else {
+        block.region = deltaFrame(frame, indices[order[k]].data(),
+                                  options.deltaTolerance,
+                                  static_cast<uint8_t>(transparentIndex),
+                                  reference, block.pixels);
+      }
+
+      compressed.push_back(pool.submit([&, paletteBits, k]() {
+        ImageBlock &target = blocks[k];
+        const std::vector<uint8_t> &pixels =
+            target.transparent ? target.pixels : indices[target.frame];
+        lzwEncode(pixels.data(), pixels.size(), paletteBits, target.data);
+      }));
+      sequence.push_back(k);
+      flush(false);
+    }
+
+    // Frames left out of the order are still being indexed
+    for (auto &task : indexed)
+      task.wait();
+  } else {
+    // A frame repeated in the order (e.g. a boomerang) is compressed once
+    constexpr size_t NOT_ENCODED = static_cast<size_t>(-1);
+    std::vector<size_t> blockOf(frames.size(), NOT_ENCODED);
+    for (size_t index : order) {
+      if (blockOf[index] == NOT_ENCODED) {
+        blockOf[index] = blocks.size();
+        blocks.push_back({index, false, {0, 0, width, height}, {}, {}});
+        size_t block = blockOf[index];
+        compressed.push_back(pool.submit([&, paletteBits, index, block]() {
+          std::vector<uint8_t> &pixels = indices[index];
+          indexFrame(frames[index], palette, options.dither, pixels);
+          lzwEncode(pixels.data(), pixels.size(), paletteBits,
+                    blocks[block].data);
+          std::vector<uint8_t>().swap(pixels);
+        }));
+      }
+      sequence.push_back(blockOf[index]);
+    }
+  }
+
+  flush(true);
+
+  const uint8_t trailer = 0x3B;
+  sink(&trailer, 1);
+  return true;
+}
+
+bool GifEncoder::encodeToFile(const std::vector<cv::Mat> &frames,
+                              const std::string &outputPath,
+                              const Options &options) {
+  return encodeToFile(frames, playOrder(frames.size()), outputPath, options);
+}
+
+bool GifEncoder::encodeToFile(const std::vector<cv::Mat> &frames,
+                              const std::vector<size_t> &order,
+                              const std::string &outputPath,
+                              const Options &options) {
+  return encodeToFile(frames, order, outputPath, options, nullptr);
+}
+
+bool GifEncoder::encodeToFile(const std::vector<cv::Mat> &frames,
+                              const std::vector<size_t> &order,
+                              const std::string &outputPath,
+                              const Options &options, const Sink &sink) {
+  std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "GifEncoder: failed to open " << outputPath << std::endl;
+    return false;
+  }
+
+  bool ok = encode(frames, order, options,
+                   [&](const uint8_t *data, size_t size) {
+                     file.write(reinterpret_cast<const char *>(data),
+                                static_cast<std::streamsize>(size));
+                     if (sink)
+                       sink(data, size);
+                   });
+  file.close();
+  if (!ok || !file) {
+    std::cerr << "GifEncoder: failed to write " << outputPath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::vector<size_t> GifEncoder::playOrder(size_t frameCount) {
+  std::vector<size_t> order(frameCount);
+  for (size_t i = 0; i < frameCount; i++)
+    order[i] = i;
+  return order;
+}
+
+} // namespace photobooth
@@ -1,9 +1,11 @@
 #include "media/LayoutAnalyzer.h"
+#include "image/TransparencyScanner.h"
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <opencv2/opencv.hpp>
+#include <stdexcept>
 
 
 namespace fs = std::filesystem;
@@ -57,63 +59,35 @@ LayoutInfo LayoutAnalyzer::analyzeAndSave(const std::string &imagePath,
   LayoutInfo info;
   info.imagePath = imagePath;
 
-  // 1. Load image using OpenCV
-  cv::Mat img = cv::imread(imagePath, cv::IMREAD_UNCHANGED);
+  // 1. Stream the PNG and label transparent regions (alpha <= 10) row by row
+  TransparencyScan scan = scanTransparency(imagePath, 10);
 
-  if (img.empty()) {
+  if (!scan.loaded) {
     throw std::runtime_error("Failed to load layout image: " + imagePath);
   }
 
-  info.width = img.cols;
-  info.height = img.rows;
+  info.width = scan.width;
+  info.height = scan.height;
 
   // Check if image has alpha channel
-  if (img.channels() != 4) {
+  if (!scan.hasAlpha) {
     std::cerr << "Warning: Layout image has no alpha channel. Cannot detect "
                  "transparent slots."
               << std::endl;
     // Return info with 0 slots
     info.photoCount = 0;
   } else {
-    // 2. Extract Alpha Channel
-    std::vector<cv::Mat> channels;
-    cv::split(img, channels);
-    cv::Mat alpha = channels[3];
-
-    // 3. Create a binary mask where Transparent (Alpha=0) is White (255) and
-    // Opaque is Black (0) We use threshold to find pixels with alpha < 10
-    // (almost fully transparent)
-    cv::Mat mask;
-    cv::threshold(alpha, mask, 10, 255, cv::THRESH_BINARY_INV);
-
-    // 4. Find Contours
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::findContours(mask, contours, hierarchy, cv::RETR_EXTERNAL,
-                     cv::CHAIN_APPROX_SIMPLE);
-
-    // 5. Process Contours to find bounding boxes
-    int idCounter = 1;
-    for (const auto &contour : contours) {
-      // Calculate area to filter noise
-      double area = cv::contourArea(contour);
-
-      // Filter noise: Slot must be at least 5% of total image area? Or just a
-      // reasonable fixed size Let's say at least 100x100 pixels = 10000
-      if (area > 10000) {
-        cv::Rect rect = cv::boundingRect(contour);
-
-        // Fine tune: ensure rect is fully inside image
-        rect = rect & cv::Rect(0, 0, img.cols, img.rows);
-
+    // 2. Keep regions big enough to be a slot (100x100 pixels = 10000)
+    for (const auto &region : scan.regions) {
+      if (region.area > 10000) {
         // Create LayoutSlot
         LayoutSlot slot;
         // ID will be assigned after sorting
-        slot.x = rect.x;
-        slot.y = rect.y;
-        slot.width = rect.width;
-        slot.height = rect.height;
-        slot.rotation = 0; // OpenCV boundingRect is always upright
+        slot.x = region.x;
+        slot.y = region.y;
+        slot.width = region.width;
+        slot.height = region.height;
+        slot.rotation = 0; // Bounding boxes are always upright
 
         info.slots.push_back(slot);
       }
@@ -130,7 +104,7 @@ LayoutInfo LayoutAnalyzer::analyzeAndSave(const std::string &imagePath,
     info.photoCount = static_cast<int>(info.slots.size());
   }
 
-  // 6. Save to JSON
+  // 3. Save to JSON
   nlohmann::json j = info.toJson();
   std::ofstream o(jsonOutputPath);
   o << std::setw(4) << j << std::endl;
@@ -0,0 +1,209 @@
+#include "media/MjpegAviWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace photobooth {
+
+namespace {
+
+// RIFF header, hdrl list (avih, strl with strh and strf), movi list header
+constexpr size_t HEADER_SIZE = 224;
+constexpr uint32_t MOVI_FOURCC_OFFSET = 220;
+
+constexpr uint32_t AVIF_HASINDEX = 0x10;
+constexpr uint32_t AVIIF_KEYFRAME = 0x10;
+
+void put32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    out.push_back(static_cast<uint8_t>((value >> (8 * i)) & 0xFF));
+}
+
+void put16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(static_cast<uint8_t>(value & 0xFF));
+  out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+}
+
+void putFourcc(std::vector<uint8_t> &out, const char *fourcc) {
+  out.insert(out.end(), fourcc, fourcc + 4);
+}
+
+} // namespace
+
+MjpegAviWriter::MjpegAviWriter() {}
+
+MjpegAviWriter::~MjpegAviWriter() {
+  if (file_.is_open()) {
+    finish(0);
+  }
+}
+
+bool MjpegAviWriter::open(const std::string &path, int width, int height) {
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    std::cerr << "MjpegAviWriter: failed to open " << path << std::endl;
+    return false;
+  }
+
+  path_ = path;
+  width_ = width;
+  height_ = height;
+  position_ = 0;
+  moviEnd_ = 0;
+  maxFrameSize_ = 0;
+  index_.clear();
+  failed_ = false;
+
+  // Placeholder, rewritten with the real counts in finish()
+  std::vector<uint8_t> placeholder = header(0);
+  write(placeholder.data(), placeholder.size());
+  return !failed_;
+}
+
+bool MjpegAviWriter::writeFrame(const uint8_t *jpeg, size_t size) {
+  if (!file_.is_open() || failed_) {
+    return false;
+  }
+
+  IndexEntry entry;
+  entry.offset = static_cast<uint32_t>(position_ - MOVI_FOURCC_OFFSET);
+  entry.size = static_cast<uint32_t>(size);
+
+  std::vector<uint8_t> chunk;
+  putFourcc(chunk, "00dc");
+  put32(chunk, entry.size);
+  write(chunk.data(), chunk.size());
+  write(jpeg, size);
+  if (size % 2 != 0) {
+    const uint8_t pad = 0;
+    write(&pad, 1); // Chunks are word aligned
+  }
+
+  index_.push_back(entry);
+  maxFrameSize_ = std::max(maxFrameSize_, entry.size);
+  return !failed_;
+}
+
+bool MjpegAviWriter::finish(double fps) {
+  if (!file_.is_open()) {
+    return false;
+  }
+
+  moviEnd_ = position_;
+
+  std::vector<uint8_t> idx1;
+  putFourcc(idx1, "idx1");
+  put32(idx1, static_cast<uint32_t>(index_.size() * 16));
+  for (const auto &entry : index_) {
+    putFourcc(idx1, "00dc");
+    put32(idx1, AVIIF_KEYFRAME);
+    put32(idx1, entry.offset);
+    put32(idx1, entry.size);
+  }
+  write(idx1.data(), idx1.size());
+
+  std::vector<uint8_t> finalHeader = header(fps);
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char *>(finalHeader.data()),
+              static_cast<std::streamsize>(finalHeader.size()));
+  file_.close();
+
+  bool ok = !failed_ && !file_.fail();
+  if (!ok) {
+    std::cerr << "MjpegAviWriter: failed to write " << path_ << std::endl;
+  }
+  return ok;
+}
+
+std::vector<uint8_t> MjpegAviWriter::header(double fps) const {
+  if (fps <= 0) {
+    fps = 30.0;
+  }
+  uint32_t frames = static_cast<uint32_t>(index_.size());
+  uint32_t rate = static_cast<uint32_t>(std::lround(fps * 1000));
+  uint32_t moviSize = static_cast<uint32_t>(
+      moviEnd_ > HEADER_SIZE ? moviEnd_ - MOVI_FOURCC_OFFSET : 4);
+  uint32_t riffSize = static_cast<uint32_t>(
+      (position_ > HEADER_SIZE ? position_ : HEADER_SIZE) - 8);
+
+  std::vector<uint8_t> out;
+  out.reserve(HEADER_SIZE);
+
+  putFourcc(out, "RIFF");
+  put32(out, riffSize);
+  putFourcc(out, "AVI ");
+
+  putFourcc(out, "LIST");
+  put32(out, 192); // hdrl
+  putFourcc(out, "hdrl");
+
+  // Main AVI header
+  putFourcc(out, "avih");
+  put32(out, 56);
+  put32(out, static_cast<uint32_t>(std::lround(1000000.0 / fps)));
+  put32(out, static_cast<uint32_t>(maxFrameSize_ * fps));
+  put32(out, 0);              // Padding granularity
+  put32(out, AVIF_HASINDEX);
+  put32(out, frames);
+  put32(out, 0);              // Initial frames
+  put32(out, 1);              // Streams
+  put32(out, maxFrameSize_);  // Suggested buffer size
+  put32(out, static_cast<uint32_t>(width_));
+  put32(out, static_cast<uint32_t>(height_));
+  for (int i = 0; i < 4; i++)
+    put32(out, 0);
+
+  putFourcc(out, "LIST");
+  put32(out, 116); // strl
+  putFourcc(out, "strl");
+
+  // Stream header
+  putFourcc(out, "strh");
+  put32(out, 56);
+  putFourcc(out, "vids");
+  putFourcc(out, "MJPG");
+  put32(out, 0);              // Flags
+  put16(out, 0);              // Priority
+  put16(out, 0);              // Language
+  put32(out, 0);              // Initial frames
+  put32(out, 1000);           // Scale
+  put32(out, rate);           // Rate: frames per 1000 seconds
+  put32(out, 0);              // Start
+  put32(out, frames);         // Length
+  put32(out, maxFrameSize_);
+  put32(out, 0xFFFFFFFF);     // Quality: default
+  put32(out, 0);              // Sample size: varies
+  put16(out, 0);
+  put16(out, 0);
+  put16(out, static_cast<uint16_t>(width_));
+  put16(out, static_cast<uint16_t>(height_));
+
+  // Stream format (BITMAPINFOHEADER)
+  putFourcc(out, "strf");
+  put32(out, 40);
+  put32(out, 40);
+  put32(out, static_cast<uint32_t>(width_));
+  put32(out, static_cast<uint32_t>(height_));
+  put16(out, 1);              // Planes
+  put16(out, 24);             // Bit count
+  putFourcc(out, "MJPG");
+  put32(out, static_cast<uint32_t>(width_ * height_ * 3));
+  for (int i = 0; i < 4; i++)
+    put32(out, 0);
+
+  putFourcc(out, "LIST");
+  put32(out, moviSize);
+  putFourcc(out, "movi");
+  return out;
+}
+
+void MjpegAviWriter::write(const void *data, size_t size) {
+  file_.write(static_cast<const char *>(data),
+              static_cast<std::streamsize>(size));
+  if (!file_) {
+    failed_ = true;
+  }
+  position_ += size;
+}
+
+} // namespace photobooth
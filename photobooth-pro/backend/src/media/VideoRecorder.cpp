@@ -0,0 +1,193 @@
+#include "media/VideoRecorder.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace photobooth {
+
+namespace {
+
+// AVI 1.0 files must stay under 1 GB; roll over well before that
+constexpr uint64_t MAX_SEGMENT_BYTES = 900ull * 1024 * 1024;
+
+// Buffers kept for reuse; enough to cover a short disk stall
+constexpr size_t MAX_SPARE_BUFFERS = 8;
+
+} // namespace
+
+VideoRecorder::VideoRecorder(const std::string &outputPath,
+                             const Options &options)
+    : outputPath_(outputPath), options_(options) {}
+
+VideoRecorder::~VideoRecorder() { stop(); }
+
+bool VideoRecorder::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return true;
+  }
+
+  // Tạo thư mục output nếu chưa tồn tại
+  fs::path outPath(outputPath_);
+  if (outPath.has_parent_path()) {
+    std::error_code error;
+    fs::create_directories(outPath.parent_path(), error);
+  }
+
+  status_ = Status();
+  status_.recording = true;
+  running_ = true;
+  segmentIndex_ = 0;
+  writerThread_ = std::thread(&VideoRecorder::writerLoop, this);
+
+  std::cout << "VideoRecorder: recording to " << outputPath_ << std::endl;
+  return true;
+}
+
+VideoRecorder::Status VideoRecorder::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  queueCV_.notify_all();
+
+  if (writerThread_.joinable()) {
+    writerThread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_.recording = false;
+  return status_;
+}
+
+VideoRecorder::Status VideoRecorder::status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+void VideoRecorder::addFrame(const std::vector<uint8_t> &jpeg, int width,
+                             int height) {
+  if (jpeg.empty()) {
+    return;
+  }
+
+  Frame frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    // Over budget: drop rather than make the camera thread wait on disk
+    if (queuedBytes_ + jpeg.size() > options_.memoryBudget) {
+      status_.framesDropped++;
+      return;
+    }
+    queuedBytes_ += jpeg.size();
+    if (!spareBuffers_.empty()) {
+      frame.data = std::move(spareBuffers_.back());
+      spareBuffers_.pop_back();
+    }
+  }
+
+  // Copy outside the lock; a reused buffer already has the capacity
+  frame.data.assign(jpeg.begin(), jpeg.end());
+  frame.width = width;
+  frame.height = height;
+  frame.time = Clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(frame));
+  }
+  queueCV_.notify_one();
+}
+
+void VideoRecorder::writerLoop() {
+  while (true) {
+    Frame frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queueCV_.wait(lock, [this] { return !queue_.empty() || !running_; });
+      if (queue_.empty()) {
+        break; // Stopped and drained
+      }
+      frame = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    writeFrame(frame);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    queuedBytes_ -= frame.data.size();
+    if (spareBuffers_.size() < MAX_SPARE_BUFFERS) {
+      spareBuffers_.push_back(std::move(frame.data));
+    }
+  }
+
+  closeSegment();
+}
+
+void VideoRecorder::writeFrame(const Frame &frame) {
+  if (writer_.isOpen()) {
+    // Roll over on duration, size, or a camera switch changing the size
+    auto elapsed = frame.time - segmentStart_;
+    if (elapsed >= std::chrono::seconds(options_.segmentSeconds) ||
+        writer_.bytesWritten() + frame.data.size() > MAX_SEGMENT_BYTES ||
+        frame.width != segmentWidth_ || frame.height != segmentHeight_) {
+      closeSegment();
+    }
+  }
+
+  if (!writer_.isOpen()) {
+    if (!writer_.open(segmentPath(segmentIndex_), frame.width,
+                      frame.height)) {
+      return;
+    }
+    segmentIndex_++;
+    segmentStart_ = frame.time;
+    segmentWidth_ = frame.width;
+    segmentHeight_ = frame.height;
+  }
+
+  if (writer_.writeFrame(frame.data.data(), frame.data.size())) {
+    segmentLast_ = frame.time;
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.framesWritten++;
+  }
+}
+
+void VideoRecorder::closeSegment() {
+  if (!writer_.isOpen()) {
+    return;
+  }
+
+  // FPS the camera actually delivered over this segment
+  double fps = 0;
+  double seconds =
+      std::chrono::duration<double>(segmentLast_ - segmentStart_).count();
+  if (writer_.frameCount() > 1 && seconds > 0) {
+    fps = (writer_.frameCount() - 1) / seconds;
+  }
+
+  std::string path = writer_.path();
+  if (writer_.finish(fps)) {
+    std::cout << "VideoRecorder: segment ready: " << path << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.segments.push_back(path);
+  }
+}
+
+std::string VideoRecorder::segmentPath(int index) const {
+  fs::path path(outputPath_);
+  std::string extension = path.has_extension() ? path.extension().string()
+                                                : std::string(".avi");
+  char suffix[16];
+  std::snprintf(suffix, sizeof(suffix), "_%03d", index);
+
+  path.replace_extension();
+  return path.string() + suffix + extension;
+}
+
+} // namespace photobooth
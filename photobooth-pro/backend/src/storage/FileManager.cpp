@@ -344,7 +344,8 @@ bool FileManager::saveSlotsConfig(const std::string& eventId, const LayoutConfig
              << ", \"x\": " << slot.x
              << ", \"y\": " << slot.y
              << ", \"width\": " << slot.width
-             << ", \"height\": " << slot.height << "}";
+             << ", \"height\": " << slot.height
+             << ", \"rotation\": " << slot.rotation << "}";
         if (i < config.slots.size() - 1) json << ",";
         json << "\n";
     }
@@ -423,6 +424,7 @@ LayoutConfig FileManager::loadSlotsConfig(const std::string& eventId, const std:
             slot.y = extractInt("y");
             slot.width = extractInt("width");
             slot.height = extractInt("height");
+            slot.rotation = extractInt("rotation");
 
             config.slots.push_back(slot);
             pos = objEnd + 1;
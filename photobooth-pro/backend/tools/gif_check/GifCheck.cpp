@@ -0,0 +1,459 @@
+// Round-trips GifEncoder output through an independent GIF89a decoder:
+// LZW at every code size including table resets past 4096 codes, plain,
+// delta and boomerang output, the streaming sink, 1x1 and thin frames, and
+// rejected input. Frames use a few well separated colors and no dither, so
+// every decoded frame must match its source exactly. Exits non-zero if any
+// check failed.
+//
+// Usage: GifCheck
+
+#include "media/GifEncoder.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace photobooth;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what) {
+  std::cout << (condition ? "ok   " : "FAIL ") << what << std::endl;
+  if (!condition) {
+    failures++;
+  }
+}
+
+// LSB-first variable-width codes from concatenated sub-block data
+class CodeReader {
+public:
+  explicit CodeReader(const std::vector<uint8_t> &data) : data_(data) {}
+
+  bool read(int bits, int &code) {
+    while (bitCount_ < bits) {
+      if (pos_ >= data_.size())
+        return false;
+      buffer_ |= static_cast<uint32_t>(data_[pos_++]) << bitCount_;
+      bitCount_ += 8;
+    }
+    code = static_cast<int>(buffer_ & ((1u << bits) - 1));
+    buffer_ >>= bits;
+    bitCount_ -= bits;
+    return true;
+  }
+
+private:
+  const std::vector<uint8_t> &data_;
+  size_t pos_ = 0;
+  uint32_t buffer_ = 0;
+  int bitCount_ = 0;
+};
+
+// Reads the min code size byte and sub-blocks at pos and decodes them
+bool lzwDecode(const std::vector<uint8_t> &gif, size_t &pos,
+               std::vector<uint8_t> &out, int *clearCount = nullptr) {
+  if (pos >= gif.size())
+    return false;
+  int minCodeSize = gif[pos++];
+  if (minCodeSize < 2 || minCodeSize > 8)
+    return false;
+
+  std::vector<uint8_t> data;
+  while (true) {
+    if (pos >= gif.size())
+      return false;
+    size_t length = gif[pos++];
+    if (length == 0)
+      break;
+    if (pos + length > gif.size())
+      return false;
+    data.insert(data.end(), gif.begin() + pos, gif.begin() + pos + length);
+    pos += length;
+  }
+
+  const int clearCode = 1 << minCodeSize;
+  const int endCode = clearCode + 1;
+  std::vector<int> prefix(4096, -1);
+  std::vector<uint8_t> suffix(4096, 0);
+  std::vector<uint8_t> first(4096, 0);
+  for (int i = 0; i < clearCode; i++) {
+    suffix[i] = static_cast<uint8_t>(i);
+    first[i] = static_cast<uint8_t>(i);
+  }
+
+  int codeSize = minCodeSize + 1;
+  int nextCode = endCode + 1;
+  int previous = -1;
+  std::vector<uint8_t> entry;
+  CodeReader reader(data);
+  out.clear();
+  if (clearCount)
+    *clearCount = 0;
+
+  auto expand = [&](int code) {
+    entry.clear();
+    for (int c = code; c >= 0; c = prefix[c])
+      entry.push_back(suffix[c]);
+    out.insert(out.end(), entry.rbegin(), entry.rend());
+  };
+
+  int code;
+  while (reader.read(codeSize, code)) {
+    if (code == clearCode) {
+      codeSize = minCodeSize + 1;
+      nextCode = endCode + 1;
+      previous = -1;
+      if (clearCount)
+        (*clearCount)++;
+      continue;
+    }
+    if (code == endCode)
+      return true;
+
+    if (previous < 0) {
+      if (code >= clearCode)
+        return false;
+      expand(code);
+    } else if (code < nextCode) {
+      expand(code);
+      if (nextCode < 4096) {
+        prefix[nextCode] = previous;
+        suffix[nextCode] = first[code];
+        first[nextCode] = first[previous];
+        nextCode++;
+      }
+    } else if (code == nextCode && nextCode < 4096) {
+      prefix[nextCode] = previous;
+      suffix[nextCode] = first[previous];
+      first[nextCode] = first[previous];
+      nextCode++;
+      expand(code);
+    } else {
+      return false;
+    }
+    previous = code;
+
+    if (nextCode == (1 << codeSize) && codeSize < 12)
+      codeSize++;
+  }
+  return false; // No end code
+}
+
+uint16_t readU16(const std::vector<uint8_t> &gif, size_t pos) {
+  return static_cast<uint16_t>(gif[pos] | (gif[pos + 1] << 8));
+}
+
+struct DecodedGif {
+  int width = 0;
+  int height = 0;
+  int loopCount = -1;
+  std::vector<int> delays;
+  std::vector<std::vector<uint8_t>> frames; // BGR canvas after each image
+  size_t partialFrames = 0; // Images smaller than the logical screen
+};
+
+// Composites every image onto the canvas the way a viewer would, honouring
+// transparency; GifEncoder always leaves frames in place (disposal 1)
+bool decodeGif(const std::vector<uint8_t> &gif, DecodedGif &decoded) {
+  if (gif.size() < 13 || std::string(gif.begin(), gif.begin() + 6) != "GIF89a")
+    return false;
+  decoded.width = readU16(gif, 6);
+  decoded.height = readU16(gif, 8);
+  uint8_t flags = gif[10];
+  if (!(flags & 0x80))
+    return false;
+  size_t tableSize = static_cast<size_t>(1) << ((flags & 0x07) + 1);
+  size_t pos = 13;
+  if (pos + tableSize * 3 > gif.size())
+    return false;
+  std::vector<uint8_t> table(gif.begin() + pos,
+                             gif.begin() + pos + tableSize * 3);
+  pos += tableSize * 3;
+
+  std::vector<uint8_t> canvas(
+      static_cast<size_t>(decoded.width) * decoded.height * 3, 0);
+  int delay = 0;
+  int transparent = -1;
+  std::vector<uint8_t> indices;
+
+  while (pos < gif.size()) {
+    uint8_t block = gif[pos++];
+    if (block == 0x3B) {
+      return pos == gif.size();
+    }
+
+    if (block == 0x21) {
+      if (pos >= gif.size())
+        return false;
+      uint8_t label = gif[pos++];
+      if (label == 0xF9) {
+        if (pos + 6 > gif.size() || gif[pos] != 4 || gif[pos + 5] != 0)
+          return false;
+        if (((gif[pos + 1] >> 2) & 0x07) != 1)
+          return false;
+        delay = readU16(gif, pos + 2);
+        transparent = (gif[pos + 1] & 0x01) ? gif[pos + 4] : -1;
+        pos += 6;
+        continue;
+      }
+      if (label == 0xFF && pos + 12 <= gif.size() &&
+          std::string(gif.begin() + pos + 1, gif.begin() + pos + 12) ==
+              "NETSCAPE2.0") {
+        pos += 12;
+        if (pos + 5 > gif.size() || gif[pos] != 3 || gif[pos + 1] != 1)
+          return false;
+        decoded.loopCount = readU16(gif, pos + 2);
+        pos += 4;
+      }
+      // Skip the remaining sub-blocks
+      while (pos < gif.size() && gif[pos] != 0)
+        pos += gif[pos] + 1;
+      pos++;
+      continue;
+    }
+
+    if (block != 0x2C || pos + 9 > gif.size())
+      return false;
+    int left = readU16(gif, pos);
+    int top = readU16(gif, pos + 2);
+    int width = readU16(gif, pos + 4);
+    int height = readU16(gif, pos + 6);
+    uint8_t imageFlags = gif[pos + 8];
+    pos += 9;
+    if (imageFlags != 0 || left + width > decoded.width ||
+        top + height > decoded.height)
+      return false;
+    if (!lzwDecode(gif, pos, indices) ||
+        indices.size() != static_cast<size_t>(width) * height)
+      return false;
+
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        int index = indices[static_cast<size_t>(y) * width + x];
+        if (index == transparent)
+          continue;
+        if (static_cast<size_t>(index) >= tableSize)
+          return false;
+        // Table is RGB, the canvas BGR like the source frames
+        uint8_t *dst =
+            &canvas[(static_cast<size_t>(top + y) * decoded.width + left + x) *
+                    3];
+        dst[0] = table[index * 3 + 2];
+        dst[1] = table[index * 3 + 1];
+        dst[2] = table[index * 3];
+      }
+    }
+    if (width != decoded.width || height != decoded.height)
+      decoded.partialFrames++;
+    decoded.frames.push_back(canvas);
+    decoded.delays.push_back(delay);
+    transparent = -1;
+  }
+  return false; // No trailer
+}
+
+std::vector<uint8_t> pixels(const cv::Mat &frame) {
+  const uint8_t *data = frame.ptr<uint8_t>(0);
+  return std::vector<uint8_t>(data, data + frame.total() * 3);
+}
+
+// Squares of a few far apart colors moving over a striped background, so
+// most of each frame stays put between frames
+std::vector<cv::Mat> movingFrames(int width, int height, int count) {
+  static const uint8_t colors[][3] = {
+      {0, 0, 0},     {255, 255, 255}, {0, 0, 255},   {0, 255, 0},
+      {255, 0, 0},   {0, 255, 255},   {255, 0, 255}, {255, 255, 0},
+      {128, 128, 128}, {0, 128, 255}, {255, 128, 0}, {128, 0, 128}};
+  std::vector<cv::Mat> frames;
+  for (int i = 0; i < count; i++) {
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = frame.ptr<uint8_t>(y);
+      for (int x = 0; x < width; x++) {
+        int color = (y / 4) % 3;
+        int sx = x - i * 3;
+        int sy = y - i * 2;
+        if (sx >= 0 && sx < width / 3 + 1 && sy >= 0 && sy < height / 3 + 1)
+          color = 3 + (i % 9);
+        std::copy(colors[color], colors[color] + 3, row + x * 3);
+      }
+    }
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+GifEncoder::Options exactOptions(bool optimize) {
+  GifEncoder::Options options;
+  options.dither = GifEncoder::Dither::None;
+  options.optimize = optimize;
+  options.deltaTolerance = 0;
+  options.frameDelay = 7;
+  options.loopCount = 3;
+  return options;
+}
+
+// Every decoded frame equals frames[order[k]]
+bool matchesOrder(const DecodedGif &decoded,
+                  const std::vector<cv::Mat> &frames,
+                  const std::vector<size_t> &order) {
+  if (decoded.frames.size() != order.size())
+    return false;
+  for (size_t k = 0; k < order.size(); k++) {
+    if (decoded.frames[k] != pixels(frames[order[k]]))
+      return false;
+  }
+  return true;
+}
+
+void checkRoundTrip(const std::string &name,
+                    const std::vector<cv::Mat> &frames,
+                    const std::vector<size_t> &order,
+                    const GifEncoder::Options &options) {
+  std::vector<uint8_t> gif;
+  DecodedGif decoded;
+  bool encoded = GifEncoder::encode(frames, order, options, gif);
+  bool parsed = encoded && decodeGif(gif, decoded);
+  check(parsed, name + ": encodes and parses");
+  if (!parsed)
+    return;
+
+  check(decoded.width == frames[0].cols && decoded.height == frames[0].rows,
+        name + ": logical screen size");
+  check(decoded.loopCount == options.loopCount, name + ": loop count");
+  bool delays = true;
+  for (int delay : decoded.delays)
+    delays = delays && delay == options.frameDelay;
+  check(delays, name + ": frame delays");
+  check(matchesOrder(decoded, frames, order), name + ": frames match source");
+}
+
+void checkLzw() {
+  std::mt19937 random(1234);
+  bool roundTrips = true;
+  for (int bits = 2; bits <= 8; bits++) {
+    for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(5000)}) {
+      std::vector<uint8_t> input(count);
+      for (auto &value : input)
+        value = static_cast<uint8_t>(random() % (1u << bits));
+
+      std::vector<uint8_t> encoded;
+      GifEncoder::lzwEncode(input.data(), input.size(), bits, encoded);
+      std::vector<uint8_t> output;
+      size_t pos = 0;
+      roundTrips = roundTrips && lzwDecode(encoded, pos, output) &&
+                   pos == encoded.size() && output == input;
+    }
+  }
+  check(roundTrips, "lzw round trip at every code size");
+
+  // Random 8-bit data fills the 4096-entry table many times over
+  std::vector<uint8_t> noise(300000);
+  for (auto &value : noise)
+    value = static_cast<uint8_t>(random());
+  std::vector<uint8_t> encoded, output;
+  size_t pos = 0;
+  int clears = 0;
+  GifEncoder::lzwEncode(noise.data(), noise.size(), 8, encoded);
+  bool ok = lzwDecode(encoded, pos, output, &clears) && output == noise;
+  check(ok && clears > 1, "lzw table resets past 4096 codes (" +
+                              std::to_string(clears) + " clear codes)");
+
+  // Long runs build the longest strings
+  std::vector<uint8_t> runs(1 << 20, 5);
+  encoded.clear(); // lzwEncode appends
+  GifEncoder::lzwEncode(runs.data(), runs.size(), 4, encoded);
+  pos = 0;
+  check(lzwDecode(encoded, pos, output) && output == runs, "lzw long runs");
+}
+
+void checkSink() {
+  auto frames = movingFrames(48, 32, 5);
+  auto order = GifEncoder::playOrder(frames.size());
+  for (bool optimize : {false, true}) {
+    GifEncoder::Options options = exactOptions(optimize);
+    std::vector<uint8_t> whole, streamed;
+    size_t chunks = 0;
+    GifEncoder::encode(frames, order, options, whole);
+    GifEncoder::encode(frames, order, options,
+                       [&](const uint8_t *data, size_t size) {
+                         streamed.insert(streamed.end(), data, data + size);
+                         chunks++;
+                       });
+    check(streamed == whole && chunks > frames.size(),
+          std::string("sink gets the same bytes in pieces, optimize = ") +
+              (optimize ? "true" : "false"));
+  }
+}
+
+void checkDelta() {
+  auto frames = movingFrames(64, 48, 6);
+  auto order = GifEncoder::playOrder(frames.size());
+  std::vector<uint8_t> plain, delta;
+  GifEncoder::encode(frames, order, exactOptions(false), plain);
+  GifEncoder::encode(frames, order, exactOptions(true), delta);
+  DecodedGif decoded;
+  check(decodeGif(delta, decoded) &&
+            decoded.partialFrames == frames.size() - 1,
+        "delta: every frame after the first is a changed region");
+  check(delta.size() < plain.size(),
+        "delta: smaller than plain (" + std::to_string(delta.size()) +
+            " vs " + std::to_string(plain.size()) + " bytes)");
+
+  // Unchanged frames collapse to a transparent 1x1 block
+  std::vector<cv::Mat> still = {frames[0], frames[0], frames[0]};
+  checkRoundTrip("delta, unchanged frames", still,
+                 GifEncoder::playOrder(still.size()), exactOptions(true));
+}
+
+void checkEdgeCases() {
+  auto tiny = movingFrames(1, 1, 3);
+  checkRoundTrip("1x1, one frame", {tiny[0]}, {0}, exactOptions(true));
+  checkRoundTrip("1x1, plain", tiny, GifEncoder::playOrder(3),
+                 exactOptions(false));
+  checkRoundTrip("1x1, delta", tiny, GifEncoder::playOrder(3),
+                 exactOptions(true));
+  checkRoundTrip("3x700, delta", movingFrames(3, 700, 4),
+                 GifEncoder::playOrder(4), exactOptions(true));
+  checkRoundTrip("700x3, delta", movingFrames(700, 3, 4),
+                 GifEncoder::playOrder(4), exactOptions(true));
+
+  std::vector<uint8_t> gif;
+  auto frames = movingFrames(16, 16, 2);
+  check(!GifEncoder::encode({}, exactOptions(false), gif),
+        "rejects no frames");
+  check(!GifEncoder::encode(frames, {0, 2}, exactOptions(false), gif),
+        "rejects an order index past the frames");
+  std::vector<cv::Mat> mixed = {frames[0], movingFrames(8, 16, 1)[0]};
+  check(!GifEncoder::encode(mixed, exactOptions(false), gif),
+        "rejects frames of different sizes");
+}
+
+} // namespace
+
+int main() {
+  checkLzw();
+
+  auto frames = movingFrames(64, 48, 6);
+  auto order = GifEncoder::playOrder(frames.size());
+  checkRoundTrip("plain", frames, order, exactOptions(false));
+  checkRoundTrip("delta", frames, order, exactOptions(true));
+
+  // Forward then back without repeating the ends
+  std::vector<size_t> boomerang = order;
+  for (size_t i = frames.size() - 2; i > 0; i--)
+    boomerang.push_back(i);
+  checkRoundTrip("boomerang, plain", frames, boomerang, exactOptions(false));
+  checkRoundTrip("boomerang, delta", frames, boomerang, exactOptions(true));
+
+  checkDelta();
+  checkSink();
+  checkEdgeCases();
+
+  std::cout << (failures == 0 ? "all checks passed" : "checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
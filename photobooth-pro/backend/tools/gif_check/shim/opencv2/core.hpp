@@ -0,0 +1,43 @@
+#pragma once
+
+// Just enough of cv::Mat for GifEncoder and GifCheck where OpenCV isn't
+// installed: continuous 8-bit BGR images with shared storage.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#define CV_8UC3 16
+
+namespace cv {
+
+class Mat {
+public:
+  int rows = 0;
+  int cols = 0;
+
+  Mat() {}
+  Mat(int rows_, int cols_, int)
+      : rows(rows_), cols(cols_),
+        data_(std::make_shared<std::vector<uint8_t>>(
+            static_cast<size_t>(rows_) * cols_ * 3)) {}
+
+  int type() const { return CV_8UC3; }
+  bool empty() const { return !data_ || data_->empty(); }
+  size_t total() const { return static_cast<size_t>(rows) * cols; }
+
+  template <class T> T *ptr(int y = 0) {
+    return reinterpret_cast<T *>(data_->data() +
+                                 static_cast<size_t>(y) * cols * 3);
+  }
+  template <class T> const T *ptr(int y = 0) const {
+    return reinterpret_cast<const T *>(data_->data() +
+                                       static_cast<size_t>(y) * cols * 3);
+  }
+
+private:
+  std::shared_ptr<std::vector<uint8_t>> data_;
+};
+
+} // namespace cv
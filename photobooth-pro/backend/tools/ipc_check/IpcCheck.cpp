@@ -0,0 +1,184 @@
+// Drives ProcessManager against StandInWorker: startup ping, request round
+// trip time, session and live view requests, shutdown and re-initialize,
+// and recovery after the child is killed. Then checks that WorkerSupervisor
+// keeps every body ID on the same camera across worker restarts while each
+// worker process enumerates the cameras in a different order. Exits
+// non-zero if any check failed.
+//
+// Usage: IpcCheck <path to StandInWorker> [ping count]
+
+#include "camera/ProcessManager.h"
+#include "camera/WorkerSupervisor.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace photobooth;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what) {
+  std::cout << (condition ? "ok   " : "FAIL ") << what << std::endl;
+  if (!condition) {
+    failures++;
+  }
+}
+
+void killWorkers(const std::string &worker) {
+  std::system(("pkill -KILL -f '^" + worker + " --machine'").c_str());
+}
+
+// CaptureComplete paths per body, as WorkerSupervisor reports them
+class CaptureLog {
+public:
+  void add(const ipc::Frame &event) {
+    ipc::PayloadReader reader(event.payload);
+    uint32_t bodyID = 0;
+    std::string path;
+    if (event.opcode() != ipc::Opcode::CaptureComplete ||
+        !reader.u32(bodyID) || !reader.str(path)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    paths_[bodyID].push_back(path);
+    count_++;
+    cond_.notify_all();
+  }
+
+  bool waitFor(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, std::chrono::seconds(5),
+                          [&] { return count_ >= count; });
+  }
+
+  std::map<uint32_t, std::vector<std::string>> paths() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return paths_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::map<uint32_t, std::vector<std::string>> paths_;
+  size_t count_ = 0;
+};
+
+void checkSupervisor(const std::string &worker) {
+  setenv("STANDIN_CAMERAS", "A@usb:1,B@usb:2,C@usb:3,D@usb:4", 1);
+  setenv("STANDIN_SHUFFLE", "1", 1);
+
+  CaptureLog log;
+  WorkerSupervisor supervisor(worker);
+  supervisor.setEventCallback([&log](const ipc::Frame &event) { log.add(event); });
+
+  check(supervisor.start(), "supervisor starts");
+  std::vector<uint32_t> bodies = supervisor.getBodies();
+  check(bodies.size() == 4, "one worker per body");
+
+  check(supervisor.takePicture(), "capture on every body");
+  check(log.waitFor(bodies.size()), "capture events received");
+
+  auto allHealthy = [&] {
+    for (uint32_t bodyID : bodies) {
+      if (!supervisor.isHealthy(bodyID)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto waitUntil = [](auto condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return condition();
+  };
+
+  killWorkers(worker);
+  check(waitUntil([&] { return !allHealthy(); }), "dead workers noticed");
+  check(waitUntil(allHealthy), "workers restarted");
+  check(supervisor.takePicture(), "capture after restart");
+  check(log.waitFor(2 * bodies.size()), "capture events after restart");
+
+  // Same camera (port) before and after the restart, and no two bodies
+  // sharing one
+  bool stable = true;
+  std::map<std::string, uint32_t> owner;
+  for (const auto &entry : log.paths()) {
+    for (const auto &path : entry.second) {
+      stable = stable && path == entry.second.front();
+    }
+    auto inserted = owner.emplace(entry.second.front(), entry.first);
+    stable = stable && inserted.second;
+  }
+  check(stable && owner.size() == bodies.size(),
+        "every body keeps its camera across restarts");
+
+  supervisor.stop();
+  unsetenv("STANDIN_CAMERAS");
+  unsetenv("STANDIN_SHUFFLE");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <stand-in worker> [pings]"
+              << std::endl;
+    return 2;
+  }
+  std::string worker = argv[1];
+  int pings = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+  ProcessManager manager(worker);
+  check(manager.initialize(), "initialize answers the startup ping");
+  check(manager.detectCameras().size() == 2, "two bodies listed");
+
+  auto start = std::chrono::steady_clock::now();
+  bool allAnswered = true;
+  for (int i = 0; i < pings; i++) {
+    allAnswered = manager.ping() && allAnswered;
+  }
+  double micros = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  check(allAnswered, std::to_string(pings) + " pings answered");
+  std::cout << "     " << (pings > 0 ? micros / pings : 0)
+            << " us per round trip" << std::endl;
+
+  check(manager.selectCamera(1), "open session on body 1");
+  check(manager.setISO(0x48), "set property");
+  check(!manager.getLiveViewFrame().empty(), "live view frame via ring");
+
+  manager.shutdown();
+  check(!manager.isRunning(), "not running after shutdown");
+  check(!manager.ping(200), "ping fails after shutdown");
+
+  check(manager.initialize(), "re-initialize after shutdown");
+  check(manager.ping(), "ping after re-initialize");
+
+  // A dead child must wake waiters and allow a clean restart
+  killWorkers(worker);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (manager.isRunning() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  check(!manager.isRunning(), "child death noticed");
+  manager.shutdown();
+  check(manager.initialize(), "re-initialize after child death");
+  check(manager.ping(), "ping after restart");
+  manager.shutdown();
+
+  checkSupervisor(worker);
+
+  std::cout << (failures == 0 ? "all checks passed" : "checks failed")
+            << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Stand-in for MultiCamCui --machine. Speaks the same frame protocol over
+// stdin/stdout without EDSDK, so ProcessManager and WorkerSupervisor can be
+// exercised and timed on any POSIX host.
+//
+// Bodies come from STANDIN_CAMERAS ("Name A@port1,Name B@port2", default two
+// bodies). With STANDIN_SHUFFLE set, every process enumerates them in a
+// different order, like EDSDK does across processes and replugs.
+// TakePicture answers with a CaptureComplete event whose path is the port.
+
+#include "ipc/FrameProtocol.h"
+#include "ipc/SharedFrameRing.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace photobooth::ipc;
+
+namespace {
+
+bool readAll(void *data, size_t size) {
+  char *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(STDIN_FILENO, bytes, size);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool writeAll(const std::vector<uint8_t> &data) {
+  const uint8_t *bytes = data.data();
+  size_t size = data.size();
+  while (size > 0) {
+    ssize_t n = write(STDOUT_FILENO, bytes, size);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+struct Camera {
+  std::string name;
+  std::string port;
+  bool opened = false;
+};
+
+std::vector<Camera> enumerateCameras() {
+  const char *env = std::getenv("STANDIN_CAMERAS");
+  std::string list = env ? env : "Stand-in A@usb:1,Stand-in B@usb:2";
+
+  std::vector<Camera> cameras;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > start) {
+      std::string entry = list.substr(start, end - start);
+      size_t at = entry.find('@');
+      Camera camera;
+      camera.name = entry.substr(0, at);
+      camera.port = at == std::string::npos ? camera.name : entry.substr(at + 1);
+      cameras.push_back(camera);
+    }
+    start = end + 1;
+  }
+
+  if (std::getenv("STANDIN_SHUFFLE")) {
+    std::shuffle(cameras.begin(), cameras.end(),
+                 std::mt19937(std::random_device{}()));
+  }
+  return cameras;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  SharedFrameRing ring;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (std::strcmp(argv[i], "--ring") == 0) {
+      ring.open(argv[i + 1]);
+    }
+  }
+
+  std::vector<Camera> cameras = enumerateCameras();
+  std::vector<std::vector<uint8_t>> pendingEvents;
+
+  while (true) {
+    Frame request;
+    if (!readAll(&request.header, sizeof(request.header)) ||
+        !isValidHeader(request.header)) {
+      return 0; // Host closed the pipe
+    }
+    request.payload.resize(request.header.payloadLength);
+    if (!request.payload.empty() &&
+        !readAll(request.payload.data(), request.payload.size())) {
+      return 0;
+    }
+
+    PayloadReader reader(request.payload);
+    PayloadWriter response;
+    uint32_t status = STATUS_OK;
+    uint32_t bodyID = 0;
+
+    switch (request.opcode()) {
+    case Opcode::ListCameras:
+      response.u32(static_cast<uint32_t>(cameras.size()));
+      for (const auto &camera : cameras) {
+        response.str(camera.name).str(camera.port);
+      }
+      break;
+
+    case Opcode::OpenSession:
+    case Opcode::CloseSession:
+      if (!reader.u32(bodyID) || bodyID > cameras.size()) {
+        status = STATUS_NO_CAMERA;
+        break;
+      }
+      for (size_t i = 0; i < cameras.size(); i++) {
+        if (bodyID == 0 || bodyID == i + 1) {
+          cameras[i].opened = request.opcode() == Opcode::OpenSession;
+        }
+      }
+      break;
+
+    case Opcode::OpenSessionByPort: {
+      std::string port;
+      status = STATUS_NO_CAMERA;
+      reader.str(port);
+      for (size_t i = 0; i < cameras.size(); i++) {
+        if (cameras[i].port == port) {
+          cameras[i].opened = true;
+          bodyID = static_cast<uint32_t>(i + 1);
+          status = STATUS_OK;
+        }
+      }
+      response.u32(bodyID);
+      break;
+    }
+
+    case Opcode::TakePicture:
+      reader.u32(bodyID);
+      for (size_t i = 0; i < cameras.size(); i++) {
+        if (cameras[i].opened && (bodyID == 0 || bodyID == i + 1)) {
+          PayloadWriter event;
+          event.u32(static_cast<uint32_t>(i + 1)).str(cameras[i].port);
+          pendingEvents.push_back(event.data());
+        }
+      }
+      break;
+
+    case Opcode::GetProperty:
+      response.u32(0);
+      break;
+
+    case Opcode::GrabLiveViewFrame: {
+      // Minimal JPEG markers; the host only copies bytes
+      const uint8_t jpeg[] = {0xFF, 0xD8, 0xFF, 0xD9};
+      reader.u32(bodyID);
+      uint64_t sequence = ring.isOpen() ? ring.write(jpeg, sizeof(jpeg), bodyID)
+                                        : 0;
+      if (sequence == 0) {
+        status = STATUS_NO_CAMERA;
+      }
+      response.u64(sequence);
+      break;
+    }
+
+    default:
+      break;
+    }
+
+    if (!writeAll(encodeFrame(MessageType::Response, request.opcode(),
+                              request.header.correlationId, status,
+                              response.data()))) {
+      return 0;
+    }
+    for (const auto &event : pendingEvents) {
+      writeAll(encodeFrame(MessageType::Event, Opcode::CaptureComplete, 0,
+                           STATUS_OK, event));
+    }
+    pendingEvents.clear();
+    if (request.opcode() == Opcode::Shutdown) {
+      return 0;
+    }
+  }
+}